@@ -0,0 +1,89 @@
+#!/bin/sh
+# Build-time benchmark. Generates a project of TUS translation units (200 by default), each of which defines a command
+# with its own schema, and builds it in both modes: header-only and against the compiled library (CRAP_SEPARATE_COMPILATION).
+# Translation units are compiled one after another, so times do not depend on the number of cores.
+#
+# Usage: build.sh [TUS]
+# Environment: CXX (default c++), CXX_FLAGS (default -std=c++11 -O2).
+
+set -e
+
+TUS=${1:-200}
+CXX=${CXX:-c++}
+CXX_FLAGS=${CXX_FLAGS:--std=c++11 -O2}
+INCLUDE=$(cd "$(dirname "$0")/../include" && pwd)
+DIR=$(mktemp -d)
+trap 'rm -rf "$DIR"' EXIT
+
+i=0
+while [ $i -lt "$TUS" ]; do
+	cat > "$DIR/cmd$i.cpp" <<EOF
+#include "crap.hpp"
+
+int Cmd$i(int argc, char * argv[])
+{
+	crap::KeyArg cmd("cmd$i");
+	crap::Parser parser(& cmd);
+	crap::KeyArg verbose("--verbose", "Print verbose messages.");
+	verbose.addAlias("-v");
+	parser.addAttr(& verbose);
+	crap::KeyValueArg output("--output", "file", "Output file.");
+	output.setDefaultValue("out$i");
+	parser.addAttr(& output);
+	crap::IntListArg ids("--ids", "list", "Identifiers.");
+	parser.addAttr(& ids);
+	try {
+		parser.parse(argc, argv);
+	} catch (const crap::Exception & ) {
+		parser.printHelp();
+		return 1;
+	}
+	return static_cast<int>(ids.values().size()) + (verbose.isSet() ? 1 : 0);
+}
+EOF
+	i=$((i + 1))
+done
+
+{
+	i=0
+	while [ $i -lt "$TUS" ]; do
+		echo "int Cmd$i(int argc, char * argv[]);"
+		i=$((i + 1))
+	done
+	echo "int main(int argc, char * argv[])"
+	echo "{"
+	echo "	int result = 0;"
+	i=0
+	while [ $i -lt "$TUS" ]; do
+		echo "	result += Cmd$i(argc, argv);"
+		i=$((i + 1))
+	done
+	echo "	return result;"
+	echo "}"
+} > "$DIR/main.cpp"
+# Same as src/crap.cpp.
+printf '#define CRAP_IMPLEMENTATION\n#include "crap.hpp"\n' > "$DIR/crap.cpp"
+
+now()
+{
+	date +%s.%N
+}
+
+# Usage: build MODE_FLAGS LIBRARY_SOURCES...
+build()
+{
+	flags=$1
+	shift
+	rm -f "$DIR"/*.o
+	start=$(now)
+	for source in "$@" "$DIR"/cmd*.cpp "$DIR/main.cpp"; do
+		$CXX $CXX_FLAGS $flags -I"$INCLUDE" -c "$source" -o "${source%.cpp}.o"
+	done
+	$CXX $CXX_FLAGS "$DIR"/*.o -o "$DIR/project"
+	end=$(now)
+	echo "$start $end" | awk '{ printf "%.2f s", $2 - $1 }'
+}
+
+echo "$TUS translation units, $CXX $CXX_FLAGS"
+echo "header-only: $(build "")"
+echo "compiled library: $(build "-DCRAP_SEPARATE_COMPILATION" "$DIR/crap.cpp")"
@@ -0,0 +1,135 @@
+// Throughput of CmdlineScanner. Scans a directory of command line files with the scanner and with a naive scan, which reads
+// each file into a std::string, splits it into std::string arguments and parses an array of pointers to them. Reports time
+// per file. Directory is generated in a temporary directory, unless a path is given:
+//
+//     cmdline [directory]
+
+#include "../test/test.hpp"
+#include "../include/crap_cmdline.hpp"
+
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const int FILES = 2000;
+
+struct Schema
+{
+	Schema();
+
+	crap::KeyArg cmd;
+	crap::Parser parser;
+	crap::KeyArg verbose;
+	crap::KeyValueArg config;
+	crap::KeyValueArg user;
+	crap::ValueArg file;
+};
+
+Schema::Schema():
+    cmd("daemon"),
+    parser(& cmd),
+    verbose("-v"),
+    config("--config", "file"),
+    user("--user", "name"),
+    file("file")
+{
+	parser.addAttr(& verbose);
+	parser.addAttr(& config);
+	parser.addAttr(& user);
+	parser.addAttr(& file);
+}
+
+/**
+ * Scan directory in the same way as CmdlineScanner does, but with a std::string for each file and argument.
+ */
+std::size_t NaiveScan(const std::string & path, crap::Parser & parser)
+{
+	std::size_t count = 0;
+	bool onProcfs = crap::cmdline::OnProcfs(path);
+	DIR * dir = ::opendir(path.c_str());
+	while (dirent * entry = ::readdir(dir)) {
+		std::string filePath = path + "/" + entry->d_name;
+		struct stat status;
+		if ((entry->d_name[0] == '.') || (::lstat(filePath.c_str(), & status) != 0))
+			continue;
+		if (S_ISDIR(status.st_mode))
+			filePath += "/cmdline";
+		else if (!S_ISREG(status.st_mode) || (status.st_size == 0) || onProcfs)
+			continue;
+
+		std::ifstream file(filePath.c_str(), std::ios::binary);
+		std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		if (content.empty())
+			continue;
+		std::vector<std::string> args;
+		std::istringstream stream(content);
+		std::string arg;
+		while (std::getline(stream, arg, '\0'))
+			args.push_back(arg);
+		std::vector<char *> argv;
+		for (std::vector<std::string>::iterator it = args.begin(); it != args.end(); ++it)
+			argv.push_back(& (*it)[0]);
+		parser.reset();
+		try {
+			parser.parse(static_cast<int>(argv.size()), argv.data());
+		} catch (const crap::Exception & ) {
+		}
+		count++;
+	}
+	::closedir(dir);
+	return count;
+}
+
+}
+
+int main(int argc, char * argv[])
+{
+	std::string path;
+	char dirTemplate[] = "/tmp/crap_bench_cmdline_XXXXXX";
+	if (argc > 1)
+		path = argv[1];
+	else {
+		path = ::mkdtemp(dirTemplate);
+		for (int i = 0; i < FILES; i++) {
+			std::ostringstream name;
+			name << path << "/" << i;
+			std::ofstream file(name.str().c_str(), std::ios::binary);
+			file << "daemon" << '\0' << "-v" << '\0' << "--config=/etc/daemon/" << i << ".conf" << '\0' << "--user" << '\0'
+					<< "nobody" << '\0' << "/var/lib/daemon/data" << i << '\0';
+		}
+	}
+
+	Schema schema;
+	crap::CmdlineScanner scanner(schema.parser);
+	std::size_t files = 0;
+	double scannerSeconds = test::Seconds([&]() {
+		files = scanner.scanDirectory(path, [](const std::string &, const crap::Exception *) {});
+	});
+	std::size_t naiveFiles = 0;
+	double naiveSeconds = test::Seconds([&]() {
+		naiveFiles = NaiveScan(path, schema.parser);
+	});
+	if (files != naiveFiles)
+		std::cout << "scanned file counts differ: " << files << " and " << naiveFiles << std::endl;
+	if (files > 0)
+		std::cout << files << " files: CmdlineScanner " << scannerSeconds / static_cast<double>(files) * 1e6 << " us per file, naive scan "
+				<< naiveSeconds / static_cast<double>(files) * 1e6 << " us per file" << std::endl;
+
+	if (argc <= 1) {
+		for (int i = 0; i < FILES; i++) {
+			std::ostringstream name;
+			name << path << "/" << i;
+			::unlink(name.str().c_str());
+		}
+		::rmdir(path.c_str());
+	}
+	return 0;
+}
@@ -0,0 +1,119 @@
+// Comparison with getopt_long(). Parses typical command lines of a flat schema with Parser and walks them with
+// getopt_long() over an equivalent option table, and reports time of a single parse. getopt_long() only reports options,
+// while Parser also stores values and checks constraints.
+
+#include "../test/test.hpp"
+#include "../include/crap.hpp"
+
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <getopt.h>
+
+namespace {
+
+const std::size_t OPTIONS = 32;
+
+struct Schema
+{
+	Schema();
+
+	crap::KeyArg cmd;
+	crap::Parser parser;
+	std::vector<std::unique_ptr<crap::KeyArg>> flags;
+	std::vector<std::unique_ptr<crap::KeyValueArg>> options;
+	crap::ValueArg file;
+};
+
+Schema::Schema():
+    cmd("bench"),
+    parser(& cmd),
+    file("file")
+{
+	for (std::size_t i = 0; i < OPTIONS; i++) {
+		std::ostringstream name;
+		name << "--option" << i;
+		options.push_back(std::unique_ptr<crap::KeyValueArg>(new crap::KeyValueArg(name.str(), "value")));
+		parser.addAttr(options.back().get());
+	}
+	for (char c = 'a'; c <= 'z'; c++) {
+		flags.push_back(std::unique_ptr<crap::KeyArg>(new crap::KeyArg(std::string("-") + c)));
+		parser.addAttr(flags.back().get());
+	}
+	parser.addAttr(& file);
+}
+
+/**
+ * Option table of getopt_long(), which recognizes the same options as Schema.
+ */
+struct Options
+{
+	Options();
+
+	std::string shortOptions;
+	std::vector<std::string> names;
+	std::vector<option> longOptions;
+};
+
+Options::Options():
+    shortOptions("-")	// Keep arguments in order, as Parser does.
+{
+	for (char c = 'a'; c <= 'z'; c++)
+		shortOptions.push_back(c);
+	for (std::size_t i = 0; i < OPTIONS; i++) {
+		std::ostringstream name;
+		name << "option" << i;
+		names.push_back(name.str());
+	}
+	for (std::size_t i = 0; i < OPTIONS; i++)
+		longOptions.push_back(option{names[i].c_str(), required_argument, nullptr, 256 + static_cast<int>(i)});
+	longOptions.push_back(option{nullptr, 0, nullptr, 0});
+}
+
+int Getopt(const Options & options, int argc, char * argv[])
+{
+	// Zero optind requests full reinitialization from GNU implementation, others use optreset for that.
+#ifdef __GLIBC__
+	optind = 0;
+#else
+	optreset = 1;
+	optind = 1;
+#endif
+	opterr = 0;
+	int count = 0;
+	while (getopt_long(argc, argv, options.shortOptions.c_str(), options.longOptions.data(), nullptr) != -1)
+		count++;
+	return count;
+}
+
+void Measure(const char * name, std::vector<std::string> args)
+{
+	std::vector<char *> argv;
+	for (std::vector<std::string>::iterator it = args.begin(); it != args.end(); ++it)
+		argv.push_back(& (*it)[0]);
+	int argc = static_cast<int>(argv.size());
+
+	Schema schema;
+	Options options;
+	double parserSeconds = test::Seconds([&]() {
+		schema.parser.reset();
+		schema.parser.parse(argc, argv.data());
+	});
+	double getoptSeconds = test::Seconds([&]() {
+		Getopt(options, argc, argv.data());
+	});
+	std::cout << name << ": Parser " << parserSeconds * 1e9 << " ns, getopt_long() " << getoptSeconds * 1e9 << " ns" << std::endl;
+}
+
+}
+
+int main()
+{
+	Measure("short options", {"bench", "-a", "-b", "-c", "-x", "file"});
+	Measure("long options", {"bench", "--option1=a", "--option7", "b", "--option30=c", "file"});
+	Measure("mixed options", {"bench", "-v", "--option12=value", "-q", "--option3", "value", "-z", "--", "trailing"});
+	Measure("glued options", {"bench", "-abc", "--option1=a"});
+	return 0;
+}
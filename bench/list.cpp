@@ -0,0 +1,68 @@
+// Throughput of list arguments. Converts a million comma-separated integers and floats with IntListArg and FloatListArg and
+// with a naive split into std::string elements followed by std::stoll() and std::stod(), and reports GB/s.
+
+#include "../test/test.hpp"
+#include "../include/crap.hpp"
+
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+const int ELEMENTS = 1000000;
+
+template <typename T>
+std::vector<T> NaiveSplit(const std::string & value, char delimiter)
+{
+	std::vector<T> result;
+	std::istringstream stream(value);
+	std::string element;
+	while (std::getline(stream, element, delimiter))
+		result.push_back(std::is_integral<T>::value ? static_cast<T>(std::stoll(element)) : static_cast<T>(std::stod(element)));
+	return result;
+}
+
+template <typename ListArgType>
+void Measure(const char * name, const std::string & value)
+{
+	typedef typename ListArgType::ValuesContainer::value_type ValueType;
+
+	crap::KeyArg cmd("bench");
+	crap::Parser parser(& cmd);
+	ListArgType list("--list", "values");
+	parser.addAttr(& list);
+	std::string arg = "--list=" + value;
+	char * argv[] = {const_cast<char *>("bench"), & arg[0]};
+
+	double listSeconds = test::Seconds([&]() {
+		parser.reset();
+		parser.parse(2, argv);
+	}, 3);
+	double naiveSeconds = test::Seconds([&]() {
+		NaiveSplit<ValueType>(value, ',');
+	}, 3);
+	if (list.values() != NaiveSplit<ValueType>(value, ','))
+		std::cout << name << ": results differ" << std::endl;
+
+	double gigabytes = static_cast<double>(value.size()) / 1e9;
+	std::cout << name << ": " << gigabytes / listSeconds << " GB/s (naive split: " << gigabytes / naiveSeconds << " GB/s)" << std::endl;
+}
+
+}
+
+int main()
+{
+	std::mt19937_64 random(1);
+	std::ostringstream ints;
+	std::ostringstream floats;
+	floats.precision(6);
+	for (int i = 0; i < ELEMENTS; i++) {
+		ints << (i ? "," : "") << static_cast<long long>(random() % 1000000000) - 500000000;
+		floats << (i ? "," : "") << std::uniform_real_distribution<double>(-1000.0, 1000.0)(random);
+	}
+	Measure<crap::IntListArg>("IntListArg", ints.str());
+	Measure<crap::FloatListArg>("FloatListArg", floats.str());
+	return EXIT_SUCCESS;
+}
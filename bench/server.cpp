@@ -0,0 +1,102 @@
+// Latency of ParseServer. Compares a round trip of ParseClient over a connection, which is kept open, and over a new
+// connection with construction of a schema and a parse in the process itself, which the server saves to its clients.
+// Round trips are measured also while another client keeps an idle connection open. Reports time of a single parse.
+
+#include "../test/test.hpp"
+#include "../include/crap_server.hpp"
+
+#include <atomic>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+const std::size_t OPTIONS = 32;
+
+struct Schema
+{
+	Schema();
+
+	crap::KeyArg cmd;
+	crap::Parser parser;
+	std::vector<std::unique_ptr<crap::KeyArg>> flags;
+	std::vector<std::unique_ptr<crap::KeyValueArg>> options;
+	crap::ValueArg file;
+};
+
+Schema::Schema():
+    cmd("bench"),
+    parser(& cmd),
+    file("file")
+{
+	for (std::size_t i = 0; i < OPTIONS; i++) {
+		std::ostringstream name;
+		name << "--option" << i;
+		options.push_back(std::unique_ptr<crap::KeyValueArg>(new crap::KeyValueArg(name.str(), "value")));
+		parser.addAttr(options.back().get());
+	}
+	for (char c = 'a'; c <= 'z'; c++) {
+		flags.push_back(std::unique_ptr<crap::KeyArg>(new crap::KeyArg(std::string("-") + c)));
+		parser.addAttr(flags.back().get());
+	}
+	parser.addAttr(& file);
+}
+
+void Measure(const char * name, const std::string & socketPath, const std::vector<const char *> & argv)
+{
+	int argc = static_cast<int>(argv.size());
+	std::vector<char *> mutableArgv;
+	for (std::vector<const char *>::const_iterator it = argv.begin(); it != argv.end(); ++it)
+		mutableArgv.push_back(const_cast<char *>(*it));
+
+	double localSeconds = test::Seconds([&]() {
+		Schema schema;
+		schema.parser.parse(argc, mutableArgv.data());
+	});
+	crap::ParseClient client(socketPath);
+	crap::ParseResult result;
+	double roundTripSeconds = test::Seconds([&]() {
+		client.parse(argc, argv.data(), result);
+	});
+	double connectSeconds = test::Seconds([&]() {
+		crap::ParseClient connected(socketPath);
+		connected.parse(argc, argv.data(), result);
+	});
+	if (result.status != crap::ParseResult::OK)
+		std::cout << name << ": " << result.error << std::endl;
+	std::cout << name << ": schema and parse " << localSeconds * 1e6 << " us, round trip " << roundTripSeconds * 1e6
+			<< " us, connect and round trip " << connectSeconds * 1e6 << " us" << std::endl;
+}
+
+}
+
+int main()
+{
+	std::string socketPath = "/tmp/crap_bench_server_" + std::to_string(::getpid()) + ".sock";
+	Schema schema;
+	crap::ParseServer server(schema.parser, socketPath);
+	std::atomic<bool> stop(false);
+	std::thread serverThread([&]() {
+		while (!stop.load())
+			server.poll(50);
+	});
+
+	Measure("short options", socketPath, {"bench", "-a", "-b", "-c", "-x", "file"});
+	Measure("long options", socketPath, {"bench", "--option1=a", "--option7", "b", "--option30=c", "file"});
+	{
+		// Idle client does not delay the others.
+		crap::ParseClient idle(socketPath);
+		Measure("long options, idle client", socketPath, {"bench", "--option1=a", "--option7", "b", "--option30=c", "file"});
+	}
+	Measure("trailing arguments", socketPath, {"bench", "-v", "--option12=value", "--", "trailing", "arguments"});
+
+	stop.store(true);
+	serverThread.join();
+	return 0;
+}
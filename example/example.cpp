@@ -1,5 +1,8 @@
 #include "../include/crap.hpp"
 
+#include <cstdlib>
+#include <iostream>
+
 int main(int argc, char * argv[])
 {
 	crap::KeyArg programArg(argv[0]);
@@ -5,46 +5,275 @@
 #include <map>
 #include <string>
 #include <cstring>
-#include <iostream>
-#include <algorithm>
+#include <cstddef>
+#include <iosfwd>
+#include <stdexcept>
 #include <memory>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <functional>
+#include <initializer_list>
+#include <exception>
+
+/*
+ * By default library is header-only and all of its functions are inline. If CRAP_SEPARATE_COMPILATION is defined, header
+ * provides only declarations and templates, while definitions are compiled in a single translation unit, which defines
+ * CRAP_IMPLEMENTATION before including the header (see src/crap.cpp).
+ */
+#ifdef CRAP_SEPARATE_COMPILATION
+	#define CRAP_INLINE
+#else
+	#define CRAP_INLINE inline
+#endif
+
+// Headers needed only by definitions are not included by translation units, which use the compiled library.
+#if !defined(CRAP_SEPARATE_COMPILATION) || defined(CRAP_IMPLEMENTATION)
+	#include <iostream>
+	#include <sstream>
+	#include <algorithm>
+	#include <cerrno>
+	#include <cstdlib>
+	#include <cfloat>
+	#include <clocale>
+	#include <cstdio>
+#endif
+
+/*
+ * Command line arguments are scanned with SSE2 instructions, where available. Scanning reads whole aligned blocks, which
+ * may extend past the terminating null character (but never across a page boundary). Define CRAP_NO_SIMD to use scalar
+ * code instead.
+ */
+#if defined(__SSE2__) && !defined(CRAP_NO_SIMD) && !defined(__SANITIZE_ADDRESS__)
+	#define CRAP_SSE2
+	#include <emmintrin.h>
+#endif
+
+/*
+ * By default containers and strings of the library allocate memory on the heap. If CRAP_FIXED_STORAGE is defined to a
+ * number of bytes, they allocate memory from a static buffer of that size instead (see FixedStorage), so that neither
+ * construction of a schema nor parsing calls operator new. Library then uses crap::String and crap::Vector, which are
+ * std::string and std::vector by default, with an allocator, which draws from the buffer. CRAP_FIXED_STORAGE must have
+ * the same value in all translation units.
+ */
 
 // C++RAP - C++ Recursive Argument Processor
 namespace crap {
 
+#ifdef CRAP_FIXED_STORAGE
+
+/**
+ * Fixed-capacity storage. Storage hands out blocks of a static buffer of CRAP_FIXED_STORAGE bytes. Block sizes are rounded
+ * up to powers of two and released blocks are kept in a free list of their size, so that containers, which grow and shrink
+ * between parses, reuse memory. Buffer is zero-initialized, so storage does not need dynamic initialization. Functions are
+ * thread-safe.
+ */
+class FixedStorage
+{
+	public:
+		/**
+		 * Allocate a block.
+		 * @throw CapacityException if buffer is exhausted.
+		 */
+		static void * Allocate(std::size_t size);
+
+		static void Deallocate(void * ptr);
+
+		static constexpr std::size_t Capacity()
+		{
+			return CRAP_FIXED_STORAGE;
+		}
+
+		/**
+		 * Get number of bytes, which have been carved from the buffer. Blocks in free lists are counted as used.
+		 */
+		static std::size_t Used();
+
+	private:
+		enum : std::size_t {
+			HEADER_SIZE = alignof(std::max_align_t) > 16 ? alignof(std::max_align_t) : 16,	///< Header holds size class of a block.
+			MIN_CLASS = 5,	///< Smallest block has 32 bytes.
+			CLASSES = 48
+		};
+
+		struct State
+		{
+			alignas(std::max_align_t) unsigned char buffer[CRAP_FIXED_STORAGE];
+			std::size_t used;
+			unsigned char * freeLists[CLASSES];
+			std::atomic_flag lock;
+		};
+
+		/**
+		 * Lock, which is released when guard goes out of scope.
+		 */
+		struct LockGuard
+		{
+			explicit LockGuard(std::atomic_flag & lock);
+
+			~LockGuard();
+
+			std::atomic_flag & lock;
+		};
+
+		static State & GetState();
+};
+
+/**
+ * Allocator of containers, which draws from FixedStorage.
+ */
+template <typename T>
+class FixedAllocator
+{
+	public:
+	    typedef T value_type;
+
+		FixedAllocator() = default;
+
+		template <typename U>
+		FixedAllocator(const FixedAllocator<U> & )
+		{
+		}
+
+		T * allocate(std::size_t n)
+		{
+			return static_cast<T *>(FixedStorage::Allocate(n * sizeof(T)));
+		}
+
+		void deallocate(T * ptr, std::size_t )
+		{
+			FixedStorage::Deallocate(ptr);
+		}
+
+		template <typename U>
+		struct rebind
+		{
+			typedef FixedAllocator<U> other;
+		};
+};
+
+template <typename T, typename U>
+bool operator ==(const FixedAllocator<T> & , const FixedAllocator<U> & )
+{
+	return true;
+}
+
+template <typename T, typename U>
+bool operator !=(const FixedAllocator<T> & , const FixedAllocator<U> & )
+{
+	return false;
+}
+
+/**
+ * Deleter of objects created by New().
+ */
+template <typename T>
+struct FixedDeleter
+{
+	FixedDeleter() = default;
+
+	template <typename U>
+	FixedDeleter(const FixedDeleter<U> & )
+	{
+	}
+
+	void operator ()(T * ptr) const
+	{
+		// Block starts at the most derived object, which may not be at the address of its base.
+		void * block = MostDerived(ptr, typename std::is_polymorphic<T>::type());
+		ptr->~T();
+		FixedStorage::Deallocate(block);
+	}
+
+	static void * MostDerived(T * ptr, std::true_type )
+	{
+		return dynamic_cast<void *>(ptr);
+	}
+
+	static void * MostDerived(T * ptr, std::false_type )
+	{
+		return ptr;
+	}
+};
+
+template <typename T>
+using Allocator = FixedAllocator<T>;
+
+template <typename T>
+using Deleter = FixedDeleter<T>;
+
+/**
+ * Create an object in the storage used by the library.
+ */
+template <typename T, typename... Args>
+T * New(Args &&... args)
+{
+	void * block = FixedStorage::Allocate(sizeof(T));
+	try {
+		return new (block) T(std::forward<Args>(args)...);
+	} catch (...) {
+		FixedStorage::Deallocate(block);
+		throw;
+	}
+}
+
+#else
+
+template <typename T>
+using Allocator = std::allocator<T>;
+
+template <typename T>
+using Deleter = std::default_delete<T>;
+
+template <typename T, typename... Args>
+T * New(Args &&... args)
+{
+	return new T(std::forward<Args>(args)...);
+}
+
+#endif
+
+typedef std::basic_string<char, std::char_traits<char>, Allocator<char>> String;
+
+template <typename T>
+using Vector = std::vector<T, Allocator<T>>;
+
 class Exception:
         public std::runtime_error
 {
 	public:
-		explicit Exception(const std::string & what);
+		explicit Exception(const String & what);
+
+		explicit Exception(const char * what);
 };
 
 class ExcessiveCmdException:
         public Exception
 {
 	public:
-		explicit ExcessiveCmdException(const std::string & what);
+		explicit ExcessiveCmdException(const String & what);
 };
 
 class ArgAlreadySetException:
         public Exception
 {
 	public:
-		explicit ArgAlreadySetException(const std::string & what);
+		explicit ArgAlreadySetException(const String & what);
 };
 
 class ArgRequiresValueException:
         public Exception
 {
 	public:
-		explicit ArgRequiresValueException(const std::string & what);
+		explicit ArgRequiresValueException(const String & what);
 };
 
 class UnrecognizedArgException:
         public Exception
 {
 	public:
-		explicit UnrecognizedArgException(const std::string & what, int argNum);
+		explicit UnrecognizedArgException(const String & what, int argNum);
 
 		int argNum() const;
 
@@ -56,1194 +285,5719 @@ class MissingArgException:
         public Exception
 {
 	public:
-		explicit MissingArgException(const std::string & what);
+		explicit MissingArgException(const String & what);
 };
 
-class Arg
+class ConstraintViolationException:
+        public Exception
 {
-	friend class Parser;
-	friend class ArgGroup;
-
 	public:
-	    bool isSet() const;
-
-		const std::string & help() const;
-
-		void setHelp(const std::string & help);
+		explicit ConstraintViolationException(const String & what);
+};
 
-		bool required() const;
+class AmbiguousArgException:
+        public Exception
+{
+	public:
+		explicit AmbiguousArgException(const String & what, int argNum);
 
-		void setRequired(bool required);
+		int argNum() const;
 
-	protected:
-		explicit Arg(const std::string & help);
+	private:
+		int m_argNum;
+};
 
+/**
+ * Exception thrown when fixed-capacity storage is exhausted (see FixedStorage).
+ */
+class CapacityException:
+        public Exception
+{
+	public:
 		/**
-		 * Mark argument as being set.
+		 * Constructor. Message is not copied into a String, since there may be no storage left for it.
 		 */
-		void markSet(const std::string & argName);
-
-		virtual int match(char ** argv, int argc) = 0;
+		explicit CapacityException(const char * what);
+};
 
-		virtual std::string synopsis() const = 0;
+class InvalidArgValueException:
+        public Exception
+{
+	friend class Parser;
 
-		virtual std::string options() const = 0;
+	public:
+		explicit InvalidArgValueException(const String & what, int argNum = -1);
 
-		virtual std::string description() const = 0;
+		/**
+		 * Get index of command line argument carrying invalid value.
+		 * @return index of an argument or -1 if value has not been passed through a parser.
+		 */
+		int argNum() const;
 
 	private:
-		std::string m_help;
-		bool m_required;
-		bool m_set;
+		int m_argNum;
 };
 
-class ValueArg:
-    public Arg
+class Arg;
+
+/**
+ * Parse error reported by Parser::lint(). Each error code corresponds to an exception thrown by Parser::parse().
+ */
+struct ParseError
 {
-	friend class Parser;
-	friend class ArgGroup;
+	enum Code {
+		UNRECOGNIZED_ARG,	///< UnrecognizedArgException.
+		AMBIGUOUS_ARG,		///< AmbiguousArgException.
+		ARG_ALREADY_SET,	///< ArgAlreadySetException.
+		ARG_REQUIRES_VALUE,	///< ArgRequiresValueException or loose argument value starting with Parser::GLUE_CHAR.
+		EXCESSIVE_CMD,		///< ExcessiveCmdException.
+		MISSING_ARG,		///< MissingArgException.
+		INVALID_ARG_VALUE,	///< InvalidArgValueException raised by a validator.
+		CONSTRAINT_VIOLATION	///< ConstraintViolationException. Error refers to the first argument of a constraint.
+	};
+
+	ParseError(Code code, int argNum, const Arg * arg);
+
+	Code code;
+	int argNum;			///< Index of command line argument, which caused an error. Missing arguments are reported at the index, at which their command has been left.
+	const Arg * arg;	///< Argument related to an error or @p nullptr if there is no such argument (e.g. unrecognized argument or none of the required commands present).
+};
 
+typedef Vector<ParseError> ParseErrorsContainer;
+
+/**
+ * Set of bits, which correspond to densely indexed arguments. Sets of up to INLINE_WORDS * WORD_BITS bits are stored inline,
+ * without allocating memory on the heap.
+ */
+class Bitset
+{
 	public:
-	    explicit ValueArg(const std::string & valueName, const std::string & help = "");
+	    typedef unsigned long long Word;
 
-	    const std::string & value() const;
+		static constexpr std::size_t WORD_BITS = sizeof(Word) * 8;
 
-		const std::string & valueName() const;
+		static constexpr std::size_t INLINE_WORDS = 2;
 
-		ValueArg & setValueName(const std::string & valueName);
+		explicit Bitset(std::size_t size = 0);
 
-		const std::string & defaultValue() const;
+		std::size_t size() const;
 
-		ValueArg & setDefaultValue(const std::string & val);
+		void resize(std::size_t size);
 
-	protected:
-		int match(char ** argv, int argc) override;
+		void set(std::size_t index);
 
-		std::string synopsis() const override;
+		bool test(std::size_t index) const;
 
-		std::string options() const override;
+		void clear();
+
+		std::size_t wordCount() const;
+
+		Word word(std::size_t index) const;
+
+		/**
+		 * Get index of the first bit set.
+		 * @return index of the first bit set or size() if no bits are set.
+		 */
+		std::size_t findFirst() const;
+
+		/**
+		 * Intersect with another set of the same size.
+		 */
+		Bitset & operator &=(const Bitset & other);
 
-		std::string description() const override;
+		/**
+		 * Check whether set has any bits in common with another set of the same size.
+		 */
+		bool intersects(const Bitset & other) const;
 
-		void setValue(const std::string & value);
+		/**
+		 * Count bits, which are set in both this and other set of the same size.
+		 */
+		std::size_t intersectionCount(const Bitset & other) const;
 
 	private:
-		std::string m_valueName;
-		std::string m_value;
-		std::string m_defaultValue;
-};
+		static std::size_t WordCount(std::size_t size);
 
+		Word * words();
 
-class KeyArg:
-    public Arg
-{
-	friend class Parser;
-	friend class ArgGroup;
+		const Word * words() const;
+
+		std::size_t m_size;
+		Word m_inlineWords[INLINE_WORDS];
+		Vector<Word> m_heapWords;
+};
 
+/**
+ * Pool of interned strings. Each distinct string is stored once and it is identified by an integer, so that strings can be
+ * compared by comparing their identifiers. Strings are kept in a contiguous buffer and looked up by hash.
+ */
+class StringPool
+{
 	public:
-	    typedef std::vector<std::string> AliasesContainer;
+	    typedef std::uint32_t Id;
 
-	    explicit KeyArg(const std::string & name, const std::string & help = "");
+		enum : Id {
+			NO_ID = 0xFFFFFFFF	///< Identifier, which does not refer to any string.
+		};
 
-	    const std::string & name() const;
+		StringPool();
 
-		const AliasesContainer & aliases() const;
+		/**
+		 * Intern a string. Identifiers are assigned consecutively, starting from 0.
+		 * @return identifier of a string.
+		 */
+		Id intern(const char * str, std::size_t length);
 
-		KeyArg & addAlias(const std::string & alias);
+		Id intern(const String & str);
 
-	protected:
-		int match(char ** argv, int argc) override;
+		/**
+		 * Find a string without interning it.
+		 * @return identifier of a string or NO_ID if string has not been interned.
+		 */
+		Id find(const char * str, std::size_t length) const;
 
-		std::string synopsis() const override;
+		std::size_t size() const;
+
+		/**
+		 * Get interned string.
+		 * @return null-terminated string. Pointer is valid until another string is interned or pool is cleared.
+		 */
+		const char * str(Id id) const;
 
-		std::string options() const override;
+		std::size_t length(Id id) const;
 
-		std::string description() const override;
+		void clear();
 
-		char gluableChar() const;
+		/**
+		 * Rebuild hash table, inserting strings in a given order. Strings inserted earlier are more likely to be found at their
+		 * home slots, so frequently looked up strings should come first. Identifiers are not changed.
+		 * @param ids permutation of all the identifiers.
+		 */
+		void prioritize(const Vector<Id> & ids);
 
 	private:
-		char m_gluableChar;
-		AliasesContainer m_aliases;
-};
+		typedef Vector<std::uint32_t> OffsetsContainer;
+		typedef Vector<Id> SlotsContainer;
 
-class KeyValueArg:
-    public Arg
-{
-	friend class Parser;
-	friend class ArgGroup;
+		static std::size_t Hash(const char * str, std::size_t length);
 
-	public:
-	    typedef std::vector<std::string> AliasesContainer;
+		/**
+		 * Find slot, which holds a string or empty slot, in which string should be placed.
+		 */
+		std::size_t slot(const char * str, std::size_t length) const;
 
-	    KeyValueArg(const std::string & name, const std::string & valueName, const std::string & help = "");
+		void rehash(std::size_t slotCount);
 
-		const std::string & name() const;
+		String m_bytes;
+		OffsetsContainer m_offsets;	///< Offsets of strings within m_bytes.
+		SlotsContainer m_slots;		///< Open addressing hash table of identifiers. Number of slots is a power of two.
+};
 
-		const AliasesContainer & aliases() const;
+/**
+ * Value validator. Validators are attached to arguments carrying values and they are run, when value is being set. Value
+ * rejected by a validator results in InvalidArgValueException.
+ */
+class Validator
+{
+	public:
+	    virtual ~Validator() = default;
 
-		KeyValueArg & addAlias(const std::string & alias);
+		/**
+		 * Validate value.
+		 * @return @p true if value is valid, @p false otherwise.
+		 */
+		virtual bool validate(const char * value) const = 0;
 
-		const std::string & value() const;
+		/**
+		 * Describe valid values. Description is used in error messages (e.g. "integer from 1 to 10").
+		 */
+		virtual String description() const = 0;
+};
 
-		const std::string & valueName() const;
+/**
+ * Validator, which accepts values from a set. Values are interned in a string pool, so that validation is a single hash
+ * lookup.
+ */
+class EnumValidator:
+    public Validator
+{
+	public:
+	    typedef Vector<String> ValuesContainer;
 
-		KeyValueArg & setValueName(const std::string & valueName);
+	    explicit EnumValidator(const ValuesContainer & values = ValuesContainer());
 
-		const std::string & defaultValue() const;
+		EnumValidator & addValue(const String & value);
 
-		KeyValueArg & setDefaultValue(const std::string & val);
+		bool validate(const char * value) const override;
 
-	protected:
-		int match(char ** argv, int argc) override;
+		String description() const override;
 
-		std::string synopsis() const override;
+	private:
+		StringPool m_values;
+};
 
-		std::string options() const override;
+/**
+ * Validator, which accepts numbers within a closed range.
+ */
+class RangeValidator:
+    public Validator
+{
+	public:
+	    /**
+		 * Constructor.
+		 * @param min minimal value.
+		 * @param max maximal value.
+		 * @param integral whether only integers are accepted.
+		 */
+	    RangeValidator(long double min, long double max, bool integral = false);
 
-		std::string description() const override;
+		bool validate(const char * value) const override;
 
-		void setValue(const std::string & value);
+		String description() const override;
 
 	private:
-		AliasesContainer m_aliases;
-		std::string m_valueName;
-		std::string m_value;
-		std::string m_defaultValue;
+		long double m_min;
+		long double m_max;
+		bool m_integral;
 };
 
-class Parser;
-
 /**
- * Argument group.
- *
- * There are three types of arguments: key-value arguments (KeyValueArg), value-only arguments (ValueArg) and key-only arguments or flags (KeyArg).
- *
- * Additionaly there are two categories of arguments: commands and attributes. Main differences are as follows.
- *		- Only a single non-required command can be present (otherwise ExcessiveCmdException will be thrown).
- *		- Attributes act as terminals, while commands can have their own groups of sub-arguments.
- *		- Attribute types are distinguishable, which enables type-specific features to be used with them (such as KeyArg gluing).
- *		.
+ * Validator, which accepts values matching a wildcard pattern. Character '*' matches any sequence of characters and
+ * character '?' matches any single character.
  */
-class ArgGroup
+class PatternValidator:
+    public Validator
 {
-	friend class Parser;
-
 	public:
-	    ArgGroup(const std::string & name = "");
+	    explicit PatternValidator(const String & pattern);
 
-		void setName(const std::string & name);
+		bool validate(const char * value) const override;
 
-		std::string name() const;
+		String description() const override;
 
-		void setOptionRequired(bool optionRequired);
+	private:
+		String m_pattern;
+};
 
-		bool optionRequired() const;
+class ArgGroup;
 
-		ArgGroup & addAttr(ValueArg * arg);
+class Parser;
 
-		ArgGroup & addAttr(KeyArg * arg);
+class Arg
+{
+	friend class Parser;
+	friend class ArgGroup;
+	friend class Settings;
+	friend class ParseRecord;
+	friend class ParseServer;
 
-		ArgGroup & addAttr(KeyValueArg * arg);
+	public:
+	    virtual ~Arg();
 
-		Parser * addCmd(Arg * cmd);
+		bool isSet() const;
 
-	protected:
-		typedef std::vector<std::unique_ptr<Parser>> ParsersContainer;
-		typedef std::vector<ValueArg *> ValueAttrsContainer;
-		typedef std::vector<KeyArg *> KeyAttrsContainer;
-		typedef std::vector<KeyValueArg *> KeyValueAttrsContainer;
+		const String & help() const;
 
-		void markOptionSet(Arg * cmd);
+		void setHelp(const String & help);
 
-		Arg * optionSet() const;
+		bool required() const;
 
-		ParsersContainer & parsers();
+		void setRequired(bool required);
 
-		ValueAttrsContainer & valueAttrs();
+	protected:
+		typedef Vector<const Validator *> ValidatorsContainer;
 
-		KeyAttrsContainer & keyAttrs();
+		explicit Arg(const String & help);
 
-		KeyValueAttrsContainer & keyValueAttrs();
+		/**
+		 * Copy constructor. Copy does not belong to groups of the original argument and it is not a command of any parser.
+		 */
+		Arg(const Arg & other);
 
-		bool gluedKeyArgs(const char * arg) const;
+		Arg & operator =(const Arg & other);
 
-		std::string optionalCmdsSynopsis() const;
+		void addValidator(const Validator * validator);
 
-		std::string synopsis(std::map<const void *, std::string> & synopsisLines) const;
+		/**
+		 * Find validator, which rejects a value.
+		 * @return first validator, which rejects a value or @p nullptr if value is valid.
+		 */
+		const Validator * rejectingValidator(const char * value) const;
 
-		std::string description(std::map<const void *, std::string> & descriptionParagraphs) const;
+		/**
+		 * Validate value.
+		 * @throw InvalidArgValueException if value is rejected by any of the validators.
+		 */
+		void validateValue(const char * value) const;
 
-	private:
-		std::string m_name;
-		bool m_optionRequired;
-		Arg * m_optionSet;
-		ParsersContainer m_parsers;
-		ValueAttrsContainer m_valueAttrs;
-		KeyAttrsContainer m_keyAttrs;
-		KeyValueAttrsContainer m_keyValueAttrs;
+		/**
+		 * Mark argument as being set.
+		 */
+		void markSet(const String & argName);
+
+		void markSet(const char * argName);
+
+		/**
+		 * Reset argument to its initial, unset state.
+		 */
+		virtual void reset();
+
+		virtual int match(char ** argv, int argc) = 0;
+
+		/**
+		 * Check if argument matches given command line argument. Unlike match(), this function does not modify the argument.
+		 * Default implementation returns @p false.
+		 */
+		virtual bool matches(const char * arg) const;
+
+		/**
+		 * Check if argument matches given command line argument, but expects its value to be passed as the next command line
+		 * argument.
+		 */
+		virtual bool expectsValue(const char * arg) const;
+
+		/**
+		 * Check if value can be converted to the type of an argument. Parser uses this function in lint mode, where values
+		 * are checked, but not set. Default implementation returns @p true.
+		 */
+		virtual bool convertible(const char * value) const;
+
+		/**
+		 * Get argument value.
+		 * @return pointer to argument value or @p nullptr if argument does not carry a value. Default implementation returns
+		 * @p nullptr.
+		 */
+		virtual const String * valuePtr() const;
+
+		/**
+		 * Get value, which has been given to an argument, without falling back to a default value.
+		 * @return pointer to given value or @p nullptr if argument does not carry a value. Default implementation returns
+		 * valuePtr().
+		 */
+		virtual const String * givenValuePtr() const;
+
+		/**
+		 * Get aliases of an argument. Aliases are used to build lookup tables, which allow to find arguments without calling
+		 * match().
+		 * @return pointer to aliases or @p nullptr if argument can not be looked up by aliases. Default implementation returns
+		 * @p nullptr.
+		 */
+		virtual const Vector<String> * keys() const;
+
+		virtual String synopsis() const = 0;
+
+		virtual String options() const = 0;
+
+		virtual String description() const = 0;
+
+		/**
+		 * Increment schema revisions of parsers, which use the argument.
+		 */
+		void touchSchema();
+
+	private:
+		typedef Vector<std::shared_ptr<ArgGroup *>> GroupsContainer;
+		typedef Vector<Parser *> ParsersContainer;
+
+		String m_help;
+		bool m_required;
+		bool m_set;
+		ValidatorsContainer m_validators;
+		GroupsContainer m_groups;			///< Links to groups containing the argument.
+		ParsersContainer m_cmdParsers;		///< Parsers, which use the argument as their command.
+};
+
+class ValueArg:
+    public Arg
+{
+	friend class Parser;
+	friend class ArgGroup;
+	friend class ParseRecord;
+
+	public:
+	    typedef std::function<String()> DefaultValueFunction;
+
+	    explicit ValueArg(const String & valueName, const String & help = "");
+
+	    const String & value() const;
+
+		const String & valueName() const;
+
+		ValueArg & setValueName(const String & valueName);
+
+		/**
+		 * Get default value. If default value is provided by a function, function is called on first access and its result
+		 * is memoized.
+		 */
+		const String & defaultValue() const;
+
+		ValueArg & setDefaultValue(const String & val);
+
+		/**
+		 * Set function, which provides default value. Function is not called until default value is needed, which is when
+		 * value() is read while argument is not set. Note that Settings snapshot reads values of all the arguments.
+		 * @param function function, which computes default value.
+		 * @param placeholder text displayed in help instead of default value (e.g. "number of CPUs"). If empty, default
+		 * value is not displayed.
+		 */
+		ValueArg & setDefaultValue(DefaultValueFunction function, const String & placeholder = "");
+
+		/**
+		 * Add validator. Validators are run in the order, in which they have been added, whenever value is set.
+		 * @param validator validator. Validator is not owned by the argument and it must remain valid while argument is used.
+		 */
+		ValueArg & addValidator(const Validator * validator);
+
+	protected:
+		void reset() override;
+
+		int match(char ** argv, int argc) override;
+
+		bool matches(const char * arg) const override;
+
+		const String * valuePtr() const override;
+
+		const String * givenValuePtr() const override;
+
+		String synopsis() const override;
+
+		String options() const override;
+
+		String description() const override;
+
+		virtual void setValue(const char * value);
+
+	private:
+		String m_valueName;
+		String m_value;
+		mutable String m_defaultValue;
+		DefaultValueFunction m_defaultValueFunction;
+		mutable bool m_defaultValuePending;		///< Whether default value function has to be called.
+		String m_defaultValuePlaceholder;
+};
+
+
+class KeyArg:
+    public Arg
+{
+	friend class Parser;
+	friend class ArgGroup;
+	friend class ParseRecord;
+
+	public:
+	    typedef Vector<String> AliasesContainer;
+
+	    explicit KeyArg(const String & name, const String & help = "");
+
+	    const String & name() const;
+
+		const AliasesContainer & aliases() const;
+
+		KeyArg & addAlias(const String & alias);
+
+	protected:
+		int match(char ** argv, int argc) override;
+
+		bool matches(const char * arg) const override;
+
+		const AliasesContainer * keys() const override;
+
+		String synopsis() const override;
+
+		String options() const override;
+
+		String description() const override;
+
+		/**
+		 * Set argument, which has been matched by one of its aliases.
+		 * @param key alias, by which argument has been matched.
+		 */
+		virtual void setKey(const char * key);
+
+		char gluableChar() const;
+
+	private:
+		char m_gluableChar;
+		AliasesContainer m_aliases;
+};
+
+class KeyValueArg:
+    public Arg
+{
+	friend class Parser;
+	friend class ArgGroup;
+	friend class ParseRecord;
+
+	public:
+	    typedef Vector<String> AliasesContainer;
+
+	    typedef std::function<String()> DefaultValueFunction;
+
+	    KeyValueArg(const String & name, const String & valueName, const String & help = "");
+
+		const String & name() const;
+
+		const AliasesContainer & aliases() const;
+
+		KeyValueArg & addAlias(const String & alias);
+
+		const String & value() const;
+
+		const String & valueName() const;
+
+		KeyValueArg & setValueName(const String & valueName);
+
+		/**
+		 * Get default value. If default value is provided by a function, function is called on first access and its result
+		 * is memoized.
+		 */
+		const String & defaultValue() const;
+
+		KeyValueArg & setDefaultValue(const String & val);
+
+		/**
+		 * Set function, which provides default value. Function is not called until default value is needed, which is when
+		 * value() is read while argument is not set. Note that Settings snapshot reads values of all the arguments.
+		 * @param function function, which computes default value.
+		 * @param placeholder text displayed in help instead of default value (e.g. "number of CPUs"). If empty, default
+		 * value is not displayed.
+		 */
+		KeyValueArg & setDefaultValue(DefaultValueFunction function, const String & placeholder = "");
+
+		/**
+		 * Add validator. Validators are run in the order, in which they have been added, whenever value is set.
+		 * @param validator validator. Validator is not owned by the argument and it must remain valid while argument is used.
+		 */
+		KeyValueArg & addValidator(const Validator * validator);
+
+	protected:
+		void reset() override;
+
+		int match(char ** argv, int argc) override;
+
+		bool matches(const char * arg) const override;
+
+		bool expectsValue(const char * arg) const override;
+
+		const String * valuePtr() const override;
+
+		const String * givenValuePtr() const override;
+
+		const AliasesContainer * keys() const override;
+
+		String synopsis() const override;
+
+		String options() const override;
+
+		String description() const override;
+
+		virtual void setValue(const char * value);
+
+	private:
+		AliasesContainer m_aliases;
+		String m_valueName;
+		String m_value;
+		mutable String m_defaultValue;
+		DefaultValueFunction m_defaultValueFunction;
+		mutable bool m_defaultValuePending;		///< Whether default value function has to be called.
+		String m_defaultValuePlaceholder;
+};
+
+/**
+ * Convert a number at the beginning of a string.
+ * @return pointer to the first character following the number or @p nullptr if number can not be converted.
+ */
+template <typename T>
+const char * ConvertNumber(const char * str, T & number, std::true_type isIntegral);
+
+template <typename T>
+const char * ConvertNumber(const char * str, T & number, std::false_type isIntegral);
+
+/**
+ * Convert a number at the beginning of a range of characters. Numbers are converted in the same way regardless of the current
+ * locale (decimal point is always '.').
+ * @param end end of the range. Characters following the number, which are within the range, may be read.
+ * @return pointer to the first character following the number or @p nullptr if number can not be converted.
+ */
+template <typename T>
+const char * ConvertNumber(const char * str, const char * end, T & number, std::true_type isIntegral);
+
+template <typename T>
+const char * ConvertNumber(const char * str, const char * end, T & number, std::false_type isIntegral);
+
+/**
+ * Convert a floating point number at the beginning of a range of characters. Number is scanned according to the grammar of
+ * std::strtod() in the "C" locale.
+ * @return pointer to the first character following the number or @p nullptr if number can not be converted.
+ */
+const char * ConvertFloat(const char * str, const char * end, float & number);
+
+const char * ConvertFloat(const char * str, const char * end, double & number);
+
+const char * ConvertFloat(const char * str, const char * end, long double & number);
+
+std::size_t CountDelimiters(const char * str, const char * end, char delimiter);
+
+/**
+ * Split a range of characters at delimiters.
+ * @param function function invoked with the beginning and the end of each element. Splitting stops, when function returns
+ * @p false.
+ * @return @p false if splitting has been stopped by the function.
+ */
+template <typename F>
+bool SplitList(const char * str, const char * end, char delimiter, F function);
+
+/**
+ * Key-value argument, which value is a list of numbers separated by a delimiter (e.g. "ids=1,5,9"). Numbers are converted into
+ * a contiguous container, while argument is being matched. Value, which can not be converted, results in
+ * InvalidArgValueException. Default value is only displayed in help, it is not converted.
+ * @tparam T type of list elements. Integral and floating point types are supported.
+ */
+template <typename T>
+class ListArg:
+    public KeyValueArg
+{
+	friend class Parser;
+
+	public:
+	    typedef Vector<T> ValuesContainer;
+
+	    ListArg(const String & name, const String & valueName, const String & help = "", char delimiter = ',');
+
+		/**
+		 * Get list elements.
+		 * @return elements of a list or empty container if argument has not been set.
+		 */
+		const ValuesContainer & values() const;
+
+		char delimiter() const;
+
+		ListArg & setDelimiter(char delimiter);
+
+	protected:
+		void reset() override;
+
+		void setValue(const char * value) override;
+
+		bool convertible(const char * value) const override;
+
+	private:
+		/**
+		 * Convert list elements.
+		 * @param values container, to which elements are appended, or @p nullptr if elements are only checked.
+		 * @param invalidElement string, to which the first invalid element is assigned, or @p nullptr.
+		 * @return @p false if any of the elements can not be converted.
+		 */
+		bool convert(const char * value, ValuesContainer * values, String * invalidElement) const;
+
+		ValuesContainer m_values;
+		char m_delimiter;
+};
+
+typedef ListArg<long long> IntListArg;
+
+typedef ListArg<double> FloatListArg;
+
+/**
+ * Format a value as a string. Arithmetic values are formatted as by std::ostream in the classic locale, except that
+ * character types are formatted as numbers.
+ */
+template <typename T>
+String FormatValue(const T & value);
+
+String FormatValue(const String & value);
+
+String FormatValue(long long value);
+
+String FormatValue(unsigned long long value);
+
+String FormatValue(long double value);
+
+/**
+ * Convert a whole string to a value of a bound argument.
+ * @return @p false if string is not a number or it does not fit into the type.
+ */
+template <typename T>
+bool ConvertBoundValue(const char * str, T & value);
+
+bool ConvertBoundValue(const char * str, String & value);
+
+/**
+ * Key-value argument bound to a variable. Value is converted and written to the variable, while argument is being matched.
+ * Value, which can not be converted, results in InvalidArgValueException and leaves the variable intact. Variable is not
+ * modified by reset(), so its value at the time argument is constructed acts as a default value.
+ * @tparam T type of variable. Arithmetic types and crap::String (std::string by default) are supported.
+ */
+template <typename T>
+class BoundKeyValueArg:
+    public KeyValueArg
+{
+	public:
+	    /**
+		 * Constructor.
+		 * @param name name of an argument.
+		 * @param target variable, to which argument is bound. Variable must remain valid while argument is used.
+		 * @param valueName name of a value.
+		 * @param help help.
+		 */
+	    BoundKeyValueArg(const String & name, T & target, const String & valueName, const String & help = "");
+
+		T & target() const;
+
+	protected:
+		void setValue(const char * value) override;
+
+		bool convertible(const char * value) const override;
+
+	private:
+		T * m_target;
+};
+
+/**
+ * Value-only argument bound to a variable.
+ * @see BoundKeyValueArg.
+ */
+template <typename T>
+class BoundValueArg:
+    public ValueArg
+{
+	public:
+	    BoundValueArg(const String & valueName, T & target, const String & help = "");
+
+		T & target() const;
+
+	protected:
+		void setValue(const char * value) override;
+
+		bool convertible(const char * value) const override;
+
+	private:
+		T * m_target;
+};
+
+/**
+ * Key-only argument bound to a boolean variable. Variable is set to @p true, when argument is matched.
+ */
+class BoundKeyArg:
+    public KeyArg
+{
+	public:
+	    BoundKeyArg(const String & name, bool & target, const String & help = "");
+
+		bool & target() const;
+
+	protected:
+		void setKey(const char * key) override;
+
+	private:
+		bool * m_target;
 };
 
-/**
- * Arguments parser. Each parser is associated with one command argument. To proceed with parsing the command argument must
- * match the argument passed to the program. Root parser should define program name (argv[0]) as its command argument to be
- * able to process the rest of arguments. The command argument can be set by setCmd() function or it can be passed to the constructor.
- *
- * Command argument can have any number of sub-arguments. Sub-arguments are organized into groups, which are defined by ArgGroup class.
- * For convenience parser provides a default group of sub-arguments. Additional argument groups can be added to the parser. During
- * parsing a parser will try to match arguments defined within the groups. If groups contain command arguments, they will be processed
- * recursively.
- */
-class Parser
+/**
+ * Argument group.
+ *
+ * There are three types of arguments: key-value arguments (KeyValueArg), value-only arguments (ValueArg) and key-only arguments or flags (KeyArg).
+ *
+ * Additionaly there are two categories of arguments: commands and attributes. Main differences are as follows.
+ *		- Only a single non-required command can be present (otherwise ExcessiveCmdException will be thrown).
+ *		- Attributes act as terminals, while commands can have their own groups of sub-arguments.
+ *		- Attribute types are distinguishable, which enables type-specific features to be used with them (such as KeyArg gluing).
+ *		.
+ */
+class ArgGroup
+{
+	friend class Arg;
+	friend class Parser;
+	friend class Settings;
+	friend class ParseRecord;
+	friend class ParseServer;
+
+	public:
+	    ArgGroup(const String & name = "");
+
+		ArgGroup(const ArgGroup & other) = delete;
+
+		ArgGroup & operator =(const ArgGroup & other) = delete;
+
+		~ArgGroup();
+
+		void setName(const String & name);
+
+		String name() const;
+
+		void setOptionRequired(bool optionRequired);
+
+		bool optionRequired() const;
+
+		ArgGroup & addAttr(ValueArg * arg);
+
+		ArgGroup & addAttr(KeyArg * arg);
+
+		ArgGroup & addAttr(KeyValueArg * arg);
+
+		Parser * addCmd(Arg * cmd);
+
+		/**
+		 * Add dependency. If argument is set, then required argument must be set as well. Constraints are checked by the
+		 * parser containing the group, when it has been done with its arguments. Constrained arguments may belong to any
+		 * group of that parser.
+		 */
+		ArgGroup & addDependency(const Arg * arg, const Arg * requiredArg);
+
+		/**
+		 * Add mutual exclusion. At most one of the arguments can be set.
+		 */
+		ArgGroup & addMutualExclusion(const Vector<const Arg *> & args);
+
+		/**
+		 * Add conflict. Arguments can not be set both at the same time.
+		 */
+		ArgGroup & addConflict(const Arg * arg, const Arg * otherArg);
+
+	protected:
+		struct Constraint
+		{
+			enum Kind {
+				DEPENDENCY,			///< First argument requires the second one.
+				MUTUAL_EXCLUSION	///< At most one of the arguments can be set.
+			};
+
+			Kind kind;
+			Vector<const Arg *> args;
+		};
+
+		typedef Vector<Constraint> ConstraintsContainer;
+		typedef Vector<std::unique_ptr<Parser, Deleter<Parser>>> ParsersContainer;
+		typedef Vector<ValueArg *> ValueAttrsContainer;
+		typedef Vector<KeyArg *> KeyAttrsContainer;
+		typedef Vector<KeyValueArg *> KeyValueAttrsContainer;
+
+		void markOptionSet(Arg * cmd);
+
+		Arg * optionSet() const;
+
+		ParsersContainer & parsers();
+
+		ValueAttrsContainer & valueAttrs();
+
+		KeyAttrsContainer & keyAttrs();
+
+		KeyValueAttrsContainer & keyValueAttrs();
+
+		const ConstraintsContainer & constraints() const;
+
+		void reset();
+
+		String optionalCmdsSynopsis() const;
+
+		/**
+		 * Append synopsis to @a result. Output is appended rather than returned, so that synopses of nested parsers are not
+		 * copied at each level of nesting.
+		 */
+		void synopsis(std::map<const void *, String> & synopsisLines, String & result) const;
+
+		/**
+		 * Append description to @a result.
+		 */
+		void description(std::map<const void *, String> & descriptionParagraphs, String & result) const;
+
+		/**
+		 * Increment schema revisions of parsers containing the group.
+		 */
+		void touchSchema();
+
+	private:
+		typedef Vector<Parser *> OwnersContainer;
+
+		void linkArg(Arg * arg);
+
+		String m_name;
+		bool m_optionRequired;
+		Arg * m_optionSet;
+		ParsersContainer m_parsers;
+		ValueAttrsContainer m_valueAttrs;
+		KeyAttrsContainer m_keyAttrs;
+		KeyValueAttrsContainer m_keyValueAttrs;
+		ConstraintsContainer m_constraints;
+		OwnersContainer m_owners;	///< Parsers containing the group.
+		std::shared_ptr<ArgGroup *> m_link;	///< Link held by arguments of the group. It is reset, when group is destroyed.
+		bool m_touching;			///< Guards against cycles formed by groups shared with parsers of their own commands.
+};
+
+/**
+ * Arguments parser. Each parser is associated with one command argument. To proceed with parsing the command argument must
+ * match the argument passed to the program. Root parser should define program name (argv[0]) as its command argument to be
+ * able to process the rest of arguments. The command argument can be set by setCmd() function or it can be passed to the constructor.
+ *
+ * Command argument can have any number of sub-arguments. Sub-arguments are organized into groups, which are defined by ArgGroup class.
+ * For convenience parser provides a default group of sub-arguments. Additional argument groups can be added to the parser. During
+ * parsing a parser will try to match arguments defined within the groups. If groups contain command arguments, they will be processed
+ * recursively.
+ *
+ * Long options (aliases starting with "--") of key-value and key-only arguments can be abbreviated, as long as abbreviation is
+ * unambiguous within the parser, which is currently processing arguments. If it is not, AmbiguousArgException is thrown.
+ */
+class Parser
+{
+	friend class Arg;
+	friend class ArgGroup;
+	friend class Settings;
+	friend class ParseRecord;
+	friend class ParseCache;
+	friend class ParseServer;
+
+	public:
+	    typedef std::map<String, unsigned long> LookupProfile;
+
+	    static constexpr char GLUE_CHAR = '-';
+
+		/**
+		 * Argument, which ends options. Arguments following it are not matched.
+		 */
+		static constexpr const char * END_OF_OPTIONS = "--";
+
+		/**
+		 * View of a contiguous range of command line arguments. Arguments are not copied.
+		 */
+		struct ArgvSpan
+		{
+			ArgvSpan();
+
+			ArgvSpan(char ** argv, int argc);
+
+			bool empty() const;
+
+			char ** argv;	///< First argument of the range or @p nullptr if range is empty.
+			int argc;		///< Number of arguments in the range.
+		};
+
+		Parser(Arg * cmdArg);
+
+		Parser(const Parser & other) = delete;
+
+		Parser & operator =(const Parser & other) = delete;
+
+		~Parser();
+
+		/**
+		 * Get schema revision. Revision is incremented whenever arguments, groups or sub-commands of the parser are modified
+		 * in a way, which invalidates lookup tables built upon them or which may change results of parsing (e.g. validators,
+		 * required flags or list delimiters). Modifications of nested parsers increment revisions of enclosing parsers as
+		 * well, so revision of the root parser covers the whole schema.
+		 */
+		unsigned long schemaRevision() const;
+
+		void setOptionRequired(bool cmdRequired);
+
+		bool optionRequired() const;
+
+		Parser & addAttr(ValueArg * arg);
+
+		Parser & addAttr(KeyArg * arg);
+
+		Parser & addAttr(KeyValueArg * arg);
+
+		Parser & addArgGroup(ArgGroup * argGroup);
+
+		/**
+		 * Add dependency to the default group.
+		 * @see ArgGroup::addDependency().
+		 */
+		Parser & addDependency(const Arg * arg, const Arg * requiredArg);
+
+		/**
+		 * Add mutual exclusion to the default group.
+		 * @see ArgGroup::addMutualExclusion().
+		 */
+		Parser & addMutualExclusion(const Vector<const Arg *> & args);
+
+		/**
+		 * Add conflict to the default group.
+		 * @see ArgGroup::addConflict().
+		 */
+		Parser & addConflict(const Arg * arg, const Arg * otherArg);
+
+		ArgGroup * group(std::size_t index);
+
+		Parser * addSubCmd(Arg * cmd);
+
+		void setHeader(const String & header);
+
+		void setFooter(const String & footer);
+
+		Arg * cmd() const;
+
+		void setCmd(Arg * cmdArg);
+
+		/**
+		 * Print synopsis to std::cout.
+		 */
+		void printSynopsis() const;
+
+		void printSynopsis(std::ostream & stream) const;
+
+		/**
+		 * Print description to std::cout.
+		 */
+		void printDescription() const;
+
+		void printDescription(std::ostream & stream) const;
+
+		/**
+		 * Print help to std::cout.
+		 */
+		void printHelp() const;
+
+		void printHelp(std::ostream & stream) const;
+
+		/**
+		 * Find parser of a sub-command.
+		 * @param cmdPath path of commands, starting with a sub-command of this parser. Commands with keys are identified in
+		 * the same way as they are matched on the command line (e.g. by one of their aliases). Other commands (e.g. ValueArg
+		 * commands, which match any value) are identified by their synopsis (e.g. "<file>").
+		 * @return parser of the last command in the path or @p nullptr if path can not be resolved. Empty path resolves to
+		 * this parser.
+		 */
+		const Parser * findSubCmd(const Vector<String> & cmdPath) const;
+
+		Parser * findSubCmd(const Vector<String> & cmdPath);
+
+		/**
+		 * Print help of a sub-command. Only synopsis lines and description paragraphs reachable from the sub-command are
+		 * printed. Usage line is prefixed with commands leading to the sub-command. Header and footer of this parser are
+		 * used.
+		 * @param cmdPath path of commands as in findSubCmd().
+		 * @param stream output stream. Overload without a stream prints to std::cout.
+		 * @throw UnrecognizedArgException if path can not be resolved. Argument number refers to an element of the path.
+		 */
+		void printSubCmdHelp(const Vector<String> & cmdPath) const;
+
+		void printSubCmdHelp(const Vector<String> & cmdPath, std::ostream & stream) const;
+
+		int parse(int argc, char * argv[]);
+
+		/**
+		 * Feed a single command line argument to the parser. This is a push-style alternative to parse(), which allows arguments
+		 * to be processed as they arrive. First argument fed to the parser must match its command argument. Errors related to
+		 * the argument are reported immediately by throwing an exception. When command argument does not accept further
+		 * sub-arguments, its required arguments are validated right away. After an exception has been thrown, parser should be
+		 * reset() before feeding new arguments.
+		 * @param arg command line argument. Parser does not keep a pointer to it, so it may be released once function returns.
+		 */
+		void feed(const char * arg);
+
+		/**
+		 * Finish parsing arguments passed with feed(). Function checks whether all required arguments have been set. Parser is
+		 * ready to accept another sequence of arguments afterwards, however previously set arguments retain their state until
+		 * reset() is called.
+		 * @return number of arguments that have been fed.
+		 */
+		int finish();
+
+		/**
+		 * Reset parser. Clears parsing state and unsets all the arguments reachable from this parser.
+		 */
+		void reset();
+
+		/**
+		 * Validate command line arguments without setting them. Unlike parse(), function does not stop on the first error, but
+		 * reports all the errors it encounters. Unrecognized arguments are skipped. Values are not stored, neither arguments
+		 * are marked as set, so lint() can be called any number of times without reset().
+		 * @param argc number of arguments.
+		 * @param argv arguments.
+		 * @param errors container to which errors are appended.
+		 * @return @p true if no errors have been found, @p false otherwise.
+		 */
+		bool lint(int argc, char * argv[], ParseErrorsContainer & errors);
+
+		/**
+		 * Get arguments following END_OF_OPTIONS. Span points directly into @a argv passed to parse(), so it remains valid as
+		 * long as @a argv does. Since @a argv passed to main() is terminated with a null pointer, span obtained from it can be
+		 * passed to execv() as is. Arguments fed with feed() after END_OF_OPTIONS are skipped and they are not included in
+		 * the span.
+		 * @return span of trailing arguments. Span is empty if END_OF_OPTIONS has not been encountered or no arguments follow
+		 * it.
+		 */
+		const ArgvSpan & trailingArgs() const;
+
+		/**
+		 * Enable adaptive lookup. Parser counts how many times each alias has been matched and periodically rebuilds its lookup
+		 * table, so that the most frequent aliases are found at the first probe. Results of parsing are not affected. Setting
+		 * applies to this parser only; parsers of sub-commands have their own settings.
+		 */
+		void setAdaptiveLookup(bool adaptiveLookup);
+
+		bool adaptiveLookup() const;
+
+		/**
+		 * Get lookup profile of this parser. Profile maps aliases to the number of times they have been matched. Counts decay
+		 * as lookup table is adapted, so that profile follows recent traffic. Profile can be persisted and passed to
+		 * setLookupProfile() of a parser with the same schema.
+		 */
+		LookupProfile lookupProfile() const;
+
+		/**
+		 * Set lookup profile. Lookup table is rebuilt according to the profile right away, regardless of whether adaptive
+		 * lookup is enabled. Aliases, which do not belong to the parser, are ignored.
+		 */
+		void setLookupProfile(const LookupProfile & profile);
+
+	protected:
+		/**
+		 * Append synopsis to @a result. Output is appended rather than returned, so that synopses of nested parsers are not
+		 * copied at each level of nesting.
+		 */
+		void synopsis(std::map<const void *, String> & synopsisLines, String & result) const;
+
+		/**
+		 * Append description to @a result.
+		 */
+		void description(std::map<const void *, String> & descriptionParagraphs, String & result) const;
+
+	private:
+		typedef Vector<ArgGroup *> ArgGroupsContainer;
+
+		typedef Vector<std::size_t> GroupOffsetsContainer;
+
+		typedef Vector<std::size_t> ArgIndicesContainer;
+
+		enum ArgKind {
+			CMD,
+			KEY_VALUE_ATTR,
+			KEY_ATTR,
+			VALUE_ATTR
+		};
+
+		struct IndexedArg
+		{
+			Arg * arg;
+			ArgKind kind;
+			std::size_t groupIndex;
+			Parser * parser;	///< Parser associated with a command or @p nullptr.
+		};
+
+		typedef Vector<IndexedArg> IndexedArgsContainer;
+
+		/**
+		 * Command line argument, which has been classified before it is matched.
+		 */
+		struct Token
+		{
+			char * arg;
+			std::size_t length;
+			std::size_t keyLength;	///< Length of the key part of an argument (up to assignment character).
+			bool assign;			///< Whether argument is in form key=value.
+			int dashes;				///< Number of leading Parser::GLUE_CHAR characters (0, 1, or 2 if there are two or more).
+
+			const char * value() const;
+		};
+
+		/**
+		 * Alias index. Aliases of commands, key-value and key-only arguments of all groups are interned in a string pool, so
+		 * that a key is found with a single hash lookup. Aliases are interned in lexicographical order, thus identifiers of
+		 * aliases sharing a prefix are consecutive, which allows to look up abbreviations with binary search. Entries sharing
+		 * the same alias are ordered by argument index, thus preserving precedence of groups and argument kinds.
+		 *
+		 * Index is stored as a structure of arrays. Entries are described by alias identifiers, kind tags and argument indices,
+		 * so that lookups do not touch argument objects.
+		 */
+		class AliasIndex
+		{
+			public:
+			    typedef std::pair<std::size_t, std::size_t> Range;
+
+				struct Alias
+				{
+					const String * alias;
+					ArgKind kind;
+					std::size_t argIndex;
+				};
+
+				typedef Vector<Alias> AliasesContainer;
+
+				enum : std::uint32_t {
+					ADAPTATION_PERIOD = 1024	///< Number of counted lookups, after which adaptive index rebuilds its hash table.
+				};
+
+				AliasIndex();
+
+				/**
+				 * Build index. Lookup counts of aliases, which remain in the index, are preserved.
+				 * @param aliases aliases to be indexed.
+				 */
+				void build(AliasesContainer & aliases);
+
+				std::size_t size() const;
+
+				/**
+				 * Find entries matching a key.
+				 * @return range of entries.
+				 */
+				Range find(const char * key, std::size_t keyLength) const;
+
+				/**
+				 * Find entries matching a key. If index is adaptive, successful lookup is counted.
+				 * @return range of entries.
+				 */
+				Range lookup(const char * key, std::size_t keyLength);
+
+				void setAdaptive(bool adaptive);
+
+				bool adaptive() const;
+
+				/**
+				 * Add lookup counts of aliases to a profile.
+				 */
+				void profile(LookupProfile & profile) const;
+
+				/**
+				 * Set lookup counts of aliases from a profile and adapt hash table.
+				 */
+				void setProfile(const LookupProfile & profile);
+
+				/**
+				 * Find entries, which aliases start with a key.
+				 * @return range of entries.
+				 */
+				Range findPrefix(const char * key, std::size_t keyLength) const;
+
+				/**
+				 * Get alias of an entry.
+				 * @return null-terminated alias.
+				 */
+				const char * alias(std::size_t entry) const;
+
+				ArgKind kind(std::size_t entry) const;
+
+				std::size_t argIndex(std::size_t entry) const;
+
+			private:
+				typedef Vector<StringPool::Id> AliasIdsContainer;
+				typedef Vector<std::uint32_t> OffsetsContainer;
+				typedef Vector<unsigned char> KindsContainer;
+				typedef Vector<std::uint32_t> ArgIndicesContainer;
+				typedef Vector<std::uint32_t> HitsContainer;
+
+				/**
+				 * Compare leading characters of an alias with a key.
+				 */
+				int comparePrefix(StringPool::Id id, const char * key, std::size_t keyLength) const;
+
+				/**
+				 * Rebuild hash table of aliases, so that aliases are inserted in the order of their lookup counts.
+				 */
+				void adapt();
+
+				StringPool m_aliases;
+				OffsetsContainer m_entryOffsets;	///< Offsets of entries of each alias. Last element is the number of entries.
+				AliasIdsContainer m_aliasIds;
+				KindsContainer m_kinds;
+				ArgIndicesContainer m_argIndices;
+				HitsContainer m_hits;		///< Lookup counts of aliases.
+				std::uint32_t m_lookups;	///< Lookups counted since hash table has been adapted.
+				bool m_adaptive;
+		};
+
+		/**
+		 * Constraint compiled into masks of argument indices.
+		 */
+		struct CompiledConstraint
+		{
+			const ArgGroup::Constraint * constraint;
+			Bitset args;			///< Dependent arguments (DEPENDENCY) or mutually exclusive arguments (MUTUAL_EXCLUSION).
+			Bitset requiredArgs;	///< Required arguments (DEPENDENCY).
+		};
+
+		typedef Vector<CompiledConstraint> CompiledConstraintsContainer;
+
+		typedef Vector<unsigned char> GluableSlotsContainer;
+
+		typedef Vector<Bitset> GluableGroupsContainer;
+
+		struct Frame
+		{
+			explicit Frame(Parser * parser);
+
+			/**
+			 * Reuse frame for another parser. Memory allocated for set arguments is retained.
+			 */
+			void assign(Parser * parser);
+
+			Parser * parser;
+			Bitset setArgs;		///< Arguments matched by the parser, indexed in the same way as Parser::m_indexedArgs.
+			std::size_t valueAttrsPos;	///< Position in Parser::m_valueAttrs, before which all value-only arguments are set.
+		};
+
+		struct ParseState
+		{
+			typedef Vector<Frame> PathContainer;
+			typedef Vector<std::pair<const Arg *, std::size_t>> CandidatesContainer;
+
+			ParseState();
+
+			/**
+			 * Clear parsing state. Unlike assignment of a new state, this function retains memory allocated by containers.
+			 */
+			void clear();
+
+			/**
+			 * Enter a parser. Frame is taken from spare frames, if there are any.
+			 */
+			void enter(Parser * parser);
+
+			/**
+			 * Leave the most nested parser. Its frame is moved to spare frames, so that it can be reused.
+			 * @return frame of the parser, which has been left. Reference is valid until another parser is entered.
+			 */
+			Frame & leave();
+
+			/**
+			 * Report an error when linting.
+			 * @return @p true if error has been reported or @p false if parsing is not in lint mode and exception should be
+			 * thrown by the caller.
+			 */
+			bool report(ParseError::Code code, int argNum, const Arg * arg);
+
+			PathContainer path;			///< Parsers, which command arguments have been matched, starting from the root parser.
+			Arg * pendingArg;			///< Argument waiting for its value.
+			Parser * pendingParser;		///< Parser, which command argument has been matched, but which has not been entered yet.
+			String pendingKey;		///< Key under which pending argument has been matched.
+			int argNum;					///< Number of arguments fed so far.
+			bool endOfOptions;			///< Whether END_OF_OPTIONS has been fed.
+			ParseErrorsContainer * errors;	///< Container for errors in lint mode or @p nullptr when parsing.
+			PathContainer spareFrames;	///< Frames of parsers, which have been left.
+			CandidatesContainer candidates;	///< Arguments abbreviated by a token paired with their alias index entries.
+		};
+
+		static Token Classify(char * arg);
+
+		/**
+		 * Find length of a string and position of the first assignment character.
+		 * @param assignPos position of assignment character or @p String::npos if there is none.
+		 * @return length of a string.
+		 */
+		static std::size_t Scan(const char * arg, std::size_t & assignPos);
+
+		/**
+		 * Assign dense indices to the arguments of all groups and build lookup tables. Arguments are indexed group by group in
+		 * the following order: commands, key-value arguments, key-only arguments and value-only arguments.
+		 */
+		void indexArgs();
+
+		void feed(const char * arg, ParseState & state);
+
+		void feedArg(const char * arg, int argNum, ParseState & state);
+
+		int finish(ParseState & state);
+
+		/**
+		 * Find parser of a direct sub-command. Commands are identified as in findSubCmd(const Vector<String> &).
+		 * @return parser of a sub-command or @p nullptr if there is no such sub-command.
+		 */
+		const Parser * findSubCmd(const char * cmd) const;
+
+		/**
+		 * Print usage line prefixed with @a context and synopsis lines of named groups.
+		 */
+		void printUsage(const String & context, std::ostream & stream) const;
+
+		/**
+		 * Compile constraints of all groups.
+		 */
+		void compileConstraints();
+
+		/**
+		 * Set bits corresponding to an argument.
+		 * @throw Exception if argument does not belong to the parser.
+		 */
+		void maskArg(const Arg * arg, Bitset & mask) const;
+
+		/**
+		 * Check constraints.
+		 * @return error message describing violated constraints or empty string.
+		 */
+		String checkConstraints(const Bitset & setArgs, int argNum, ParseState & state) const;
+
+		/**
+		 * Check whether value of an argument can be converted and whether it is accepted by its validators in lint mode.
+		 */
+		void lintValue(const Arg * arg, const char * value, ParseState & state);
+
+		bool matchCmd(Arg * cmd, char * arg, bool & expectsValue, ParseState & state);
+
+		void enterCmd(Parser * parser, char * arg, bool expectsValue, ParseState & state);
+
+		bool consumeCmd(std::size_t index, char * arg, ParseState & state);
+
+		/**
+		 * Consume an argument matching exactly one of the arguments of the parser.
+		 * @return @p false if parser can not consume the argument.
+		 */
+		bool consume(const Token & token, ParseState & state);
+
+		/**
+		 * Check whether consume() would find an exact match for an argument. Unlike consume(), function has no side effects.
+		 */
+		bool recognizes(const Token & token) const;
+
+		/**
+		 * Check whether an entry of alias index, which key matches an argument, accepts the argument.
+		 */
+		static bool Accepts(const IndexedArg & indexedArg, const Token & token);
+
+		/**
+		 * Find a group, in which argument represents glued key-only arguments.
+		 * @return group index or number of groups if there is no such group.
+		 */
+		std::size_t gluedKeyArgsGroup(const Token & token) const;
+
+		void consumeGluedKeyArgs(const Token & token, std::size_t groupIndex, ParseState & state);
+
+		/**
+		 * Consume an argument, which is an abbreviation of a long option.
+		 * @return @p false if argument is not an abbreviation of any of the options of the parser.
+		 * @throw AmbiguousArgException if argument abbreviates multiple options.
+		 */
+		bool consumeAbbreviation(const Token & token, ParseState & state);
+
+		bool consumeAttr(std::size_t index, const char * key, const char * value, ParseState & state);
+
+		void validate(const Bitset & setArgs, int argNum, ParseState & state);
+
+		/**
+		 * Increment schema revision of the parser and enclosing parsers.
+		 */
+		void touchSchema();
+
+		Arg * m_cmd;
+		ArgGroupsContainer m_argGroups;
+		ArgGroup m_defaultGroup;
+		String m_header;
+		String m_footer;
+		ParseState m_parseState;
+		ParseState m_lintState;
+		ArgvSpan m_trailingArgs;
+		IndexedArgsContainer m_indexedArgs;
+		GroupOffsetsContainer m_groupOffsets;
+		Bitset m_requiredArgs;
+		CompiledConstraintsContainer m_constraints;
+		AliasIndex m_aliasIndex;
+		ArgIndicesContainer m_unindexedCmds;		///< Commands, which can not be found in alias index.
+		ArgIndicesContainer m_valueAttrs;
+		GluableSlotsContainer m_gluableSlots;		///< Maps characters to slots of m_gluableGroups (slot number plus one or zero).
+		GluableGroupsContainer m_gluableGroups;		///< Groups, in which a character identifies a key-only argument that can be glued.
+		ArgGroup * m_ownerGroup;					///< Group, which owns the parser of a sub-command or @p nullptr.
+		unsigned long m_revision;
+		unsigned long m_indexRevision;
+};
+
+/**
+ * Schema built from arguments bound to fields of a structure. Schema owns a parser and the arguments it creates.
+ *
+ * Example:
+ * @code
+ * struct Config { int jobs; std::string output; bool verbose; };
+ * Config config = {1, "a.out", false};
+ * typedef crap::StructSchema<Config> Schema;
+ * Schema schema("make", config, {
+ *	Schema::Option("--jobs", & Config::jobs, "n", "Number of jobs."),
+ *	Schema::Option("--output", & Config::output, "file").setRequired(true),
+ *	Schema::Flag("-v", & Config::verbose, "Verbose output.")
+ * });
+ * schema.parser().parse(argc, argv);
+ * @endcode
+ *
+ * @tparam S type of structure.
+ */
+template <typename S>
+class StructSchema
+{
+	public:
+	    typedef Vector<std::unique_ptr<Arg, Deleter<Arg>>> ArgsContainer;
+
+	    /**
+		 * Binding of an argument to a field of a structure. Bindings are created with Option(), Flag() and Value() functions.
+		 */
+	    class Binding
+		{
+			friend class StructSchema;
+
+			public:
+			    Binding & setRequired(bool required);
+
+			private:
+				/**
+				 * Function, which creates an argument and adds it to a parser. Functions are held in the storage of the
+				 * library rather than in std::function, which may allocate on the heap.
+				 */
+				class Add
+				{
+					public:
+					    virtual ~Add() = default;
+
+						virtual void operator ()(S & target, bool required, Parser & parser, ArgsContainer & args) const = 0;
+				};
+
+				template <typename F>
+				class AddFunction:
+				        public Add
+				{
+					public:
+					    explicit AddFunction(const F & function);
+
+						void operator ()(S & target, bool required, Parser & parser, ArgsContainer & args) const override;
+
+					private:
+						F m_function;
+				};
+
+				template <typename F>
+				explicit Binding(const F & add);
+
+				std::shared_ptr<const Add> m_add;
+				bool m_required;
+		};
+
+		/**
+		 * Bind key-value argument to a field.
+		 * @see BoundKeyValueArg.
+		 */
+		template <typename T>
+		static Binding Option(const String & name, T S::* field, const String & valueName, const String & help = "");
+
+		/**
+		 * Bind key-only argument to a boolean field.
+		 * @see BoundKeyArg.
+		 */
+		static Binding Flag(const String & name, bool S::* field, const String & help = "");
+
+		/**
+		 * Bind value-only argument to a field.
+		 * @see BoundValueArg.
+		 */
+		template <typename T>
+		static Binding Value(const String & valueName, T S::* field, const String & help = "");
+
+		/**
+		 * Constructor. Arguments are added to the default group of the parser in the order of bindings.
+		 * @param cmdName name of command argument.
+		 * @param target structure, to which arguments are bound. Structure must remain valid while schema is used.
+		 * @param bindings bindings of arguments.
+		 */
+		StructSchema(const String & cmdName, S & target, std::initializer_list<Binding> bindings);
+
+		StructSchema(const StructSchema & other) = delete;
+
+		StructSchema & operator =(const StructSchema & other) = delete;
+
+		Parser & parser();
+
+		const Parser & parser() const;
+
+	private:
+		KeyArg m_cmd;
+		ArgsContainer m_args;
+		Parser m_parser;
+};
+
+/**
+ * Immutable snapshot of arguments. Snapshot records states and values of all the arguments reachable from a parser at the
+ * time it is created. Unlike arguments themselves, snapshot can be safely shared between threads, while parser is busy with
+ * parsing another set of arguments. Snapshots are meant to be distributed with SettingsPublisher.
+ */
+class Settings
+{
+	public:
+	    explicit Settings(const Parser & parser);
+
+		bool isSet(const Arg & arg) const;
+
+		/**
+		 * Get argument value.
+		 * @return value of an argument at the time snapshot has been taken or empty string if argument does not carry a value
+		 * or it is not reachable from the parser.
+		 */
+		const String & value(const Arg & arg) const;
+
+	private:
+		struct Entry
+		{
+			const Arg * arg;
+			bool set;
+			String value;
+		};
+
+		typedef Vector<Entry> EntriesContainer;
+
+		void addArgs(const Parser & parser);
+
+		void addArg(const Arg * arg);
+
+		const Entry * find(const Arg & arg) const;
+
+		EntriesContainer m_entries;
+};
+
+/**
+ * Settings publisher. Publisher holds reference-counted settings, which can be atomically replaced with new ones. Threads
+ * should access settings through a Reader, which caches them until new settings are published.
+ */
+class SettingsPublisher
+{
+	public:
+	    typedef std::shared_ptr<const Settings> SettingsPtr;
+
+		/**
+		 * Settings reader. Reader is meant to be used by a single thread. It keeps a reference to the settings, so they stay
+		 * alive while reader uses them, even if publisher has already replaced them.
+		 */
+		class Reader
+		{
+			public:
+			    explicit Reader(const SettingsPublisher & publisher);
+
+				/**
+				 * Get current settings. Unless new settings have been published, this function is wait-free and performs a
+				 * single atomic load. Otherwise reader atomically acquires new settings and releases the old ones.
+				 * @return current settings. Pointer remains valid until next call of this function.
+				 */
+				const SettingsPtr & settings();
+
+			private:
+				const SettingsPublisher * m_publisher;
+				unsigned long m_generation;
+				SettingsPtr m_settings;
+		};
+
+		explicit SettingsPublisher(SettingsPtr settings = SettingsPtr());
+
+		SettingsPublisher(const SettingsPublisher & other) = delete;
+
+		SettingsPublisher & operator =(const SettingsPublisher & other) = delete;
+
+		/**
+		 * Publish new settings.
+		 */
+		void publish(SettingsPtr settings);
+
+		/**
+		 * Get current settings. Function accesses shared pointer atomically, which is more expensive than using a Reader.
+		 */
+		SettingsPtr settings() const;
+
+	private:
+		SettingsPtr m_settings;
+		std::atomic<unsigned long> m_generation;
+};
+
+/**
+ * Parse record. Record serializes states and values of arguments reachable from a parser into a compact binary buffer, which
+ * can be loaded by another process with the same schema (e.g. by workers forked or spawned by a master process, which has
+ * parsed the arguments). Buffer can be placed in a shared memory segment or sent through a pipe. Loading does not copy values;
+ * they are read directly from the buffer, which must remain valid while record is used.
+ *
+ * Arguments are identified by their position in the schema. Each buffer carries a fingerprint of the schema, which is
+ * checked when buffer is loaded. Integers are stored in host byte order, so buffer can not be transferred between machines of
+ * different endianness.
+ *
+ * Buffer layout: header (magic number, schema fingerprint, number of arguments, length of command path, size of a buffer),
+ * argument table (offset and length of a value for each argument or NOT_SET), command path (indices of commands, which have
+ * been set, in depth-first order), null-terminated values.
+ */
+class ParseRecord
+{
+	public:
+	    typedef Vector<const Arg *> CmdPathContainer;
+
+		/**
+		 * Constructor.
+		 * @param parser parser, which arguments are recorded or restored. Schema may be modified after record has been
+		 * constructed, but buffers written before modification can not be loaded afterwards.
+		 */
+	    explicit ParseRecord(Parser & parser);
+
+		/**
+		 * Get schema fingerprint.
+		 */
+		std::uint64_t fingerprint();
+
+		/**
+		 * Write current states and values of arguments to a buffer.
+		 * @param buffer buffer, to which record is appended.
+		 */
+		void write(String & buffer);
+
+		/**
+		 * Load a buffer. Record keeps a pointer to the buffer.
+		 * @param data buffer written by write().
+		 * @param size size of a buffer.
+		 * @throw Exception if buffer is malformed or it has been written for a different schema.
+		 */
+		void load(const char * data, std::size_t size);
+
+		bool isSet(const Arg & arg) const;
+
+		/**
+		 * Get argument value.
+		 * @return value recorded in a loaded buffer, if argument has been set to a non-empty value. Otherwise current value
+		 * of an argument or @p nullptr if argument does not carry a value. Recorded value points into the buffer.
+		 */
+		const char * value(const Arg & arg) const;
+
+		/**
+		 * Get commands, which have been set, in depth-first order. Path starts with command argument of the parser.
+		 */
+		const CmdPathContainer & cmdPath() const;
+
+		/**
+		 * Set arguments of the parser as recorded in a loaded buffer. Arguments are matched as if they have been passed on
+		 * the command line, so values are validated again. Parser should be reset beforehand.
+		 */
+		void apply();
+
+	private:
+		enum : std::uint32_t {
+			MAGIC = 0x50415243,	///< "CRAP" in little-endian byte order.
+			NOT_SET = 0xFFFFFFFF,
+			HEADER_SIZE = 24,
+			ENTRY_SIZE = 8
+		};
+
+		typedef Vector<Arg *> ArgsContainer;
+
+		typedef Vector<char> KindsContainer;
+
+		typedef Vector<ArgGroup *> GroupsContainer;
+
+		typedef Vector<std::pair<const Arg *, std::uint32_t>> ArgIndicesContainer;
+
+		/**
+		 * Lay out arguments of the schema, unless layout is up to date.
+		 */
+		void layOut();
+
+		void layOut(const Parser & parser, std::uint32_t depth);
+
+		/**
+		 * Add argument to the layout.
+		 * @param group group, which owns parser of a command, or @p nullptr.
+		 */
+		void addArg(Arg * arg, char kind, std::uint32_t depth, ArgGroup * group = nullptr);
+
+		void appendCmdPath(const Parser & parser, String & buffer, std::uint32_t & length) const;
+
+		std::uint32_t argIndex(const Arg & arg) const;
+
+		std::uint32_t readUInt32(std::size_t pos) const;
+
+		Parser * m_parser;
+		ArgsContainer m_args;				///< Arguments in schema order. Repeated occurrences of shared arguments are null.
+		KindsContainer m_kinds;				///< Kinds of arguments as hashed into fingerprint.
+		GroupsContainer m_groups;			///< Groups, which own parsers of commands, or @p nullptr for other arguments.
+		ArgIndicesContainer m_argIndices;	///< Arguments sorted by address.
+		std::uint64_t m_fingerprint;
+		unsigned long m_revision;
+		const char * m_data;
+		std::size_t m_size;
+		CmdPathContainer m_cmdPath;
+		String m_assignment;
+};
+
+/**
+ * Cache of parse results. Cache sits in front of Parser::parse() and remembers results of recently parsed command lines, so that
+ * a repeated command line is restored from a ParseRecord or its error is rethrown without matching the arguments again. Command
+ * lines are looked up by hash of their arguments and compared on a hit. Least recently used entry is evicted, when cache is
+ * full. Entries are dropped automatically, when schema changes.
+ *
+ * Cache assumes that parsing is deterministic, i.e. that validators and default value functions do not depend on external
+ * state. Validators must not be modified after they have been added to arguments (e.g. with EnumValidator::addValue()), as
+ * arguments are not notified. Entries are scanned linearly, so capacity is expected to be small.
+ */
+class ParseCache
+{
+	public:
+	    /**
+		 * Constructor.
+		 * @param parser parser.
+		 * @param capacity maximal number of entries.
+		 */
+	    explicit ParseCache(Parser & parser, std::size_t capacity = 64);
+
+		ParseCache(const ParseCache & other) = delete;
+
+		ParseCache & operator =(const ParseCache & other) = delete;
+
+		/**
+		 * Parse arguments. Parser is reset before arguments are parsed or restored from cache. Function behaves like
+		 * Parser::parse(), except that arguments, which have been set before an exception is rethrown from cache, may differ.
+		 * @param argc number of arguments.
+		 * @param argv arguments.
+		 * @return number of arguments that have been processed.
+		 */
+		int parse(int argc, char * argv[]);
+
+		std::size_t capacity() const;
+
+		std::size_t size() const;
+
+		/**
+		 * Get number of lookups, which have been served from cache.
+		 */
+		unsigned long hits() const;
+
+		/**
+		 * Get number of lookups, which have been passed to the parser.
+		 */
+		unsigned long misses() const;
+
+		/**
+		 * Drop all entries. Counters are not reset.
+		 */
+		void clear();
+
+	private:
+		struct Entry
+		{
+			std::uint64_t hash;
+			String args;		///< Null-terminated arguments.
+			int argc;
+			int result;				///< Value returned by Parser::parse().
+			int trailingArgsPos;	///< Position of trailing arguments or argc if there are none.
+			String record;		///< Parse record or empty string if parsing has failed.
+			std::exception_ptr error;
+			unsigned long lastUse;
+		};
+
+		typedef Vector<Entry> EntriesContainer;
+
+		static std::uint64_t Hash(int argc, char * argv[]);
+
+		/**
+		 * Find an entry.
+		 * @return entry or @p nullptr if command line is not cached.
+		 */
+		Entry * find(std::uint64_t hash, int argc, char * argv[]);
+
+		/**
+		 * Get entry for a new command line. Least recently used entry is recycled, if cache is full.
+		 */
+		Entry & insert(std::uint64_t hash, int argc, char * argv[]);
+
+		Parser * m_parser;
+		ParseRecord m_record;
+		std::size_t m_capacity;
+		EntriesContainer m_entries;
+		unsigned long m_useCounter;
+		unsigned long m_hits;
+		unsigned long m_misses;
+		unsigned long m_revision;
+};
+
+template <typename T>
+inline
+ListArg<T>::ListArg(const String & name, const String & valueName, const String & help, char delimiter):
+    KeyValueArg(name, valueName, help),
+    m_delimiter(delimiter)
+{
+}
+
+template <typename T>
+inline
+const typename ListArg<T>::ValuesContainer & ListArg<T>::values() const
+{
+	return m_values;
+}
+
+template <typename T>
+inline
+char ListArg<T>::delimiter() const
+{
+	return m_delimiter;
+}
+
+template <typename T>
+inline
+ListArg<T> & ListArg<T>::setDelimiter(char delimiter)
+{
+	m_delimiter = delimiter;
+	touchSchema();
+	return *this;
+}
+
+template <typename T>
+inline
+void ListArg<T>::reset()
+{
+	m_values.clear();
+	KeyValueArg::reset();
+}
+
+template <typename T>
+inline
+void ListArg<T>::setValue(const char * value)
+{
+	m_values.clear();
+	String invalidElement;
+	if (!convert(value, & m_values, & invalidElement)) {
+		m_values.clear();
+		throw InvalidArgValueException(String() + "Invalid list element \"" + invalidElement + "\" in a value of argument \"" + name() + "\".");
+	}
+	KeyValueArg::setValue(value);
+}
+
+template <typename T>
+inline
+bool ListArg<T>::convertible(const char * value) const
+{
+	return convert(value, nullptr, nullptr);
+}
+
+template <typename T>
+inline
+bool ListArg<T>::convert(const char * value, ValuesContainer * values, String * invalidElement) const
+{
+	if (*value == '\0')
+		return true;
+
+	const char * valueEnd = value + std::strlen(value);
+	if (values)
+		values->reserve(values->size() + CountDelimiters(value, valueEnd, m_delimiter) + 1);
+	return SplitList(value, valueEnd, m_delimiter, [&](const char * element, const char * elementEnd) {
+		// Conversion may read past the element up to the end of the value, so that multiple digits can be loaded at once.
+		T number;
+		if (ConvertNumber(element, valueEnd, number, typename std::is_integral<T>::type()) != elementEnd) {
+			if (invalidElement)
+				invalidElement->assign(element, elementEnd);
+			return false;
+		}
+		if (values)
+			values->push_back(number);
+		return true;
+	});
+}
+
+template <typename T>
+inline
+const char * ConvertNumber(const char * str, T & number, std::true_type isIntegral)
+{
+	return ConvertNumber(str, str + std::strlen(str), number, isIntegral);
+}
+
+template <typename T>
+inline
+const char * ConvertNumber(const char * str, T & number, std::false_type isIntegral)
+{
+	return ConvertNumber(str, str + std::strlen(str), number, isIntegral);
+}
+
+template <typename T>
+inline
+const char * ConvertNumber(const char * str, const char * end, T & number, std::true_type)
+{
+	bool negative = (str < end) && (*str == '-');
+	if (negative && !std::is_signed<T>::value)
+		return nullptr;
+	if ((str < end) && ((*str == '-') || (*str == '+')))
+		str++;
+	if ((str == end) || (*str < '0') || (*str > '9'))
+		return nullptr;
+
+	// Magnitude of the minimal value of a signed type exceeds the maximal value by one.
+	unsigned long long limit = static_cast<unsigned long long>(std::numeric_limits<T>::max()) + (negative ? 1 : 0);
+	unsigned long long magnitude = 0;
+
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+	// Up to eight digits are converted at once (SWAR), as long as eight characters can be loaded.
+	static const unsigned long long Powers[] = {1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL};
+	while (end - str >= 8) {
+		std::uint64_t chunk;
+		std::memcpy(& chunk, str, sizeof(chunk));
+		// Bytes of digits have high nibble equal to 3 and low nibble, which does not overflow when 6 is added to it.
+		std::uint64_t nibbles = (chunk & 0xF0F0F0F0F0F0F0F0ULL) | (((chunk + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4);
+		std::uint64_t nonDigits = nibbles ^ 0x3333333333333333ULL;
+		std::size_t digits = nonDigits ? static_cast<std::size_t>(__builtin_ctzll(nonDigits)) / 8 : 8;
+		if (digits == 0)
+			break;
+
+		// Digits are moved to the most significant bytes, so that missing digits become leading zeros, and then combined
+		// pairwise: two digits into 16 bits and four digits into 32 bits.
+		std::uint64_t value = (chunk - 0x3030303030303030ULL) << ((8 - digits) * 8);
+		value = (value * 10) + (value >> 8);
+		value = (((value & 0x000000FF000000FFULL) * (100 + (1000000ULL << 32))) + (((value >> 16) & 0x000000FF000000FFULL) * (1 + (10000ULL << 32)))) >> 32;
+		if (__builtin_mul_overflow(magnitude, Powers[digits], & magnitude) || __builtin_add_overflow(magnitude, value, & magnitude) || (magnitude > limit))
+			return nullptr;
+		str += digits;
+		if (digits < 8)
+			break;
+	}
+#endif
+
+	for (; (str < end) && (*str >= '0') && (*str <= '9'); str++) {
+		unsigned digit = static_cast<unsigned>(*str - '0');
+		if (magnitude > (limit - digit) / 10)
+			return nullptr;
+		magnitude = magnitude * 10 + digit;
+	}
+
+	if (negative)
+		number = static_cast<T>(-static_cast<long long>(magnitude - 1) - 1);
+	else
+		number = static_cast<T>(magnitude);
+	return str;
+}
+
+template <typename T>
+inline
+const char * ConvertNumber(const char * str, const char * end, T & number, std::false_type)
+{
+	// Infinities, including those resulting from overflow, are rejected.
+	T converted;
+	const char * numberEnd = ConvertFloat(str, end, converted);
+	if (!numberEnd || (converted > std::numeric_limits<T>::max()) || (converted < std::numeric_limits<T>::lowest()))
+		return nullptr;
+	number = converted;
+	return numberEnd;
+}
+
+template <typename F>
+inline
+bool SplitList(const char * str, const char * end, char delimiter, F function)
+{
+	const char * element = str;
+	const char * c = str;
+#ifdef CRAP_SSE2
+	// Delimiters of a whole block are found at once and elements are taken from a bitmask of their positions.
+	const __m128i delimiters = _mm_set1_epi8(delimiter);
+	for (; end - c >= 16; c += 16) {
+		unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(c)), delimiters)));
+		for (; mask != 0; mask &= mask - 1) {
+			const char * delimiterPos = c + __builtin_ctz(mask);
+			if (!function(element, delimiterPos))
+				return false;
+			element = delimiterPos + 1;
+		}
+	}
+#endif
+	for (; c < end; c++)
+		if (*c == delimiter) {
+			if (!function(element, c))
+				return false;
+			element = c + 1;
+		}
+	return function(element, end);
+}
+
+template <typename T>
+inline
+String FormatValue(const T & value)
+{
+	// Values are widened, so that formatting is compiled only once, together with other definitions. Widening is exact
+	// and the precision of a stream does not depend on a type, so results are unchanged.
+	typedef typename std::conditional<std::is_floating_point<T>::value, long double,
+	        typename std::conditional<std::is_signed<T>::value, long long, unsigned long long>::type>::type Widened;
+	return FormatValue(static_cast<Widened>(value));
+}
+
+template <typename T>
+inline
+BoundKeyValueArg<T>::BoundKeyValueArg(const String & name, T & target, const String & valueName, const String & help):
+    KeyValueArg(name, valueName, help),
+    m_target(& target)
+{
+	setDefaultValue(FormatValue(target));
+}
+
+template <typename T>
+inline
+T & BoundKeyValueArg<T>::target() const
+{
+	return *m_target;
+}
+
+template <typename T>
+inline
+bool ConvertBoundValue(const char * str, T & value)
+{
+	const char * end = ConvertNumber(str, value, typename std::is_integral<T>::type());
+	return end && (*end == '\0');
+}
+
+template <typename T>
+inline
+void BoundKeyValueArg<T>::setValue(const char * value)
+{
+	// Converted value is written to the target only after argument has been set successfully.
+	T converted = T();
+	if (!ConvertBoundValue(value, converted))
+		throw InvalidArgValueException(String() + "Invalid value \"" + value + "\" of argument \"" + synopsis() + "\" (expected a number).");
+	KeyValueArg::setValue(value);
+	*m_target = converted;
+}
+
+template <>
+inline
+void BoundKeyValueArg<String>::setValue(const char * value)
+{
+	KeyValueArg::setValue(value);
+	// Assignment reuses capacity of the target.
+	*m_target = value;
+}
+
+template <typename T>
+inline
+bool BoundKeyValueArg<T>::convertible(const char * value) const
+{
+	T converted = T();
+	return ConvertBoundValue(value, converted);
+}
+
+template <typename T>
+inline
+BoundValueArg<T>::BoundValueArg(const String & valueName, T & target, const String & help):
+    ValueArg(valueName, help),
+    m_target(& target)
+{
+	setDefaultValue(FormatValue(target));
+}
+
+template <typename T>
+inline
+T & BoundValueArg<T>::target() const
+{
+	return *m_target;
+}
+
+template <typename T>
+inline
+void BoundValueArg<T>::setValue(const char * value)
+{
+	T converted = T();
+	if (!ConvertBoundValue(value, converted))
+		throw InvalidArgValueException(String() + "Invalid value \"" + value + "\" of argument \"" + synopsis() + "\" (expected a number).");
+	ValueArg::setValue(value);
+	*m_target = converted;
+}
+
+template <>
+inline
+void BoundValueArg<String>::setValue(const char * value)
+{
+	ValueArg::setValue(value);
+	*m_target = value;
+}
+
+template <typename T>
+inline
+bool BoundValueArg<T>::convertible(const char * value) const
+{
+	T converted = T();
+	return ConvertBoundValue(value, converted);
+}
+
+template <typename S>
+template <typename F>
+inline
+StructSchema<S>::Binding::AddFunction<F>::AddFunction(const F & function):
+    m_function(function)
+{
+}
+
+template <typename S>
+template <typename F>
+inline
+void StructSchema<S>::Binding::AddFunction<F>::operator ()(S & target, bool required, Parser & parser, ArgsContainer & args) const
+{
+	m_function(target, required, parser, args);
+}
+
+template <typename S>
+template <typename F>
+inline
+StructSchema<S>::Binding::Binding(const F & add):
+    m_add(std::allocate_shared<AddFunction<F>>(Allocator<AddFunction<F>>(), add)),
+    m_required(false)
+{
+}
+
+template <typename S>
+inline
+typename StructSchema<S>::Binding & StructSchema<S>::Binding::setRequired(bool required)
+{
+	m_required = required;
+	return *this;
+}
+
+template <typename S>
+template <typename T>
+inline
+typename StructSchema<S>::Binding StructSchema<S>::Option(const String & name, T S::* field, const String & valueName, const String & help)
+{
+	return Binding([=](S & target, bool required, Parser & parser, ArgsContainer & args) {
+		std::unique_ptr<BoundKeyValueArg<T>, Deleter<BoundKeyValueArg<T>>> arg(New<BoundKeyValueArg<T>>(name, target.*field, valueName, help));
+		arg->setRequired(required);
+		parser.addAttr(arg.get());
+		args.push_back(std::move(arg));
+	});
+}
+
+template <typename S>
+inline
+typename StructSchema<S>::Binding StructSchema<S>::Flag(const String & name, bool S::* field, const String & help)
+{
+	return Binding([=](S & target, bool required, Parser & parser, ArgsContainer & args) {
+		std::unique_ptr<BoundKeyArg, Deleter<BoundKeyArg>> arg(New<BoundKeyArg>(name, target.*field, help));
+		arg->setRequired(required);
+		parser.addAttr(arg.get());
+		args.push_back(std::move(arg));
+	});
+}
+
+template <typename S>
+template <typename T>
+inline
+typename StructSchema<S>::Binding StructSchema<S>::Value(const String & valueName, T S::* field, const String & help)
+{
+	return Binding([=](S & target, bool required, Parser & parser, ArgsContainer & args) {
+		std::unique_ptr<BoundValueArg<T>, Deleter<BoundValueArg<T>>> arg(New<BoundValueArg<T>>(valueName, target.*field, help));
+		arg->setRequired(required);
+		parser.addAttr(arg.get());
+		args.push_back(std::move(arg));
+	});
+}
+
+template <typename S>
+inline
+StructSchema<S>::StructSchema(const String & cmdName, S & target, std::initializer_list<Binding> bindings):
+    m_cmd(cmdName),
+    m_parser(& m_cmd)
+{
+	m_args.reserve(bindings.size());
+	for (typename std::initializer_list<Binding>::const_iterator it = bindings.begin(); it != bindings.end(); ++it)
+		(*it->m_add)(target, it->m_required, m_parser, m_args);
+}
+
+template <typename S>
+inline
+Parser & StructSchema<S>::parser()
+{
+	return m_parser;
+}
+
+template <typename S>
+inline
+const Parser & StructSchema<S>::parser() const
+{
+	return m_parser;
+}
+
+#if !defined(CRAP_SEPARATE_COMPILATION) || defined(CRAP_IMPLEMENTATION)
+
+CRAP_INLINE
+Exception::Exception(const String & what):
+    std::runtime_error(what.c_str())
+{
+}
+
+CRAP_INLINE
+Exception::Exception(const char * what):
+    std::runtime_error(what)
+{
+}
+
+CRAP_INLINE
+ExcessiveCmdException::ExcessiveCmdException(const String & what):
+    Exception(what)
+{
+}
+
+CRAP_INLINE
+ArgAlreadySetException::ArgAlreadySetException(const String & what):
+    Exception(what)
+{
+}
+
+CRAP_INLINE
+ArgRequiresValueException::ArgRequiresValueException(const String & what):
+    Exception(what)
+{
+}
+
+CRAP_INLINE
+UnrecognizedArgException::UnrecognizedArgException(const String & what, int argNum):
+    Exception(what),
+    m_argNum(argNum)
+{
+}
+
+CRAP_INLINE
+int UnrecognizedArgException::argNum() const
+{
+	return m_argNum;
+}
+
+CRAP_INLINE
+MissingArgException::MissingArgException(const String & what):
+    Exception(what)
+{
+}
+
+CRAP_INLINE
+ConstraintViolationException::ConstraintViolationException(const String & what):
+    Exception(what)
+{
+}
+
+CRAP_INLINE
+AmbiguousArgException::AmbiguousArgException(const String & what, int argNum):
+    Exception(what),
+    m_argNum(argNum)
+{
+}
+
+CRAP_INLINE
+int AmbiguousArgException::argNum() const
+{
+	return m_argNum;
+}
+
+CRAP_INLINE
+CapacityException::CapacityException(const char * what):
+    Exception(what)
+{
+}
+
+CRAP_INLINE
+InvalidArgValueException::InvalidArgValueException(const String & what, int argNum):
+    Exception(what),
+    m_argNum(argNum)
+{
+}
+
+CRAP_INLINE
+int InvalidArgValueException::argNum() const
+{
+	return m_argNum;
+}
+
+#ifdef CRAP_FIXED_STORAGE
+
+CRAP_INLINE
+void * FixedStorage::Allocate(std::size_t size)
+{
+	std::size_t sizeClass = MIN_CLASS;
+	while ((sizeClass < CLASSES) && ((std::size_t(1) << sizeClass) < size + HEADER_SIZE))
+		sizeClass++;
+
+	State & state = GetState();
+	unsigned char * block;
+	{
+		LockGuard lock(state.lock);
+		if (sizeClass < CLASSES && state.freeLists[sizeClass]) {
+			block = state.freeLists[sizeClass];
+			std::memcpy(& state.freeLists[sizeClass], block + HEADER_SIZE, sizeof(block));
+		} else if ((sizeClass < CLASSES) && ((std::size_t(1) << sizeClass) <= CRAP_FIXED_STORAGE - state.used)) {
+			block = state.buffer + state.used;
+			state.used += std::size_t(1) << sizeClass;
+		} else
+			block = nullptr;
+	}
+	if (!block)
+		throw CapacityException("Fixed storage is exhausted (CRAP_FIXED_STORAGE is too small).");
+	block[0] = static_cast<unsigned char>(sizeClass);
+	return block + HEADER_SIZE;
+}
+
+CRAP_INLINE
+void FixedStorage::Deallocate(void * ptr)
+{
+	if (!ptr)
+		return;
+
+	unsigned char * block = static_cast<unsigned char *>(ptr) - HEADER_SIZE;
+	State & state = GetState();
+	LockGuard lock(state.lock);
+	std::memcpy(block + HEADER_SIZE, & state.freeLists[block[0]], sizeof(block));
+	state.freeLists[block[0]] = block;
+}
+
+CRAP_INLINE
+std::size_t FixedStorage::Used()
+{
+	State & state = GetState();
+	LockGuard lock(state.lock);
+	return state.used;
+}
+
+CRAP_INLINE
+FixedStorage::LockGuard::LockGuard(std::atomic_flag & lock):
+    lock(lock)
+{
+	while (lock.test_and_set(std::memory_order_acquire)) {
+	}
+}
+
+CRAP_INLINE
+FixedStorage::LockGuard::~LockGuard()
+{
+	lock.clear(std::memory_order_release);
+}
+
+CRAP_INLINE
+FixedStorage::State & FixedStorage::GetState()
+{
+	// State is trivial, so it is zero-initialized without a guard or a static constructor.
+	static State state;
+	return state;
+}
+
+#endif
+
+CRAP_INLINE
+ParseError::ParseError(Code code, int argNum, const Arg * arg):
+    code(code),
+    argNum(argNum),
+    arg(arg)
+{
+}
+
+CRAP_INLINE
+Bitset::Bitset(std::size_t size):
+    m_size(0),
+    m_inlineWords()
+{
+	resize(size);
+}
+
+CRAP_INLINE
+std::size_t Bitset::size() const
+{
+	return m_size;
+}
+
+CRAP_INLINE
+void Bitset::resize(std::size_t size)
+{
+	std::size_t oldCount = wordCount();
+	std::size_t newCount = WordCount(size);
+	if (newCount > INLINE_WORDS) {
+		if (oldCount <= INLINE_WORDS)
+			m_heapWords.assign(m_inlineWords, m_inlineWords + oldCount);
+		m_heapWords.resize(newCount, 0);
+	} else if (oldCount > INLINE_WORDS) {
+		std::copy(m_heapWords.begin(), m_heapWords.begin() + static_cast<std::ptrdiff_t>(newCount), m_inlineWords);
+		m_heapWords.clear();
+	} else
+		std::fill(m_inlineWords + std::min(oldCount, newCount), m_inlineWords + newCount, 0);
+	m_size = size;
+}
+
+CRAP_INLINE
+void Bitset::set(std::size_t index)
+{
+	words()[index / WORD_BITS] |= Word(1) << (index % WORD_BITS);
+}
+
+CRAP_INLINE
+bool Bitset::test(std::size_t index) const
+{
+	return (words()[index / WORD_BITS] >> (index % WORD_BITS)) & 1;
+}
+
+CRAP_INLINE
+void Bitset::clear()
+{
+	std::fill(words(), words() + wordCount(), 0);
+}
+
+CRAP_INLINE
+std::size_t Bitset::wordCount() const
+{
+	return WordCount(m_size);
+}
+
+CRAP_INLINE
+Bitset::Word Bitset::word(std::size_t index) const
+{
+	return words()[index];
+}
+
+CRAP_INLINE
+std::size_t Bitset::findFirst() const
+{
+	for (std::size_t w = 0; w < wordCount(); w++)
+		if (Word word = words()[w])
+			for (std::size_t bit = 0; ; bit++, word >>= 1)
+				if (word & 1)
+					return w * WORD_BITS + bit;
+	return m_size;
+}
+
+CRAP_INLINE
+Bitset & Bitset::operator &=(const Bitset & other)
+{
+	for (std::size_t w = 0; w < wordCount(); w++)
+		words()[w] &= other.words()[w];
+	return *this;
+}
+
+CRAP_INLINE
+bool Bitset::intersects(const Bitset & other) const
+{
+	for (std::size_t w = 0; w < wordCount(); w++)
+		if (words()[w] & other.words()[w])
+			return true;
+	return false;
+}
+
+CRAP_INLINE
+std::size_t Bitset::intersectionCount(const Bitset & other) const
+{
+	std::size_t count = 0;
+	for (std::size_t w = 0; w < wordCount(); w++)
+		for (Word word = words()[w] & other.words()[w]; word; word &= word - 1)
+			count++;
+	return count;
+}
+
+CRAP_INLINE
+std::size_t Bitset::WordCount(std::size_t size)
+{
+	return (size + WORD_BITS - 1) / WORD_BITS;
+}
+
+CRAP_INLINE
+Bitset::Word * Bitset::words()
+{
+	return (wordCount() > INLINE_WORDS) ? m_heapWords.data() : m_inlineWords;
+}
+
+CRAP_INLINE
+const Bitset::Word * Bitset::words() const
+{
+	return (wordCount() > INLINE_WORDS) ? m_heapWords.data() : m_inlineWords;
+}
+
+CRAP_INLINE
+StringPool::StringPool():
+    m_slots(8, NO_ID)
+{
+}
+
+CRAP_INLINE
+StringPool::Id StringPool::intern(const char * str, std::size_t length)
+{
+	std::size_t pos = slot(str, length);
+	if (m_slots[pos] != NO_ID)
+		return m_slots[pos];
+
+	Id id = static_cast<Id>(m_offsets.size());
+	m_offsets.push_back(static_cast<std::uint32_t>(m_bytes.size()));
+	m_bytes.append(str, length).push_back('\0');
+	m_slots[pos] = id;
+	// Keep load factor at most one half.
+	if (m_offsets.size() * 2 > m_slots.size())
+		rehash(m_slots.size() * 2);
+	return id;
+}
+
+CRAP_INLINE
+StringPool::Id StringPool::intern(const String & str)
+{
+	return intern(str.data(), str.length());
+}
+
+CRAP_INLINE
+StringPool::Id StringPool::find(const char * str, std::size_t length) const
+{
+	return m_slots[slot(str, length)];
+}
+
+CRAP_INLINE
+std::size_t StringPool::size() const
+{
+	return m_offsets.size();
+}
+
+CRAP_INLINE
+const char * StringPool::str(Id id) const
+{
+	return m_bytes.data() + m_offsets[id];
+}
+
+CRAP_INLINE
+std::size_t StringPool::length(Id id) const
+{
+	std::size_t end = (id + 1 < m_offsets.size()) ? m_offsets[id + 1] : m_bytes.size();
+	return end - m_offsets[id] - 1;
+}
+
+CRAP_INLINE
+void StringPool::clear()
+{
+	m_bytes.clear();
+	m_offsets.clear();
+	std::fill(m_slots.begin(), m_slots.end(), NO_ID);
+}
+
+CRAP_INLINE
+std::size_t StringPool::Hash(const char * str, std::size_t length)
+{
+	// FNV-1a.
+	std::uint64_t hash = 14695981039346656037ULL;
+	for (std::size_t i = 0; i < length; i++) {
+		hash ^= static_cast<unsigned char>(str[i]);
+		hash *= 1099511628211ULL;
+	}
+	return static_cast<std::size_t>(hash);
+}
+
+CRAP_INLINE
+std::size_t StringPool::slot(const char * str, std::size_t length) const
+{
+	std::size_t mask = m_slots.size() - 1;
+	for (std::size_t pos = Hash(str, length) & mask; ; pos = (pos + 1) & mask) {
+		Id id = m_slots[pos];
+		if ((id == NO_ID) || ((this->length(id) == length) && (std::memcmp(this->str(id), str, length) == 0)))
+			return pos;
+	}
+}
+
+CRAP_INLINE
+void StringPool::prioritize(const Vector<Id> & ids)
+{
+	std::fill(m_slots.begin(), m_slots.end(), NO_ID);
+	for (Vector<Id>::const_iterator it = ids.begin(); it != ids.end(); ++it)
+		m_slots[slot(str(*it), length(*it))] = *it;
+}
+
+CRAP_INLINE
+void StringPool::rehash(std::size_t slotCount)
+{
+	m_slots.assign(slotCount, NO_ID);
+	for (Id id = 0; id < m_offsets.size(); id++)
+		m_slots[slot(str(id), length(id))] = id;
+}
+
+CRAP_INLINE
+EnumValidator::EnumValidator(const ValuesContainer & values)
+{
+	for (ValuesContainer::const_iterator it = values.begin(); it != values.end(); ++it)
+		m_values.intern(*it);
+}
+
+CRAP_INLINE
+EnumValidator & EnumValidator::addValue(const String & value)
+{
+	m_values.intern(value);
+	return *this;
+}
+
+CRAP_INLINE
+bool EnumValidator::validate(const char * value) const
+{
+	return m_values.find(value, std::strlen(value)) != StringPool::NO_ID;
+}
+
+CRAP_INLINE
+String EnumValidator::description() const
+{
+	String result("one of: ");
+	for (StringPool::Id id = 0; id < m_values.size(); id++)
+		result.append(id == 0 ? "\"" : ", \"").append(m_values.str(id), m_values.length(id)).append("\"");
+	return result;
+}
+
+/**
+ * Convert a floating point number with one of std::strtof(), std::strtod() and std::strtold().
+ * @param maxMantissa maximal integer, which is exactly representable by @a T, or zero to disable fast path.
+ * @param maxExponent maximal power of ten, which is exactly representable by @a T.
+ */
+template <typename T>
+const char * ConvertFloat(const char * str, const char * end, T & number, T (* convert)(const char *, char **), unsigned long long maxMantissa, int maxExponent)
+{
+	auto isDigit = [](char c, bool hex) {
+		return ((c >= '0') && (c <= '9')) || (hex && (((c | 0x20) >= 'a') && ((c | 0x20) <= 'f')));
+	};
+	auto skipDigits = [&](const char * c, bool hex) {
+		while ((c < end) && isDigit(*c, hex))
+			c++;
+		return c;
+	};
+	// Compares letters case-insensitively.
+	auto startsWith = [&](const char * c, const char * word) {
+		std::size_t length = std::strlen(word);
+		if (static_cast<std::size_t>(end - c) < length)
+			return false;
+		for (std::size_t i = 0; i < length; i++)
+			if ((c[i] | 0x20) != word[i])
+				return false;
+		return true;
+	};
+
+	// Number is scanned first, so that its end does not depend on the locale, then decimal point is replaced with the one of
+	// the current locale and number is converted by the conversion function.
+	const char * c = str;
+	if ((c < end) && ((*c == '-') || (*c == '+')))
+		c++;
+	bool hex = (end - c > 2) && (c[0] == '0') && ((c[1] | 0x20) == 'x');
+	const char * mantissa = hex ? c + 2 : c;
+	const char * point = nullptr;
+	c = skipDigits(mantissa, hex);
+	std::ptrdiff_t digits = c - mantissa;
+	if ((c < end) && (*c == '.')) {
+		point = c;
+		c = skipDigits(c + 1, hex);
+		digits += c - (point + 1);
+	}
+	const char * mantissaEnd = c;
+	int exponent10 = 0;
+	if (digits > 0) {
+		// Exponent is a part of the number only if it has digits.
+		if ((end - c > 1) && ((*c | 0x20) == (hex ? 'p' : 'e'))) {
+			const char * exponent = c + 1;
+			if ((*exponent == '-') || (*exponent == '+'))
+				exponent++;
+			if ((exponent < end) && isDigit(*exponent, false)) {
+				c = skipDigits(exponent, false);
+				// Long exponents are left to the slow path.
+				if (c - exponent <= 4)
+					for (const char * e = exponent; e < c; e++)
+						exponent10 = exponent10 * 10 + (*e - '0');
+				else
+					maxMantissa = 0;
+				if (exponent[-1] == '-')
+					exponent10 = -exponent10;
+			}
+		}
+
+#if defined(FLT_EVAL_METHOD) && (FLT_EVAL_METHOD == 0)
+		// Fast path (Clinger): if both the mantissa and the power of ten are exactly representable, then a single
+		// multiplication or division is correctly rounded.
+		if (!hex && (digits <= 19)) {
+			unsigned long long integer = 0;
+			for (const char * d = mantissa; d < mantissaEnd; d++)
+				if (d != point) {
+					integer = integer * 10 + static_cast<unsigned>(*d - '0');
+					if (point && (d > point))
+						exponent10--;
+				}
+			if ((integer <= maxMantissa) && (exponent10 >= -maxExponent) && (exponent10 <= maxExponent)) {
+				static const double Powers[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+						1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+				T value = static_cast<T>(integer);
+				if (exponent10 < 0)
+					value /= static_cast<T>(Powers[-exponent10]);
+				else
+					value *= static_cast<T>(Powers[exponent10]);
+				number = (*str == '-') ? -value : value;
+				return c;
+			}
+		}
+#endif
+	} else if (hex) {
+		// Prefix without digits is read as zero followed by 'x'.
+		point = nullptr;
+		c = mantissa - 1;
+	} else if (startsWith(c, "infinity"))
+		c += 8;
+	else if (startsWith(c, "inf"))
+		c += 3;
+	else if (startsWith(c, "nan")) {
+		c += 3;
+		const char * sequence = c;
+		if ((sequence < end) && (*sequence == '(')) {
+			for (sequence++; (sequence < end) && (isDigit(*sequence, false) || (((*sequence | 0x20) >= 'a') && ((*sequence | 0x20) <= 'z')) || (*sequence == '_')); sequence++) {
+			}
+			if ((sequence < end) && (*sequence == ')'))
+				c = sequence + 1;
+		}
+	} else
+		return nullptr;
+
+	// Number followed by a character within the range can be converted in place, unless decimal point differs in the current
+	// locale. Otherwise it is copied, so that conversion does not read past the range.
+	const char * decimalPoint = point ? std::localeconv()->decimal_point : ".";
+	bool inPlace = (c < end) && (std::strcmp(decimalPoint, ".") == 0);
+	std::size_t decimalPointLength = point ? std::strlen(decimalPoint) : 0;
+	std::size_t length = static_cast<std::size_t>(c - str) + decimalPointLength - (point ? 1 : 0);
+	char stackBuffer[64];
+	String heapBuffer;
+	const char * buffer = str;
+	const char * bufferEnd = c;
+	if (!inPlace) {
+		char * out = stackBuffer;
+		if (length >= sizeof(stackBuffer)) {
+			heapBuffer.resize(length + 1);
+			out = & heapBuffer[0];
+		}
+		buffer = out;
+		if (point) {
+			out = std::copy(str, point, out);
+			out = std::copy(decimalPoint, decimalPoint + decimalPointLength, out);
+			out = std::copy(point + 1, c, out);
+		} else
+			out = std::copy(str, c, out);
+		*out = '\0';
+		bufferEnd = out;
+	}
+
+	char * convertedEnd;
+	number = convert(buffer, & convertedEnd);
+	if (convertedEnd != bufferEnd)
+		return nullptr;
+	return c;
+}
+
+CRAP_INLINE
+const char * ConvertFloat(const char * str, const char * end, float & number)
+{
+	return ConvertFloat(str, end, number, std::strtof, 1ULL << 24, 10);
+}
+
+CRAP_INLINE
+const char * ConvertFloat(const char * str, const char * end, double & number)
+{
+	return ConvertFloat(str, end, number, std::strtod, 1ULL << 53, 22);
+}
+
+CRAP_INLINE
+const char * ConvertFloat(const char * str, const char * end, long double & number)
+{
+	return ConvertFloat(str, end, number, std::strtold, 0, 0);
+}
+
+CRAP_INLINE
+std::size_t CountDelimiters(const char * str, const char * end, char delimiter)
+{
+	std::size_t count = 0;
+#ifdef CRAP_SSE2
+	const __m128i delimiters = _mm_set1_epi8(delimiter);
+	for (; end - str >= 16; str += 16)
+		count += static_cast<std::size_t>(__builtin_popcount(static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(str)), delimiters)))));
+#endif
+	return count + static_cast<std::size_t>(std::count(str, end, delimiter));
+}
+
+CRAP_INLINE
+RangeValidator::RangeValidator(long double min, long double max, bool integral):
+    m_min(min),
+    m_max(max),
+    m_integral(integral)
+{
+}
+
+CRAP_INLINE
+bool RangeValidator::validate(const char * value) const
+{
+	const char * valueEnd = value + std::strlen(value);
+	const char * numberEnd;
+	long double number = 0.0L;
+	if (m_integral) {
+		long long integer = 0;
+		numberEnd = ConvertNumber(value, valueEnd, integer, std::true_type());
+		number = static_cast<long double>(integer);
+	} else
+		numberEnd = ConvertNumber(value, valueEnd, number, std::false_type());
+	return (numberEnd == valueEnd) && (number >= m_min) && (number <= m_max);
+}
+
+CRAP_INLINE
+String RangeValidator::description() const
+{
+	return String(m_integral ? "integer" : "number") + " from " + FormatValue(m_min) + " to " + FormatValue(m_max);
+}
+
+CRAP_INLINE
+PatternValidator::PatternValidator(const String & pattern):
+    m_pattern(pattern)
+{
+}
+
+CRAP_INLINE
+bool PatternValidator::validate(const char * value) const
+{
+	// Greedy matching with backtracking to the most recent '*' only, which takes linear time for patterns without '*'.
+	const char * pattern = m_pattern.c_str();
+	const char * star = nullptr;
+	const char * starValue = nullptr;
+	while (*value != '\0') {
+		if ((*pattern == '?') || ((*pattern != '*') && (*pattern == *value) && (*pattern != '\0'))) {
+			pattern++;
+			value++;
+		} else if (*pattern == '*') {
+			star = pattern++;
+			starValue = value;
+		} else if (star) {
+			pattern = star + 1;
+			value = ++starValue;
+		} else
+			return false;
+	}
+	while (*pattern == '*')
+		pattern++;
+	return *pattern == '\0';
+}
+
+CRAP_INLINE
+String PatternValidator::description() const
+{
+	return String() + "value matching \"" + m_pattern + "\"";
+}
+
+CRAP_INLINE
+bool Arg::isSet() const
+{
+	return m_set;
+}
+
+CRAP_INLINE
+const String & Arg::help() const
+{
+	return m_help;
+}
+
+CRAP_INLINE
+void Arg::setHelp(const String & help)
+{
+	m_help = help;
+}
+
+CRAP_INLINE
+bool Arg::required() const
+{
+	return m_required;
+}
+
+CRAP_INLINE
+void Arg::setRequired(bool required)
+{
+	m_required = required;
+	touchSchema();
+}
+
+CRAP_INLINE
+Arg::Arg(const String & help):
+    m_help(help),
+    m_required(false),
+    m_set(false)
+{
+}
+
+CRAP_INLINE
+Arg::Arg(const Arg & other):
+    m_help(other.m_help),
+    m_required(other.m_required),
+    m_set(other.m_set),
+    m_validators(other.m_validators)
+{
+}
+
+CRAP_INLINE
+Arg & Arg::operator =(const Arg & other)
+{
+	m_help = other.m_help;
+	m_required = other.m_required;
+	m_set = other.m_set;
+	m_validators = other.m_validators;
+	touchSchema();
+	return *this;
+}
+
+CRAP_INLINE
+Arg::~Arg()
+{
+	// Parsers, which outlive their command, must not refer to it.
+	for (ParsersContainer::const_iterator it = m_cmdParsers.begin(); it != m_cmdParsers.end(); ++it)
+		(*it)->m_cmd = nullptr;
+}
+
+CRAP_INLINE
+void Arg::touchSchema()
+{
+	for (GroupsContainer::const_iterator it = m_groups.begin(); it != m_groups.end(); ++it)
+		if (**it)
+			(**it)->touchSchema();
+	for (ParsersContainer::const_iterator it = m_cmdParsers.begin(); it != m_cmdParsers.end(); ++it)
+		(*it)->touchSchema();
+}
+
+CRAP_INLINE
+void Arg::addValidator(const Validator * validator)
+{
+	m_validators.push_back(validator);
+	touchSchema();
+}
+
+CRAP_INLINE
+const Validator * Arg::rejectingValidator(const char * value) const
+{
+	for (ValidatorsContainer::const_iterator it = m_validators.begin(); it != m_validators.end(); ++it)
+		if (!(*it)->validate(value))
+			return *it;
+	return nullptr;
+}
+
+CRAP_INLINE
+bool Arg::convertible(const char *) const
+{
+	return true;
+}
+
+CRAP_INLINE
+void Arg::validateValue(const char * value) const
+{
+	if (const Validator * validator = rejectingValidator(value))
+		throw InvalidArgValueException(String() + "Invalid value \"" + value + "\" of argument \"" + synopsis() + "\" (expected " + validator->description() + ").");
+}
+
+CRAP_INLINE
+void Arg::markSet(const String & argName)
+{
+	markSet(argName.c_str());
+}
+
+CRAP_INLINE
+void Arg::markSet(const char * argName)
+{
+	if (isSet())
+		throw ArgAlreadySetException(String() + "Command line argument \"" + argName + "\" has been already set.");
+	m_set = true;
+}
+
+CRAP_INLINE
+void Arg::reset()
+{
+	m_set = false;
+}
+
+CRAP_INLINE
+bool Arg::matches(const char * ) const
+{
+	return false;
+}
+
+CRAP_INLINE
+bool Arg::expectsValue(const char * ) const
+{
+	return false;
+}
+
+CRAP_INLINE
+const String * Arg::valuePtr() const
+{
+	return nullptr;
+}
+
+CRAP_INLINE
+const String * Arg::givenValuePtr() const
+{
+	return valuePtr();
+}
+
+CRAP_INLINE
+const Vector<String> * Arg::keys() const
+{
+	return nullptr;
+}
+
+
+CRAP_INLINE
+ValueArg::ValueArg(const String & valueName, const String & help):
+    Arg(help),
+    m_valueName(valueName),
+    m_value(),
+    m_defaultValue(),
+    m_defaultValuePending(false)
+{
+}
+
+CRAP_INLINE
+const String & ValueArg::value() const
+{
+	if (m_value.empty())
+		return defaultValue();
+	return m_value;
+}
+
+CRAP_INLINE
+const String & ValueArg::valueName() const
+{
+	return m_valueName;
+}
+
+CRAP_INLINE
+ValueArg & ValueArg::setValueName(const String & valueName)
+{
+	m_valueName = valueName;
+	return *this;
+}
+
+CRAP_INLINE
+const String & ValueArg::defaultValue() const
+{
+	if (m_defaultValuePending) {
+		m_defaultValue = m_defaultValueFunction();
+		m_defaultValuePending = false;
+	}
+	return m_defaultValue;
+}
+
+CRAP_INLINE
+ValueArg & ValueArg::setDefaultValue(const String & val)
+{
+	m_defaultValue = val;
+	m_defaultValueFunction = nullptr;
+	m_defaultValuePending = false;
+	m_defaultValuePlaceholder.clear();
+	return *this;
+}
+
+CRAP_INLINE
+ValueArg & ValueArg::setDefaultValue(DefaultValueFunction function, const String & placeholder)
+{
+	m_defaultValue.clear();
+	m_defaultValueFunction = function;
+	m_defaultValuePending = static_cast<bool>(function);
+	m_defaultValuePlaceholder = placeholder;
+	return *this;
+}
+
+CRAP_INLINE
+ValueArg & ValueArg::addValidator(const Validator * validator)
+{
+	Arg::addValidator(validator);
+	return *this;
+}
+
+CRAP_INLINE
+void ValueArg::reset()
+{
+	m_value.clear();
+	Arg::reset();
+}
+
+CRAP_INLINE
+int ValueArg::match(char ** argv, int )
+{
+	if (!isSet()) {
+		setValue(argv[0]);
+		return 1;
+	}
+	return 0;
+}
+
+CRAP_INLINE
+bool ValueArg::matches(const char * ) const
+{
+	return true;
+}
+
+CRAP_INLINE
+const String * ValueArg::valuePtr() const
+{
+	return & value();
+}
+
+CRAP_INLINE
+const String * ValueArg::givenValuePtr() const
+{
+	return & m_value;
+}
+
+CRAP_INLINE
+String ValueArg::synopsis() const
+{
+	return String() + "<" + valueName() + ">";
+}
+
+CRAP_INLINE
+String ValueArg::options() const
+{
+	if (required())
+		return String() + " <" + valueName() + "> ";
+	else
+		return String() + "[ <" + valueName() + "> ]";
+}
+
+CRAP_INLINE
+String ValueArg::description() const
+{
+	// Help does not show default value provided by a function, even if function has been called already.
+	if (m_defaultValueFunction) {
+		if (m_defaultValuePlaceholder.empty())
+			return help();
+		return String(help()).append(" Default value: ").append(m_defaultValuePlaceholder).append(".");
+	}
+	return String(help()).append(" Default value: \"").append(m_defaultValue).append("\".");
+}
+
+CRAP_INLINE
+void ValueArg::setValue(const char * value)
+{
+	validateValue(value);
+	// Assignment reuses capacity of the string, so that parsing does not allocate memory once values have been set.
+	m_value = value;
+	markSet(valueName());
+}
+
+
+CRAP_INLINE
+KeyArg::KeyArg(const String & name, const String & help):
+    Arg(help),
+    m_gluableChar('\0')
+{
+	addAlias(name);
+}
+
+CRAP_INLINE
+const String & KeyArg::name() const
+{
+	return m_aliases[0];
+}
+
+CRAP_INLINE
+const KeyArg::AliasesContainer & KeyArg::aliases() const
+{
+	return m_aliases;
+}
+
+CRAP_INLINE
+KeyArg & KeyArg::addAlias(const String & alias)
+{
+	// Check if alias can be glued.
+	if ((alias.length() == 2) && (alias[0] == Parser::GLUE_CHAR))
+		m_gluableChar = alias[1];
+	m_aliases.push_back(alias);
+	touchSchema();
+	return *this;
+}
+
+CRAP_INLINE
+int KeyArg::match(char ** argv, int )
+{
+	if (matches(argv[0])) {
+		setKey(argv[0]);
+		return 1;
+	}
+	return 0;
+}
+
+CRAP_INLINE
+bool KeyArg::matches(const char * arg) const
+{
+	return std::find(m_aliases.begin(), m_aliases.end(), arg) != m_aliases.end();
+}
+
+CRAP_INLINE
+const KeyArg::AliasesContainer * KeyArg::keys() const
+{
+	return & m_aliases;
+}
+
+CRAP_INLINE
+String KeyArg::synopsis() const
+{
+	return name();
+}
+
+CRAP_INLINE
+String KeyArg::options() const
+{
+	String result;
+	if (!required())
+		result += "[";
+	for (const auto & alias : aliases())
+		result.append(" ").append(alias);
+	if (!required())
+		result += " ]";
+	return result;
+}
+
+CRAP_INLINE
+String KeyArg::description() const
+{
+	return help();
+}
+
+CRAP_INLINE
+void KeyArg::setKey(const char * key)
+{
+	markSet(key);
+}
+
+CRAP_INLINE
+char KeyArg::gluableChar() const
+{
+	return m_gluableChar;
+}
+
+CRAP_INLINE
+String FormatValue(const String & value)
+{
+	return value;
+}
+
+CRAP_INLINE
+bool ConvertBoundValue(const char * str, String & value)
+{
+	value = str;
+	return true;
+}
+
+// Values are formatted into a local buffer rather than a string stream, which would allocate on the heap.
+
+CRAP_INLINE
+String FormatValue(long long value)
+{
+	char buffer[32];
+	std::snprintf(buffer, sizeof(buffer), "%lld", value);
+	return buffer;
+}
+
+CRAP_INLINE
+String FormatValue(unsigned long long value)
+{
+	char buffer[32];
+	std::snprintf(buffer, sizeof(buffer), "%llu", value);
+	return buffer;
+}
+
+CRAP_INLINE
+String FormatValue(long double value)
+{
+	// Default format of std::ostream.
+	char buffer[32];
+	std::snprintf(buffer, sizeof(buffer), "%Lg", value);
+	// Decimal point of the C locale is replaced, so that values are formatted as in the classic locale.
+	const char * decimalPoint = std::localeconv()->decimal_point;
+	if ((decimalPoint[0] != '.') || (decimalPoint[1] != '\0')) {
+		if (char * point = std::strstr(buffer, decimalPoint)) {
+			std::size_t length = std::strlen(decimalPoint);
+			*point = '.';
+			std::memmove(point + 1, point + length, std::strlen(point + length) + 1);
+		}
+	}
+	return buffer;
+}
+
+CRAP_INLINE
+BoundKeyArg::BoundKeyArg(const String & name, bool & target, const String & help):
+    KeyArg(name, help),
+    m_target(& target)
+{
+}
+
+CRAP_INLINE
+bool & BoundKeyArg::target() const
+{
+	return *m_target;
+}
+
+CRAP_INLINE
+void BoundKeyArg::setKey(const char * key)
+{
+	KeyArg::setKey(key);
+	*m_target = true;
+}
+
+CRAP_INLINE
+KeyValueArg::KeyValueArg(const String & name, const String & valueName, const String & help):
+    Arg(help),
+    m_aliases{name},
+    m_valueName(valueName),
+    m_value(),
+    m_defaultValue(),
+    m_defaultValuePending(false)
+{
+}
+
+CRAP_INLINE
+const String & KeyValueArg::name() const
+{
+	return m_aliases[0];
+}
+
+CRAP_INLINE
+const KeyValueArg::AliasesContainer & KeyValueArg::aliases() const
+{
+	return m_aliases;
+}
+
+CRAP_INLINE
+KeyValueArg & KeyValueArg::addAlias(const String & alias)
+{
+	m_aliases.push_back(alias);
+	touchSchema();
+	return *this;
+}
+
+CRAP_INLINE
+const String & KeyValueArg::value() const
+{
+	if (m_value.empty())
+		return defaultValue();
+	return m_value;
+}
+
+CRAP_INLINE
+const String & KeyValueArg::valueName() const
+{
+	return m_valueName;
+}
+
+CRAP_INLINE
+KeyValueArg & KeyValueArg::setValueName(const String & valueName)
+{
+	m_valueName = valueName;
+	return *this;
+}
+
+CRAP_INLINE
+const String & KeyValueArg::defaultValue() const
+{
+	if (m_defaultValuePending) {
+		m_defaultValue = m_defaultValueFunction();
+		m_defaultValuePending = false;
+	}
+	return m_defaultValue;
+}
+
+CRAP_INLINE
+KeyValueArg & KeyValueArg::setDefaultValue(const String & val)
+{
+	m_defaultValue = val;
+	m_defaultValueFunction = nullptr;
+	m_defaultValuePending = false;
+	m_defaultValuePlaceholder.clear();
+	return *this;
+}
+
+CRAP_INLINE
+KeyValueArg & KeyValueArg::setDefaultValue(DefaultValueFunction function, const String & placeholder)
+{
+	m_defaultValue.clear();
+	m_defaultValueFunction = function;
+	m_defaultValuePending = static_cast<bool>(function);
+	m_defaultValuePlaceholder = placeholder;
+	return *this;
+}
+
+CRAP_INLINE
+KeyValueArg & KeyValueArg::addValidator(const Validator * validator)
+{
+	Arg::addValidator(validator);
+	return *this;
+}
+
+CRAP_INLINE
+void KeyValueArg::setValue(const char * value)
+{
+	validateValue(value);
+	m_value = value;
+	markSet(name());
+}
+
+CRAP_INLINE
+void KeyValueArg::reset()
+{
+	m_value.clear();
+	Arg::reset();
+}
+
+CRAP_INLINE
+int KeyValueArg::match(char ** argv, int argc)
+{
+	// Check if argument is in form arg=val.
+	const char * assign = std::strchr(argv[0], '=');
+	std::size_t keyLength = assign ? static_cast<std::size_t>(assign - argv[0]) : std::strlen(argv[0]);
+
+	for (AliasesContainer::const_iterator it = m_aliases.begin(); it != m_aliases.end(); ++it) {
+		if (it->compare(0, String::npos, argv[0], keyLength) == 0) {
+			if (!assign) {
+				if (argc > 1) {
+					if (argv[1][0] == Parser::GLUE_CHAR)
+						throw Exception(String("Loose argument value can not start with \"") + Parser::GLUE_CHAR + "\" (hint: use arg=value syntax).");
+					else {
+						setValue(argv[1]);
+						return 2;
+					}
+				} else
+					throw ArgRequiresValueException(String() + "Command line argument \"" + argv[0] + "\" requires a value.");
+			} else {
+				setValue(assign + 1);
+				return 1;
+			}
+		}
+	}
+	return 0;
+}
+
+CRAP_INLINE
+bool KeyValueArg::matches(const char * arg) const
+{
+	const char * assign = std::strchr(arg, '=');
+	std::size_t keyLength = assign ? static_cast<std::size_t>(assign - arg) : std::strlen(arg);
+	for (AliasesContainer::const_iterator it = m_aliases.begin(); it != m_aliases.end(); ++it)
+		if (it->compare(0, String::npos, arg, keyLength) == 0)
+			return true;
+	return false;
+}
+
+CRAP_INLINE
+bool KeyValueArg::expectsValue(const char * arg) const
+{
+	// Value is passed as the next argument only if argument is not in form arg=val.
+	if (std::strchr(arg, '=') != nullptr)
+		return false;
+	return std::find(m_aliases.begin(), m_aliases.end(), arg) != m_aliases.end();
+}
+
+CRAP_INLINE
+const String * KeyValueArg::valuePtr() const
+{
+	return & value();
+}
+
+CRAP_INLINE
+const String * KeyValueArg::givenValuePtr() const
+{
+	return & m_value;
+}
+
+CRAP_INLINE
+const KeyValueArg::AliasesContainer * KeyValueArg::keys() const
+{
+	return & m_aliases;
+}
+
+CRAP_INLINE
+String KeyValueArg::synopsis() const
+{
+	return name() + "=<" + valueName() + ">";
+}
+
+CRAP_INLINE
+String KeyValueArg::options() const
+{
+	String result;
+	if (!required())
+		result += "[";
+	for (const auto & alias : aliases())
+		result.append(" ").append(alias);
+	result.append(" <").append(valueName()).append(">");
+	if (!required())
+		result += " ]";
+	return result;
+}
+
+CRAP_INLINE
+String KeyValueArg::description() const
+{
+	// Help does not show default value provided by a function, even if function has been called already.
+	if (m_defaultValueFunction) {
+		if (m_defaultValuePlaceholder.empty())
+			return help();
+		return String(help()).append(" Default value: ").append(m_defaultValuePlaceholder).append(".");
+	}
+	return String(help()).append(" Default value: \"").append(m_defaultValue).append("\".");
+}
+
+CRAP_INLINE
+ArgGroup::ArgGroup(const String & name):
+    m_name(name),
+    m_optionRequired(false),
+    m_optionSet(nullptr),
+    m_link(std::allocate_shared<ArgGroup *>(Allocator<ArgGroup *>(), this)),
+    m_touching(false)
+{
+}
+
+CRAP_INLINE
+ArgGroup::~ArgGroup()
+{
+	// Parsers and arguments, which outlive the group, must not refer to it. Arguments hold a link, so that they can be
+	// destroyed before or after the group without searching each other.
+	for (OwnersContainer::const_iterator it = m_owners.begin(); it != m_owners.end(); ++it) {
+		Parser::ArgGroupsContainer & groups = (*it)->m_argGroups;
+		groups.erase(std::remove(groups.begin(), groups.end(), this), groups.end());
+		(*it)->touchSchema();
+	}
+	*m_link = nullptr;
+}
+
+CRAP_INLINE
+void ArgGroup::setName(const String & name)
+{
+	m_name = name;
+}
+
+CRAP_INLINE
+String ArgGroup::name() const
+{
+	return m_name;
+}
+
+CRAP_INLINE
+void ArgGroup::setOptionRequired(bool required)
+{
+	m_optionRequired = required;
+	touchSchema();
+}
+
+CRAP_INLINE
+bool ArgGroup::optionRequired() const
+{
+	return m_optionRequired;
+}
+
+CRAP_INLINE
+ArgGroup & ArgGroup::addAttr(ValueArg * arg)
+{
+	m_valueAttrs.push_back(arg);
+	linkArg(arg);
+	touchSchema();
+	return *this;
+}
+
+CRAP_INLINE
+ArgGroup & ArgGroup::addAttr(KeyArg * arg)
+{
+	m_keyAttrs.push_back(arg);
+	linkArg(arg);
+	touchSchema();
+	return *this;
+}
+
+CRAP_INLINE
+ArgGroup & ArgGroup::addAttr(KeyValueArg * arg)
+{
+	m_keyValueAttrs.push_back(arg);
+	linkArg(arg);
+	touchSchema();
+	return *this;
+}
+
+CRAP_INLINE
+ArgGroup & ArgGroup::addDependency(const Arg * arg, const Arg * requiredArg)
+{
+	m_constraints.push_back(Constraint{Constraint::DEPENDENCY, {arg, requiredArg}});
+	touchSchema();
+	return *this;
+}
+
+CRAP_INLINE
+ArgGroup & ArgGroup::addMutualExclusion(const Vector<const Arg *> & args)
+{
+	m_constraints.push_back(Constraint{Constraint::MUTUAL_EXCLUSION, args});
+	touchSchema();
+	return *this;
+}
+
+CRAP_INLINE
+ArgGroup & ArgGroup::addConflict(const Arg * arg, const Arg * otherArg)
+{
+	return addMutualExclusion({arg, otherArg});
+}
+
+CRAP_INLINE
+const ArgGroup::ConstraintsContainer & ArgGroup::constraints() const
+{
+	return m_constraints;
+}
+
+CRAP_INLINE
+Parser * ArgGroup::addCmd(Arg * cmd)
+{
+	m_parsers.push_back(std::unique_ptr<Parser, Deleter<Parser>>(New<Parser>(cmd)));
+	m_parsers.back()->m_ownerGroup = this;
+	touchSchema();
+	return m_parsers.back().get();
+}
+
+CRAP_INLINE
+void ArgGroup::touchSchema()
+{
+	if (m_touching)
+		return;
+	m_touching = true;
+	for (OwnersContainer::const_iterator it = m_owners.begin(); it != m_owners.end(); ++it)
+		(*it)->touchSchema();
+	m_touching = false;
+}
+
+CRAP_INLINE
+void ArgGroup::linkArg(Arg * arg)
+{
+	if (std::find(arg->m_groups.begin(), arg->m_groups.end(), m_link) == arg->m_groups.end())
+		arg->m_groups.push_back(m_link);
+}
+
+CRAP_INLINE
+void ArgGroup::markOptionSet(Arg * cmd)
+{
+	m_optionSet = cmd;
+}
+
+CRAP_INLINE
+Arg * ArgGroup::optionSet() const
+{
+	return m_optionSet;
+}
+
+CRAP_INLINE
+ArgGroup::ParsersContainer & ArgGroup::parsers()
+{
+	return m_parsers;
+}
+
+CRAP_INLINE
+ArgGroup::ValueAttrsContainer & ArgGroup::valueAttrs()
+{
+	return m_valueAttrs;
+}
+
+CRAP_INLINE
+ArgGroup::KeyAttrsContainer & ArgGroup::keyAttrs()
+{
+	return m_keyAttrs;
+}
+
+CRAP_INLINE
+ArgGroup::KeyValueAttrsContainer & ArgGroup::keyValueAttrs()
+{
+	return m_keyValueAttrs;
+}
+
+CRAP_INLINE
+void ArgGroup::reset()
+{
+	m_optionSet = nullptr;
+	for (ParsersContainer::iterator it = m_parsers.begin(); it != m_parsers.end(); ++it)
+		(*it)->reset();
+	for (ValueAttrsContainer::iterator it = m_valueAttrs.begin(); it != m_valueAttrs.end(); ++it)
+		(*it)->reset();
+	for (KeyAttrsContainer::iterator it = m_keyAttrs.begin(); it != m_keyAttrs.end(); ++it)
+		(*it)->reset();
+	for (KeyValueAttrsContainer::iterator it = m_keyValueAttrs.begin(); it != m_keyValueAttrs.end(); ++it)
+		(*it)->reset();
+}
+
+CRAP_INLINE
+String ArgGroup::optionalCmdsSynopsis() const
+{
+	String result;
+	for (ParsersContainer::const_iterator it = m_parsers.begin(); it != m_parsers.end(); ++it)
+		if (!(*it)->cmd()->required()) {
+			if (!result.empty())
+				result += '|';
+			result += (*it)->cmd()->synopsis();
+		}
+	return result;
+}
+
+CRAP_INLINE
+void ArgGroup::synopsis(std::map<const void *, String> & synopsisLines, String & result) const
+{
+	String keyRequiredSynopsis;
+	String keyOptionalSynopsis;
+	String keyRequiredGluedSynopsis;
+	String keyOptionalGluedSynopsis;
+	String keyValRequiredSynopsis;
+	String keyValOptionalSynopsis;
+	String valRequiredSynopsis;
+	String valOptionalSynopsis;
+
+	// Synopses of sub-parsers are appended directly to the result.
+	bool requiredParsers = false;
+	bool optionalParsers = false;
+	for (ParsersContainer::const_iterator it = m_parsers.begin(); it != m_parsers.end(); ++it)
+		if ((*it)->cmd()->required()) {
+			result.append(" ");
+			(*it)->synopsis(synopsisLines, result);
+			requiredParsers = true;
+		} else
+			optionalParsers = true;
+	if (optionalParsers) {
+		result += requiredParsers ? '|' : ' ';
+		if (!optionRequired())
+			result += '[';
+		bool first = true;
+		for (ParsersContainer::const_iterator it = m_parsers.begin(); it != m_parsers.end(); ++it)
+			if (!(*it)->cmd()->required()) {
+				if (!first)
+					result += '|';
+				(*it)->synopsis(synopsisLines, result);
+				first = false;
+			}
+		if (!optionRequired())
+			result += ']';
+	}
+
+	for (KeyAttrsContainer::const_iterator it = m_keyAttrs.begin(); it != m_keyAttrs.end(); ++it) {
+		if ((*it)->gluableChar() != '\0') {
+			if ((*it)->required()) {
+				if (keyRequiredGluedSynopsis.empty())
+					keyRequiredGluedSynopsis += " -";
+				keyRequiredGluedSynopsis += (*it)->gluableChar();
+			} else {
+				if (keyOptionalGluedSynopsis.empty())
+					keyOptionalGluedSynopsis += " [-";
+				keyOptionalGluedSynopsis += (*it)->gluableChar();
+			}
+		} else if ((*it)->required())
+			keyRequiredSynopsis.append(" ").append((*it)->synopsis());
+		else
+			keyOptionalSynopsis.append(" ").append((*it)->synopsis());
+	}
+	if (!keyOptionalGluedSynopsis.empty())
+		keyOptionalGluedSynopsis += "]";
+
+	for (KeyValueAttrsContainer::const_iterator it = m_keyValueAttrs.begin(); it != m_keyValueAttrs.end(); ++it) {
+		if ((*it)->required())
+			keyValRequiredSynopsis.append(" ").append((*it)->synopsis());
+		else
+			keyValOptionalSynopsis.append(" [").append((*it)->synopsis()).append("]");
+	}
+
+	for (ValueAttrsContainer::const_iterator it = m_valueAttrs.begin(); it != m_valueAttrs.end(); ++it) {
+		if ((*it)->required())
+			valRequiredSynopsis.append(" ").append((*it)->synopsis());
+		else
+			valOptionalSynopsis.append(" [").append((*it)->synopsis()).append("]");
+	}
+
+	result.append(keyRequiredGluedSynopsis).append(keyOptionalGluedSynopsis).append(keyRequiredSynopsis).append(keyOptionalSynopsis);
+	result.append(keyValRequiredSynopsis).append(keyValOptionalSynopsis);
+	result.append(valRequiredSynopsis).append(valOptionalSynopsis);
+}
+
+CRAP_INLINE
+void ArgGroup::description(std::map<const void *, String> & descriptionParagraphs, String & result) const
+{
+	std::size_t maxWide = 0;
+
+	String requiredDescription;
+	String optionalDescription;
+
+	// Calculate widths for description formatting.
+	for (ParsersContainer::const_iterator it = m_parsers.begin(); it != m_parsers.end(); ++it)
+		maxWide = std::max((*it)->cmd()->options().length(), maxWide);
+	for (KeyAttrsContainer::const_iterator it = m_keyAttrs.begin(); it != m_keyAttrs.end(); ++it)
+		maxWide = std::max((*it)->options().length(), maxWide);
+	for (KeyValueAttrsContainer::const_iterator it = m_keyValueAttrs.begin(); it != m_keyValueAttrs.end(); ++it)
+		maxWide = std::max((*it)->options().length(), maxWide);
+	for (ValueAttrsContainer::const_iterator it = m_valueAttrs.begin(); it != m_valueAttrs.end(); ++it)
+		maxWide = std::max((*it)->options().length(), maxWide);
+
+	for (ParsersContainer::const_iterator it = m_parsers.begin(); it != m_parsers.end(); ++it) {
+		String options = (*it)->cmd()->options();
+		String * description;
+		if ((*it)->cmd()->required())
+			description = & requiredDescription;
+		else
+			description = & optionalDescription;
+		description->append(options).append(maxWide - options.length(), ' ').append(" - ").append((*it)->cmd()->description()).append("\n");
+	}
+
+	for (KeyAttrsContainer::const_iterator it = m_keyAttrs.begin(); it != m_keyAttrs.end(); ++it) {
+		String options = (*it)->options();
+		String * description;
+		if ((*it)->required())
+			description = & requiredDescription;
+		else
+			description = & optionalDescription;
+		description->append(options).append(maxWide - options.length(), ' ').append(" - ").append((*it)->description()).append("\n");
+	}
+
+	for (KeyValueAttrsContainer::const_iterator it = m_keyValueAttrs.begin(); it != m_keyValueAttrs.end(); ++it) {
+		String options = (*it)->options();
+		String * description;
+		if ((*it)->required())
+			description = & requiredDescription;
+		else
+			description = & optionalDescription;
+		description->append(options).append(maxWide - options.length(), ' ').append(" - ").append((*it)->description()).append("\n");
+	}
+
+	for (ValueAttrsContainer::const_iterator it = m_valueAttrs.begin(); it != m_valueAttrs.end(); ++it) {
+		String options = (*it)->options();
+		String * description;
+		if ((*it)->required())
+			description = & requiredDescription;
+		else
+			description = & optionalDescription;
+		description->append(options).append(maxWide - options.length(), ' ').append(" - ").append((*it)->description()).append("\n");
+	}
+
+	result.append(requiredDescription).append(optionalDescription);
+	for (ParsersContainer::const_iterator it = m_parsers.begin(); it != m_parsers.end(); ++it)
+		(*it)->description(descriptionParagraphs, result);
+}
+
+
+CRAP_INLINE
+Parser::Parser(Arg * cmdArg):
+    m_cmd(cmdArg),
+    m_argGroups{& m_defaultGroup},
+    m_ownerGroup(nullptr),
+    m_revision(1),
+    m_indexRevision(0)
 {
-	friend class ArgGroup;
+	m_defaultGroup.m_owners.push_back(this);
+	if (m_cmd)
+		m_cmd->m_cmdParsers.push_back(this);
+}
 
-	public:
-	    static constexpr char GLUE_CHAR = '-';
+CRAP_INLINE
+Parser::~Parser()
+{
+	// Groups and arguments, which outlive the parser, must not refer to it.
+	for (ArgGroupsContainer::const_iterator it = m_argGroups.begin(); it != m_argGroups.end(); ++it)
+		(*it)->m_owners.erase(std::remove((*it)->m_owners.begin(), (*it)->m_owners.end(), this), (*it)->m_owners.end());
+	if (m_cmd)
+		m_cmd->m_cmdParsers.erase(std::remove(m_cmd->m_cmdParsers.begin(), m_cmd->m_cmdParsers.end(), this), m_cmd->m_cmdParsers.end());
+}
 
-		Parser(Arg * cmdArg);
+CRAP_INLINE
+unsigned long Parser::schemaRevision() const
+{
+	return m_revision;
+}
 
-		void setOptionRequired(bool cmdRequired);
+CRAP_INLINE
+void Parser::touchSchema()
+{
+	m_revision++;
+	if (m_ownerGroup)
+		m_ownerGroup->touchSchema();
+}
 
-		bool optionRequired() const;
+CRAP_INLINE
+Parser & Parser::addAttr(ValueArg * arg)
+{
+	m_defaultGroup.addAttr(arg);
+	return *this;
+}
 
-		Parser & addAttr(ValueArg * arg);
+CRAP_INLINE
+Parser & Parser::addAttr(KeyArg * arg)
+{
+	m_defaultGroup.addAttr(arg);
+	return *this;
+}
 
-		Parser & addAttr(KeyArg * arg);
+CRAP_INLINE
+Parser & Parser::addAttr(KeyValueArg * arg)
+{
+	m_defaultGroup.addAttr(arg);
+	return *this;
+}
 
-		Parser & addAttr(KeyValueArg * arg);
+CRAP_INLINE
+Parser & Parser::addDependency(const Arg * arg, const Arg * requiredArg)
+{
+	m_defaultGroup.addDependency(arg, requiredArg);
+	return *this;
+}
 
-		Parser & addArgGroup(ArgGroup * argGroup);
+CRAP_INLINE
+Parser & Parser::addMutualExclusion(const Vector<const Arg *> & args)
+{
+	m_defaultGroup.addMutualExclusion(args);
+	return *this;
+}
 
-		ArgGroup * group(std::size_t index);
+CRAP_INLINE
+Parser & Parser::addConflict(const Arg * arg, const Arg * otherArg)
+{
+	m_defaultGroup.addConflict(arg, otherArg);
+	return *this;
+}
 
-		Parser * addSubCmd(Arg * cmd);
 
-		void setHeader(const std::string & header);
+CRAP_INLINE
+Parser & Parser::addArgGroup(ArgGroup * argGroup)
+{
+	m_argGroups.push_back(argGroup);
+	argGroup->m_owners.push_back(this);
+	touchSchema();
+	return *this;
+}
 
-		void setFooter(const std::string & footer);
+CRAP_INLINE
+ArgGroup * Parser::group(std::size_t index)
+{
+	return m_argGroups.at(index);
+}
 
-		Arg * cmd() const;
+CRAP_INLINE
+Parser * Parser::addSubCmd(Arg * cmd)
+{
+	return m_defaultGroup.addCmd(cmd);
+}
 
-		void setCmd(Arg * cmdArg);
+CRAP_INLINE
+void Parser::setOptionRequired(bool cmdRequired)
+{
+	m_defaultGroup.setOptionRequired(cmdRequired);
+}
+
+CRAP_INLINE
+bool Parser::optionRequired() const
+{
+	return m_defaultGroup.optionRequired();
+}
+
+CRAP_INLINE
+void Parser::setHeader(const String & header)
+{
+	m_header = header;
+}
 
-		void printSynopsis(std::ostream & stream = std::cout) const;
+CRAP_INLINE
+void Parser::setFooter(const String & footer)
+{
+	m_footer = footer;
+}
 
-		void printDescription(std::ostream & stream = std::cout) const;
+CRAP_INLINE
+void Parser::setCmd(Arg * cmdArg)
+{
+	if (m_cmd)
+		m_cmd->m_cmdParsers.erase(std::remove(m_cmd->m_cmdParsers.begin(), m_cmd->m_cmdParsers.end(), this), m_cmd->m_cmdParsers.end());
+	m_cmd = cmdArg;
+	if (m_cmd)
+		m_cmd->m_cmdParsers.push_back(this);
+	touchSchema();
+}
 
-		void printHelp(std::ostream & stream = std::cout) const;
+CRAP_INLINE
+Arg * Parser::cmd() const
+{
+	return m_cmd;
+}
 
-		int parse(int argc, char * argv[]);
+CRAP_INLINE
+void Parser::printSynopsis() const
+{
+	printSynopsis(std::cout);
+}
 
-	protected:
-		std::string synopsis(std::map<const void *, std::string> & synopsisLines) const;
+CRAP_INLINE
+void Parser::printSynopsis(std::ostream & stream) const
+{
+	printUsage(String(), stream);
+}
 
-		std::string description(std::map<const void *, std::string> & descriptionParagraphs) const;
+CRAP_INLINE
+void Parser::printDescription() const
+{
+	printDescription(std::cout);
+}
 
-	private:
-		typedef std::vector<ArgGroup *> ArgGroupsContainer;
+CRAP_INLINE
+void Parser::printDescription(std::ostream & stream) const
+{
+	stream << m_cmd->description() << "\n";
+	std::map<const void *, String> descriptionParagraphs;
+	String options;
+	description(descriptionParagraphs, options);
+	stream << options;
+	for (auto paragraph = descriptionParagraphs.begin(); paragraph != descriptionParagraphs.end(); ++paragraph)
+		stream << paragraph->second;
+}
 
-		Arg * m_cmd;
-		ArgGroupsContainer m_argGroups;
-		ArgGroup m_defaultGroup;
-		std::string m_header;
-		std::string m_footer;
-};
+CRAP_INLINE
+void Parser::printHelp() const
+{
+	printHelp(std::cout);
+}
 
-inline
-Exception::Exception(const std::string & what):
-    std::runtime_error(what)
+CRAP_INLINE
+void Parser::printHelp(std::ostream & stream) const
 {
+	stream << m_header;
+	printSynopsis(stream);
+	printDescription(stream);
+	stream << m_footer;
 }
 
-inline
-ExcessiveCmdException::ExcessiveCmdException(const std::string & what):
-    Exception(what)
+CRAP_INLINE
+const Parser * Parser::findSubCmd(const Vector<String> & cmdPath) const
 {
+	const Parser * parser = this;
+	for (Vector<String>::const_iterator it = cmdPath.begin(); parser && (it != cmdPath.end()); ++it)
+		parser = parser->findSubCmd(it->c_str());
+	return parser;
 }
 
-inline
-ArgAlreadySetException::ArgAlreadySetException(const std::string & what):
-    Exception(what)
+CRAP_INLINE
+Parser * Parser::findSubCmd(const Vector<String> & cmdPath)
 {
+	return const_cast<Parser *>(static_cast<const Parser *>(this)->findSubCmd(cmdPath));
 }
 
-inline
-ArgRequiresValueException::ArgRequiresValueException(const std::string & what):
-    Exception(what)
+CRAP_INLINE
+void Parser::printSubCmdHelp(const Vector<String> & cmdPath) const
 {
+	printSubCmdHelp(cmdPath, std::cout);
 }
 
-inline
-UnrecognizedArgException::UnrecognizedArgException(const std::string & what, int argNum):
-    Exception(what),
-    m_argNum(argNum)
+CRAP_INLINE
+void Parser::printSubCmdHelp(const Vector<String> & cmdPath, std::ostream & stream) const
 {
+	// Only parsers along the path are visited before the sub-command, which is rendered as if it was the root.
+	String context;
+	const Parser * parser = this;
+	for (std::size_t i = 0; i < cmdPath.size(); i++) {
+		context.append(parser->m_cmd->synopsis()).append(" ");
+		parser = parser->findSubCmd(cmdPath[i].c_str());
+		if (!parser)
+			throw UnrecognizedArgException(String() + "Unrecognized command \"" + cmdPath[i] + "\".", static_cast<int>(i));
+	}
+
+	stream << m_header;
+	parser->printUsage(context, stream);
+	parser->printDescription(stream);
+	stream << m_footer;
 }
 
-inline
-int UnrecognizedArgException::argNum() const
+CRAP_INLINE
+int Parser::parse(int argc, char * argv[])
 {
-	return m_argNum;
+	m_parseState.clear();
+	m_trailingArgs = ArgvSpan();
+	for (int argNum = 0; argNum < argc; argNum++) {
+		feed(argv[argNum], m_parseState);
+		if (m_parseState.endOfOptions) {
+			// Remaining arguments are not touched.
+			if (argNum + 1 < argc)
+				m_trailingArgs = ArgvSpan(argv + argNum + 1, argc - argNum - 1);
+			m_parseState.argNum = argc;
+			break;
+		}
+	}
+	return finish(m_parseState);
 }
 
-inline
-MissingArgException::MissingArgException(const std::string & what):
-    Exception(what)
+CRAP_INLINE
+void Parser::feed(const char * arg)
 {
+	feed(arg, m_parseState);
 }
 
-inline
-bool Arg::isSet() const
+CRAP_INLINE
+int Parser::finish()
 {
-	return m_set;
+	return finish(m_parseState);
 }
 
-inline
-const std::string & Arg::help() const
+CRAP_INLINE
+void Parser::reset()
 {
-	return m_help;
+	m_parseState.clear();
+	m_trailingArgs = ArgvSpan();
+	if (m_cmd)
+		m_cmd->reset();
+	for (ArgGroupsContainer::iterator it = m_argGroups.begin(); it != m_argGroups.end(); ++it)
+		(*it)->reset();
 }
 
-inline
-void Arg::setHelp(const std::string & help)
+CRAP_INLINE
+bool Parser::lint(int argc, char * argv[], ParseErrorsContainer & errors)
 {
-	m_help = help;
+	std::size_t errorCount = errors.size();
+	m_lintState.clear();
+	m_lintState.errors = & errors;
+	for (int argNum = 0; argNum < argc; argNum++)
+		feed(argv[argNum], m_lintState);
+	finish(m_lintState);
+	m_lintState.errors = nullptr;
+	return errors.size() == errorCount;
 }
 
-inline
-bool Arg::required() const
+CRAP_INLINE
+const Parser::ArgvSpan & Parser::trailingArgs() const
 {
-	return m_required;
+	return m_trailingArgs;
 }
 
-inline
-void Arg::setRequired(bool required)
+CRAP_INLINE
+void Parser::setAdaptiveLookup(bool adaptiveLookup)
 {
-	m_required = required;
+	m_aliasIndex.setAdaptive(adaptiveLookup);
 }
 
-inline
-Arg::Arg(const std::string & help):
-    m_help(help),
-    m_required(false),
-    m_set(false)
+CRAP_INLINE
+bool Parser::adaptiveLookup() const
+{
+	return m_aliasIndex.adaptive();
+}
+
+CRAP_INLINE
+Parser::LookupProfile Parser::lookupProfile() const
+{
+	LookupProfile profile;
+	m_aliasIndex.profile(profile);
+	return profile;
+}
+
+CRAP_INLINE
+void Parser::setLookupProfile(const LookupProfile & profile)
+{
+	indexArgs();
+	m_aliasIndex.setProfile(profile);
+}
+
+CRAP_INLINE
+Parser::ArgvSpan::ArgvSpan():
+    argv(nullptr),
+    argc(0)
+{
+}
+
+CRAP_INLINE
+Parser::ArgvSpan::ArgvSpan(char ** argv, int argc):
+    argv(argv),
+    argc(argc)
+{
+}
+
+CRAP_INLINE
+bool Parser::ArgvSpan::empty() const
+{
+	return argc == 0;
+}
+
+CRAP_INLINE
+Parser::Frame::Frame(Parser * parser):
+    parser(parser),
+    valueAttrsPos(0)
+{
+	parser->indexArgs();
+	setArgs.resize(parser->m_indexedArgs.size());
+}
+
+CRAP_INLINE
+void Parser::Frame::assign(Parser * parser)
+{
+	this->parser = parser;
+	valueAttrsPos = 0;
+	parser->indexArgs();
+	setArgs.resize(0);
+	setArgs.resize(parser->m_indexedArgs.size());
+}
+
+CRAP_INLINE
+Parser::ParseState::ParseState():
+    pendingArg(nullptr),
+    pendingParser(nullptr),
+    argNum(0),
+    endOfOptions(false),
+    errors(nullptr)
+{
+}
+
+CRAP_INLINE
+void Parser::ParseState::clear()
+{
+	while (!path.empty())
+		leave();
+	pendingArg = nullptr;
+	pendingParser = nullptr;
+	argNum = 0;
+	endOfOptions = false;
+	errors = nullptr;
+}
+
+CRAP_INLINE
+void Parser::ParseState::enter(Parser * parser)
+{
+	if (spareFrames.empty()) {
+		path.push_back(Frame(parser));
+		return;
+	}
+	path.push_back(std::move(spareFrames.back()));
+	spareFrames.pop_back();
+	path.back().assign(parser);
+}
+
+CRAP_INLINE
+Parser::Frame & Parser::ParseState::leave()
+{
+	spareFrames.push_back(std::move(path.back()));
+	path.pop_back();
+	return spareFrames.back();
+}
+
+CRAP_INLINE
+bool Parser::ParseState::report(ParseError::Code code, int argNum, const Arg * arg)
+{
+	if (!errors)
+		return false;
+	errors->push_back(ParseError(code, argNum, arg));
+	return true;
+}
+
+CRAP_INLINE
+Parser::Token Parser::Classify(char * arg)
+{
+	Token token;
+	token.arg = arg;
+
+	std::size_t assignPos;
+	token.length = Scan(arg, assignPos);
+	token.assign = (assignPos != String::npos);
+	token.keyLength = token.assign ? assignPos : token.length;
+
+	token.dashes = 0;
+	if (arg[0] == Parser::GLUE_CHAR)
+		token.dashes = (arg[1] == Parser::GLUE_CHAR) ? 2 : 1;
+
+	return token;
+}
+
+CRAP_INLINE
+std::size_t Parser::Scan(const char * arg, std::size_t & assignPos)
 {
+	assignPos = String::npos;
+
+#ifdef CRAP_SSE2
+	// Aligned loads do not cross page boundaries. Bits of bytes preceding the argument are masked out in the first block.
+	const char * block = reinterpret_cast<const char *>(reinterpret_cast<std::uintptr_t>(arg) & ~static_cast<std::uintptr_t>(15));
+	unsigned mask = ~0u << (arg - block);
+	const __m128i nuls = _mm_setzero_si128();
+	const __m128i assigns = _mm_set1_epi8('=');
+	for (; ; block += 16, mask = ~0u) {
+		__m128i bytes = _mm_load_si128(reinterpret_cast<const __m128i *>(block));
+		unsigned nulBits = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, nuls))) & mask;
+		unsigned assignBits = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, assigns))) & mask;
+		// Assignment characters following the null character belong to some other string.
+		if (nulBits)
+			assignBits &= (nulBits ^ (nulBits - 1)) >> 1;
+		if (assignBits && (assignPos == String::npos))
+			assignPos = static_cast<std::size_t>(block - arg) + static_cast<std::size_t>(__builtin_ctz(assignBits));
+		if (nulBits)
+			return static_cast<std::size_t>(block - arg) + static_cast<std::size_t>(__builtin_ctz(nulBits));
+	}
+#else
+	const char * c = arg;
+	for (; *c != '\0'; ++c)
+		if ((*c == '=') && (assignPos == String::npos))
+			assignPos = static_cast<std::size_t>(c - arg);
+	return static_cast<std::size_t>(c - arg);
+#endif
 }
 
-inline
-void Arg::markSet(const std::string & argName)
+CRAP_INLINE
+const char * Parser::Token::value() const
 {
-	if (isSet())
-		throw ArgAlreadySetException(std::string() + "Command line argument \"" + argName + "\" has been already set.");
-	m_set = true;
+	return assign ? arg + keyLength + 1 : nullptr;
 }
 
+CRAP_INLINE
+void Parser::indexArgs()
+{
+	if (m_indexRevision == m_revision)
+		return;
+
+	m_indexedArgs.clear();
+	m_groupOffsets.clear();
+	m_unindexedCmds.clear();
+	m_valueAttrs.clear();
+	m_gluableSlots.clear();
+	m_gluableGroups.clear();
+	AliasIndex::AliasesContainer aliases;
+	for (std::size_t grIndex = 0; grIndex < m_argGroups.size(); grIndex++) {
+		ArgGroup * group = m_argGroups[grIndex];
+		m_groupOffsets.push_back(m_indexedArgs.size());
+
+		for (ArgGroup::ParsersContainer::const_iterator it = group->parsers().begin(); it != group->parsers().end(); ++it) {
+			if (const Vector<String> * keys = (*it)->cmd()->keys()) {
+				for (Vector<String>::const_iterator alias = keys->begin(); alias != keys->end(); ++alias)
+					aliases.push_back(AliasIndex::Alias{& *alias, CMD, m_indexedArgs.size()});
+			} else
+				m_unindexedCmds.push_back(m_indexedArgs.size());
+			m_indexedArgs.push_back(IndexedArg{(*it)->cmd(), CMD, grIndex, it->get()});
+		}
 
+		for (ArgGroup::KeyValueAttrsContainer::const_iterator it = group->keyValueAttrs().begin(); it != group->keyValueAttrs().end(); ++it) {
+			for (KeyValueArg::AliasesContainer::const_iterator alias = (*it)->aliases().begin(); alias != (*it)->aliases().end(); ++alias)
+				aliases.push_back(AliasIndex::Alias{& *alias, KEY_VALUE_ATTR, m_indexedArgs.size()});
+			m_indexedArgs.push_back(IndexedArg{*it, KEY_VALUE_ATTR, grIndex, nullptr});
+		}
 
-inline
-ValueArg::ValueArg(const std::string & valueName, const std::string & help):
-    Arg(help),
-    m_valueName(valueName),
-    m_value(),
-    m_defaultValue()
-{
-}
+		for (ArgGroup::KeyAttrsContainer::const_iterator it = group->keyAttrs().begin(); it != group->keyAttrs().end(); ++it) {
+			for (KeyArg::AliasesContainer::const_iterator alias = (*it)->aliases().begin(); alias != (*it)->aliases().end(); ++alias)
+				aliases.push_back(AliasIndex::Alias{& *alias, KEY_ATTR, m_indexedArgs.size()});
+			if ((*it)->gluableChar() != '\0') {
+				if (m_gluableSlots.empty())
+					m_gluableSlots.resize(256, 0);
+				unsigned char & slot = m_gluableSlots[static_cast<unsigned char>((*it)->gluableChar())];
+				if (slot == 0) {
+					m_gluableGroups.push_back(Bitset(m_argGroups.size()));
+					slot = static_cast<unsigned char>(m_gluableGroups.size());
+				}
+				m_gluableGroups[slot - 1].set(grIndex);
+			}
+			m_indexedArgs.push_back(IndexedArg{*it, KEY_ATTR, grIndex, nullptr});
+		}
 
-inline
-const std::string & ValueArg::value() const
-{
-	if (m_value.empty())
-		return m_defaultValue;
-	return m_value;
+		for (ArgGroup::ValueAttrsContainer::const_iterator it = group->valueAttrs().begin(); it != group->valueAttrs().end(); ++it) {
+			m_valueAttrs.push_back(m_indexedArgs.size());
+			m_indexedArgs.push_back(IndexedArg{*it, VALUE_ATTR, grIndex, nullptr});
+		}
+	}
+	m_aliasIndex.build(aliases);
+
+	m_requiredArgs = Bitset(m_indexedArgs.size());
+	for (std::size_t i = 0; i < m_indexedArgs.size(); i++)
+		if (m_indexedArgs[i].arg->required())
+			m_requiredArgs.set(i);
+
+	compileConstraints();
+
+	m_indexRevision = m_revision;
 }
 
-inline
-const std::string & ValueArg::valueName() const
+CRAP_INLINE
+const Parser * Parser::findSubCmd(const char * cmd) const
 {
-	return m_valueName;
+	for (ArgGroupsContainer::const_iterator grIt = m_argGroups.begin(); grIt != m_argGroups.end(); ++grIt)
+		for (ArgGroup::ParsersContainer::const_iterator it = (*grIt)->m_parsers.begin(); it != (*grIt)->m_parsers.end(); ++it)
+			if ((*it)->m_cmd->keys() ? (*it)->m_cmd->matches(cmd) : ((*it)->m_cmd->synopsis() == cmd))
+				return it->get();
+	return nullptr;
 }
 
-inline
-ValueArg & ValueArg::setValueName(const std::string & valueName)
+CRAP_INLINE
+void Parser::printUsage(const String & context, std::ostream & stream) const
 {
-	m_valueName = valueName;
-	return *this;
+	std::map<const void *, String> synopsisLines;
+	String usage(context);
+	synopsis(synopsisLines, usage);
+	stream << "Usage: " << usage << "\n";
+	for (auto line = synopsisLines.begin(); line != synopsisLines.end(); ++line)
+		stream << "       " << line->second << "\n";
 }
 
-inline
-const std::string & ValueArg::defaultValue() const
+CRAP_INLINE
+void Parser::compileConstraints()
 {
-	return m_defaultValue;
+	m_constraints.clear();
+	for (ArgGroupsContainer::const_iterator grIt = m_argGroups.begin(); grIt != m_argGroups.end(); ++grIt)
+		for (ArgGroup::ConstraintsContainer::const_iterator it = (*grIt)->constraints().begin(); it != (*grIt)->constraints().end(); ++it) {
+			CompiledConstraint compiled{& *it, Bitset(m_indexedArgs.size()), Bitset(m_indexedArgs.size())};
+			if (it->kind == ArgGroup::Constraint::DEPENDENCY) {
+				maskArg(it->args[0], compiled.args);
+				maskArg(it->args[1], compiled.requiredArgs);
+			} else
+				for (Vector<const Arg *>::const_iterator arg = it->args.begin(); arg != it->args.end(); ++arg)
+					maskArg(*arg, compiled.args);
+			m_constraints.push_back(std::move(compiled));
+		}
 }
 
-inline
-ValueArg & ValueArg::setDefaultValue(const std::string & val)
+CRAP_INLINE
+void Parser::maskArg(const Arg * arg, Bitset & mask) const
 {
-	m_defaultValue = val;
-	return *this;
+	// Argument may be present in multiple groups.
+	bool found = false;
+	for (std::size_t i = 0; i < m_indexedArgs.size(); i++)
+		if (m_indexedArgs[i].arg == arg) {
+			mask.set(i);
+			found = true;
+		}
+	if (!found)
+		throw Exception(String() + "Constraint refers to argument \"" + arg->synopsis() + "\", which does not belong to parser \"" + m_cmd->synopsis() + "\".");
 }
 
-inline
-int ValueArg::match(char ** argv, int )
+CRAP_INLINE
+String Parser::checkConstraints(const Bitset & setArgs, int argNum, ParseState & state) const
 {
-	if (!isSet()) {
-		setValue(argv[0]);
-		return 1;
+	String message;
+	for (CompiledConstraintsContainer::const_iterator it = m_constraints.begin(); it != m_constraints.end(); ++it) {
+		const Vector<const Arg *> & args = it->constraint->args;
+		if (it->constraint->kind == ArgGroup::Constraint::DEPENDENCY) {
+			if (!setArgs.intersects(it->args) || setArgs.intersects(it->requiredArgs))
+				continue;
+			if (!state.report(ParseError::CONSTRAINT_VIOLATION, argNum, args[0]))
+				message.append(message.empty() ? "" : " ").append("Argument \"").append(args[0]->synopsis()).append("\" requires \"").append(args[1]->synopsis()).append("\".");
+		} else {
+			if (setArgs.intersectionCount(it->args) <= 1)
+				continue;
+			if (state.report(ParseError::CONSTRAINT_VIOLATION, argNum, args.empty() ? nullptr : args[0]))
+				continue;
+			if (args.size() == 2)
+				message.append(message.empty() ? "" : " ").append("Can not use both: \"").append(args[0]->synopsis()).append("\" and \"").append(args[1]->synopsis()).append("\" at the same time.");
+			else {
+				message.append(message.empty() ? "" : " ").append("Can not use more than one of: ");
+				for (Vector<const Arg *>::const_iterator arg = args.begin(); arg != args.end(); ++arg)
+					message.append(arg == args.begin() ? "\"" : ", \"").append((*arg)->synopsis()).append("\"");
+				message.append(".");
+			}
+		}
 	}
-	return 0;
+	return message;
 }
 
-inline
-std::string ValueArg::synopsis() const
+CRAP_INLINE
+Parser::AliasIndex::AliasIndex():
+    m_lookups(0),
+    m_adaptive(false)
 {
-	return std::string() + "<" + valueName() + ">";
 }
 
-inline
-std::string ValueArg::options() const
+CRAP_INLINE
+void Parser::AliasIndex::build(AliasesContainer & aliases)
 {
-	if (required())
-		return std::string() + " <" + valueName() + "> ";
-	else
-		return std::string() + "[ <" + valueName() + "> ]";
+	LookupProfile savedProfile;
+	profile(savedProfile);
+
+	// Entries sharing the same alias are ordered by argument index.
+	std::sort(aliases.begin(), aliases.end(), [](const Alias & a, const Alias & b) {
+		int cmp = a.alias->compare(*b.alias);
+		return (cmp < 0) || ((cmp == 0) && (a.argIndex < b.argIndex));
+	});
+
+	m_aliases.clear();
+	m_aliasIds.clear();
+	m_kinds.clear();
+	m_argIndices.clear();
+	for (AliasesContainer::const_iterator it = aliases.begin(); it != aliases.end(); ++it) {
+		m_aliasIds.push_back(m_aliases.intern(*it->alias));
+		m_kinds.push_back(static_cast<unsigned char>(it->kind));
+		m_argIndices.push_back(static_cast<std::uint32_t>(it->argIndex));
+	}
+
+	// Entries are sorted by alias identifiers, so offsets are obtained by counting entries of each alias.
+	m_entryOffsets.assign(m_aliases.size() + 1, 0);
+	for (AliasIdsContainer::const_iterator it = m_aliasIds.begin(); it != m_aliasIds.end(); ++it)
+		m_entryOffsets[*it + 1]++;
+	for (std::size_t i = 1; i < m_entryOffsets.size(); i++)
+		m_entryOffsets[i] += m_entryOffsets[i - 1];
+
+	m_hits.assign(m_aliases.size(), 0);
+	m_lookups = 0;
+	if (!savedProfile.empty())
+		setProfile(savedProfile);
 }
 
-inline
-std::string ValueArg::description() const
+CRAP_INLINE
+std::size_t Parser::AliasIndex::size() const
 {
-	return std::string(help()).append(" Default value: \"").append(defaultValue()).append("\".");
+	return m_kinds.size();
 }
 
-inline
-void ValueArg::setValue(const std::string & value)
+CRAP_INLINE
+Parser::AliasIndex::Range Parser::AliasIndex::find(const char * key, std::size_t keyLength) const
 {
-	m_value = value;
-	markSet(valueName());
+	StringPool::Id id = m_aliases.find(key, keyLength);
+	if (id == StringPool::NO_ID)
+		return Range(0, 0);
+	return Range(m_entryOffsets[id], m_entryOffsets[id + 1]);
 }
 
-
-inline
-KeyArg::KeyArg(const std::string & name, const std::string & help):
-    Arg(help),
-    m_gluableChar('\0')
+CRAP_INLINE
+Parser::AliasIndex::Range Parser::AliasIndex::lookup(const char * key, std::size_t keyLength)
 {
-	addAlias(name);
+	StringPool::Id id = m_aliases.find(key, keyLength);
+	if (id == StringPool::NO_ID)
+		return Range(0, 0);
+
+	if (m_adaptive) {
+		m_hits[id]++;
+		if (++m_lookups == ADAPTATION_PERIOD) {
+			adapt();
+			// Counts are halved, so that index follows changes of traffic and counts do not overflow.
+			for (HitsContainer::iterator it = m_hits.begin(); it != m_hits.end(); ++it)
+				*it /= 2;
+			m_lookups = 0;
+		}
+	}
+	return Range(m_entryOffsets[id], m_entryOffsets[id + 1]);
 }
 
-inline
-const std::string & KeyArg::name() const
+CRAP_INLINE
+void Parser::AliasIndex::setAdaptive(bool adaptive)
 {
-	return m_aliases[0];
+	m_adaptive = adaptive;
 }
 
-inline
-const KeyArg::AliasesContainer & KeyArg::aliases() const
+CRAP_INLINE
+bool Parser::AliasIndex::adaptive() const
 {
-	return m_aliases;
+	return m_adaptive;
 }
 
-inline
-KeyArg & KeyArg::addAlias(const std::string & alias)
+CRAP_INLINE
+void Parser::AliasIndex::profile(LookupProfile & profile) const
 {
-	// Check if alias can be glued.
-	if ((alias.length() == 2) && (alias[0] == Parser::GLUE_CHAR))
-		m_gluableChar = alias[1];
-	m_aliases.push_back(alias);
-	return *this;
+	for (StringPool::Id id = 0; id < m_hits.size(); id++)
+		if (m_hits[id] > 0)
+			profile[String(m_aliases.str(id), m_aliases.length(id))] += m_hits[id];
 }
 
-inline
-int KeyArg::match(char ** argv, int )
+CRAP_INLINE
+void Parser::AliasIndex::setProfile(const LookupProfile & profile)
 {
-	for (AliasesContainer::const_iterator it = m_aliases.begin(); it != m_aliases.end(); ++it) {
-		if (*it == argv[0]) {
-			markSet(argv[0]);
-			return 1;
-		}
+	std::fill(m_hits.begin(), m_hits.end(), 0);
+	for (LookupProfile::const_iterator it = profile.begin(); it != profile.end(); ++it) {
+		StringPool::Id id = m_aliases.find(it->first.data(), it->first.length());
+		if (id != StringPool::NO_ID)
+			m_hits[id] = static_cast<std::uint32_t>(std::min<unsigned long>(it->second, std::numeric_limits<std::uint32_t>::max()));
 	}
-	return 0;
+	adapt();
 }
 
-inline
-std::string KeyArg::synopsis() const
+CRAP_INLINE
+void Parser::AliasIndex::adapt()
 {
-	return name();
+	Vector<StringPool::Id> ids(m_aliases.size());
+	for (StringPool::Id id = 0; id < ids.size(); id++)
+		ids[id] = id;
+	std::stable_sort(ids.begin(), ids.end(), [this](StringPool::Id a, StringPool::Id b) {
+		return m_hits[a] > m_hits[b];
+	});
+	m_aliases.prioritize(ids);
 }
 
-inline
-std::string KeyArg::options() const
+CRAP_INLINE
+Parser::AliasIndex::Range Parser::AliasIndex::findPrefix(const char * key, std::size_t keyLength) const
 {
-	std::string result;
-	if (!required())
-		result += "[";
-	for (const auto & alias : aliases())
-		result.append(" ").append(alias);
-	if (!required())
-		result += " ]";
-	return result;
-}
+	// Lower bound.
+	StringPool::Id first = 0;
+	std::size_t count = m_aliases.size();
+	while (count > 0) {
+		std::size_t step = count / 2;
+		if (comparePrefix(static_cast<StringPool::Id>(first + step), key, keyLength) < 0) {
+			first += static_cast<StringPool::Id>(step + 1);
+			count -= step + 1;
+		} else
+			count = step;
+	}
 
-inline
-std::string KeyArg::description() const
-{
-	return help();
+	StringPool::Id last = first;
+	while ((last < m_aliases.size()) && (comparePrefix(last, key, keyLength) == 0))
+		last++;
+	return Range(m_entryOffsets[first], m_entryOffsets[last]);
 }
 
-inline
-char KeyArg::gluableChar() const
+CRAP_INLINE
+const char * Parser::AliasIndex::alias(std::size_t entry) const
 {
-	return m_gluableChar;
+	return m_aliases.str(m_aliasIds[entry]);
 }
 
-inline
-KeyValueArg::KeyValueArg(const std::string & name, const std::string & valueName, const std::string & help):
-    Arg(help),
-    m_aliases{name},
-    m_valueName(valueName),
-    m_value(),
-    m_defaultValue()
+CRAP_INLINE
+Parser::ArgKind Parser::AliasIndex::kind(std::size_t entry) const
 {
+	return static_cast<ArgKind>(m_kinds[entry]);
 }
 
-inline
-const std::string & KeyValueArg::name() const
+CRAP_INLINE
+std::size_t Parser::AliasIndex::argIndex(std::size_t entry) const
 {
-	return m_aliases[0];
+	return m_argIndices[entry];
 }
 
-inline
-const KeyValueArg::AliasesContainer & KeyValueArg::aliases() const
+CRAP_INLINE
+int Parser::AliasIndex::comparePrefix(StringPool::Id id, const char * key, std::size_t keyLength) const
 {
-	return m_aliases;
+	std::size_t aliasLength = std::min(m_aliases.length(id), keyLength);
+	int cmp = std::memcmp(m_aliases.str(id), key, aliasLength);
+	if (cmp != 0)
+		return cmp;
+	return (aliasLength < keyLength) ? -1 : 0;
 }
 
-inline
-KeyValueArg & KeyValueArg::addAlias(const std::string & alias)
+CRAP_INLINE
+void Parser::feed(const char * arg, ParseState & state)
 {
-	m_aliases.push_back(alias);
-	return *this;
+	int argNum = state.argNum++;
+	if (state.endOfOptions)
+		return;
+
+	// Validators are run by arguments, which are not aware of argument positions.
+	try {
+		feedArg(arg, argNum, state);
+	} catch (InvalidArgValueException & e) {
+		e.m_argNum = argNum;
+		throw;
+	}
 }
 
-inline
-const std::string & KeyValueArg::value() const
+CRAP_INLINE
+void Parser::feedArg(const char * arg, int argNum, ParseState & state)
 {
-	if (m_value.empty())
-		return m_defaultValue;
-	return m_value;
+	// Arguments are not modified, but Arg::match() follows main() signature.
+	char * argPtr = const_cast<char *>(arg);
+
+	if (state.pendingArg) {
+		// Previous argument is a key, which expects this argument to be its value.
+		Arg * pendingArg = state.pendingArg;
+		state.pendingArg = nullptr;
+		if (!state.errors) {
+			char * keyValueArgv[] = {& state.pendingKey[0], argPtr};
+			pendingArg->match(keyValueArgv, 2);
+			argPtr = nullptr;
+		} else if (arg[0] != Parser::GLUE_CHAR) {
+			lintValue(pendingArg, arg, state);
+			argPtr = nullptr;
+		} else
+			// Loose value can not start with GLUE_CHAR, so process the argument as if the value has been omitted.
+			state.report(ParseError::ARG_REQUIRES_VALUE, argNum - 1, pendingArg);
+	}
+	enterCmd(nullptr, nullptr, false, state);
+
+	if (!argPtr)
+		return;
+
+	if (!state.path.empty() && (std::strcmp(arg, END_OF_OPTIONS) == 0)) {
+		state.endOfOptions = true;
+		return;
+	}
+
+	if (state.path.empty()) {
+		// First argument must match command argument of this parser.
+		bool expectsValue;
+		if (matchCmd(m_cmd, argPtr, expectsValue, state))
+			enterCmd(this, argPtr, expectsValue, state);
+		else if (!state.report(ParseError::UNRECOGNIZED_ARG, argNum, nullptr))
+			throw UnrecognizedArgException(String() + "Unrecognized argument \"" + arg + "\".", argNum);
+	} else {
+		// Try parsers along the path, starting from the most nested one. Parser, which can not consume an argument is done.
+		// Argument is treated as an abbreviation of a long option only if none of the parsers along the path recognizes it
+		// exactly, so that abbreviations known to nested parsers do not shadow arguments of enclosing parsers.
+		Token token = Classify(argPtr);
+		bool innermost = true;
+		bool abbreviate = false;
+		while (!(abbreviate ? state.path.back().parser->consumeAbbreviation(token, state) : state.path.back().parser->consume(token, state))) {
+			if (innermost) {
+				innermost = false;
+				if ((token.keyLength > 2) && (token.dashes == 2)) {
+					abbreviate = true;
+					for (ParseState::PathContainer::const_iterator it = state.path.begin(); abbreviate && (it + 1 != state.path.end()); ++it)
+						abbreviate = !it->parser->recognizes(token);
+					if (abbreviate)
+						continue;
+				}
+			}
+			if (state.path.size() == 1) {
+				if (!state.report(ParseError::UNRECOGNIZED_ARG, argNum, nullptr))
+					throw UnrecognizedArgException(String() + "Unrecognized argument \"" + arg + "\".", argNum);
+				return;
+			}
+			Frame & frame = state.leave();
+			frame.parser->validate(frame.setArgs, argNum, state);
+		}
+	}
+	enterCmd(nullptr, nullptr, false, state);
 }
 
-inline
-const std::string & KeyValueArg::valueName() const
+CRAP_INLINE
+int Parser::finish(ParseState & state)
 {
-	return m_valueName;
+	int argNum = state.argNum;
+	Arg * pendingArg = state.pendingArg;
+	state.pendingArg = nullptr;
+	state.pendingParser = nullptr;
+	state.argNum = 0;
+
+	if (pendingArg && !state.report(ParseError::ARG_REQUIRES_VALUE, argNum - 1, pendingArg)) {
+		state.clear();
+		throw ArgRequiresValueException(String() + "Command line argument \"" + state.pendingKey + "\" requires a value.");
+	}
+	if (state.path.empty() && !pendingArg && !state.report(ParseError::MISSING_ARG, argNum, m_cmd))
+		throw MissingArgException(String("Missing required argument \"") + m_cmd->synopsis() + "\".");
+
+	// Validate parsers, starting from the most nested one. Frames are popped first, so that state is clear if exception is thrown.
+	while (!state.path.empty()) {
+		Frame & frame = state.leave();
+		frame.parser->validate(frame.setArgs, argNum, state);
+	}
+
+	return argNum;
 }
 
-inline
-KeyValueArg & KeyValueArg::setValueName(const std::string & valueName)
+CRAP_INLINE
+void Parser::lintValue(const Arg * arg, const char * value, ParseState & state)
 {
-	m_valueName = valueName;
-	return *this;
+	if (!arg->convertible(value) || arg->rejectingValidator(value))
+		state.report(ParseError::INVALID_ARG_VALUE, state.argNum - 1, arg);
 }
 
-inline
-const std::string & KeyValueArg::defaultValue() const
+CRAP_INLINE
+bool Parser::matchCmd(Arg * cmd, char * arg, bool & expectsValue, ParseState & state)
 {
-	return m_defaultValue;
+	expectsValue = cmd->expectsValue(arg);
+	if (expectsValue)
+		return true;
+	if (state.errors) {
+		if (!cmd->matches(arg))
+			return false;
+		if (const char * assign = std::strchr(arg, '='))
+			lintValue(cmd, assign + 1, state);
+		return true;
+	}
+	return cmd->match(& arg, 1) != 0;
 }
 
-inline
-KeyValueArg & KeyValueArg::setDefaultValue(const std::string & val)
+CRAP_INLINE
+void Parser::enterCmd(Parser * parser, char * arg, bool expectsValue, ParseState & state)
 {
-	m_defaultValue = val;
-	return *this;
+	if (parser) {
+		if (expectsValue) {
+			state.pendingArg = parser->cmd();
+			state.pendingKey = arg;
+		}
+		state.pendingParser = parser;
+	}
+
+	// Enter parser, which command argument has been matched, unless command still waits for its value.
+	if (state.pendingParser && !state.pendingArg) {
+		state.enter(state.pendingParser);
+		state.pendingParser = nullptr;
+	}
 }
 
-inline
-void KeyValueArg::setValue(const std::string & value)
+CRAP_INLINE
+bool Parser::consumeCmd(std::size_t index, char * arg, ParseState & state)
 {
-	m_value = value;
-	markSet(name());
+	const IndexedArg & indexedArg = m_indexedArgs[index];
+	ArgGroup * group = m_argGroups[indexedArg.groupIndex];
+	Arg * cmd = indexedArg.arg;
+	bool expectsValue;
+	if (!matchCmd(cmd, arg, expectsValue, state))
+		return false;
+
+	Bitset & setArgs = state.path.back().setArgs;
+	if (state.errors) {
+		if (setArgs.test(index))
+			state.report(ParseError::ARG_ALREADY_SET, state.argNum - 1, cmd);
+		if (!cmd->required())
+			for (std::size_t i = m_groupOffsets[indexedArg.groupIndex]; i < m_groupOffsets[indexedArg.groupIndex] + group->parsers().size(); i++)
+				if ((i != index) && setArgs.test(i) && !m_indexedArgs[i].arg->required()) {
+					state.report(ParseError::EXCESSIVE_CMD, state.argNum - 1, cmd);
+					break;
+				}
+	} else if (!cmd->required()) {
+		if (group->optionSet())
+			throw ExcessiveCmdException(String() + "Can not use both: \"" + group->optionSet()->synopsis() + "\" and \"" + cmd->synopsis() + "\" at the same time.");
+		group->markOptionSet(cmd);
+	}
+	setArgs.set(index);
+
+	// Parser is entered by the caller of consume(), so that reference to the current frame is not invalidated.
+	if (expectsValue) {
+		state.pendingArg = cmd;
+		state.pendingKey = arg;
+	}
+	state.pendingParser = indexedArg.parser;
+	return true;
 }
 
-inline
-int KeyValueArg::match(char ** argv, int argc)
+CRAP_INLINE
+bool Parser::consume(const Token & token, ParseState & state)
 {
-	std::string arg = argv[0];
-	std::string val;
+	// Commands, which can not be found by aliases, are probed first.
+	for (ArgIndicesContainer::const_iterator it = m_unindexedCmds.begin(); it != m_unindexedCmds.end(); ++it)
+		if (consumeCmd(*it, token.arg, state))
+			return true;
+
+	// Look up commands, key-value and key-only arguments of all groups at once. Entries are ordered by argument index, so the
+	// first acceptable entry belongs to the first group, which can consume the argument this way.
+	std::size_t hitIndex = m_indexedArgs.size();
+	std::size_t hitGroup = m_argGroups.size();
+	AliasIndex::Range range = m_aliasIndex.lookup(token.arg, token.keyLength);
+	for (std::size_t entry = range.first; entry < range.second; entry++) {
+		const IndexedArg & indexedArg = m_indexedArgs[m_aliasIndex.argIndex(entry)];
+		if (Accepts(indexedArg, token)) {
+			hitIndex = m_aliasIndex.argIndex(entry);
+			hitGroup = indexedArg.groupIndex;
+			break;
+		}
+	}
 
-	// Check if argument is in form arg=val.
-	std::size_t assignPos = arg.find_first_of('=');
-	if (assignPos != std::string::npos) {
-		val = arg.substr(assignPos + 1);
-		arg = arg.substr(0, assignPos);
+	// Groups preceding the one found in alias index may consume argument as glued key-only arguments or as a value.
+	std::size_t gluedGroup = gluedKeyArgsGroup(token);
+	if (gluedGroup < hitGroup) {
+		consumeGluedKeyArgs(token, gluedGroup, state);
+		return true;
 	}
 
-	for (AliasesContainer::const_iterator it = m_aliases.begin(); it != m_aliases.end(); ++it) {
-		if (*it == arg) {
-			if (assignPos == std::string::npos) {
-				if (argc > 1) {
-					if (argv[1][0] == Parser::GLUE_CHAR)
-						throw Exception(std::string("Loose argument value can not start with \"") + Parser::GLUE_CHAR + "\" (hint: use arg=value syntax).");
-					else {
-						setValue(argv[1]);
-						return 2;
-					}
-				} else
-					throw ArgRequiresValueException(std::string() + "Command line argument \"" + argv[0] + "\" requires a value.");
-			} else {
-				setValue(val);
-				return 1;
+	// If argument does not start with CmdParser::GLUE_CHAR, then handle value-only arguments as it may be one of them.
+	// Value-only arguments are never unset while parsing, so the search for an unset one continues where it has stopped.
+	if (token.dashes == 0) {
+		Frame & frame = state.path.back();
+		for (; frame.valueAttrsPos < m_valueAttrs.size(); frame.valueAttrsPos++) {
+			std::size_t index = m_valueAttrs[frame.valueAttrsPos];
+			const IndexedArg & indexedArg = m_indexedArgs[index];
+			if (indexedArg.groupIndex >= hitGroup)
+				break;
+			if (state.errors ? !frame.setArgs.test(index) : !indexedArg.arg->isSet()) {
+				if (!state.errors)
+					static_cast<ValueArg *>(indexedArg.arg)->setValue(token.arg);
+				else
+					lintValue(indexedArg.arg, token.arg, state);
+				frame.setArgs.set(index);
+				return true;
 			}
 		}
 	}
-	return 0;
+
+	if (hitIndex < m_indexedArgs.size()) {
+		if (m_indexedArgs[hitIndex].kind == CMD)
+			return consumeCmd(hitIndex, token.arg, state);
+		return consumeAttr(hitIndex, token.arg, token.value(), state);
+	}
+
+	return false;
 }
 
-inline
-std::string KeyValueArg::synopsis() const
+CRAP_INLINE
+bool Parser::recognizes(const Token & token) const
 {
-	return name() + "=<" + valueName() + ">";
+	for (ArgIndicesContainer::const_iterator it = m_unindexedCmds.begin(); it != m_unindexedCmds.end(); ++it)
+		if (m_indexedArgs[*it].arg->expectsValue(token.arg) || m_indexedArgs[*it].arg->matches(token.arg))
+			return true;
+
+	AliasIndex::Range range = m_aliasIndex.find(token.arg, token.keyLength);
+	for (std::size_t entry = range.first; entry < range.second; entry++)
+		if (Accepts(m_indexedArgs[m_aliasIndex.argIndex(entry)], token))
+			return true;
+
+	return gluedKeyArgsGroup(token) < m_argGroups.size();
 }
 
-inline
-std::string KeyValueArg::options() const
+CRAP_INLINE
+bool Parser::Accepts(const IndexedArg & indexedArg, const Token & token)
 {
-	std::string result;
-	if (!required())
-		result += "[";
-	for (const auto & alias : aliases())
-		result.append(" ").append(alias);
-	result.append(" <").append(valueName()).append(">");
-	if (!required())
-		result += " ]";
-	return result;
+	if (indexedArg.kind == CMD)
+		return indexedArg.arg->expectsValue(token.arg) || indexedArg.arg->matches(token.arg);
+	// Key-only arguments can not be assigned a value.
+	return (indexedArg.kind == KEY_VALUE_ATTR) || !token.assign;
 }
 
-inline
-std::string KeyValueArg::description() const
+CRAP_INLINE
+std::size_t Parser::gluedKeyArgsGroup(const Token & token) const
+{
+	// To be glued key-only arguments each character in the glued string must match one of the key-only arguments of a group.
+	if ((token.dashes == 0) || (token.length == 1) || m_gluableSlots.empty())
+		return m_argGroups.size();
+
+	// Skip CmdParser::GLUE_CHAR (i == 0).
+	unsigned char slot = m_gluableSlots[static_cast<unsigned char>(token.arg[1])];
+	if (slot == 0)
+		return m_argGroups.size();
+	// Sets of groups are intersected word by word, so that no Bitset is copied.
+	const Bitset & firstGroups = m_gluableGroups[slot - 1];
+	for (std::size_t w = 0; w < firstGroups.wordCount(); w++) {
+		Bitset::Word word = firstGroups.word(w);
+		for (std::size_t i = 2; word && (i < token.length); i++) {
+			slot = m_gluableSlots[static_cast<unsigned char>(token.arg[i])];
+			if (slot == 0)
+				return m_argGroups.size();
+			word &= m_gluableGroups[slot - 1].word(w);
+		}
+		if (word)
+			for (std::size_t bit = 0; ; bit++, word >>= 1)
+				if (word & 1)
+					return w * Bitset::WORD_BITS + bit;
+	}
+	return m_argGroups.size();
+}
+
+CRAP_INLINE
+void Parser::consumeGluedKeyArgs(const Token & token, std::size_t groupIndex, ParseState & state)
 {
-	return std::string(help()).append(" Default value: \"").append(defaultValue()).append("\".");
+	char glueArg[] = "- ";
+	for (std::size_t i = 1; i < token.length; i++) {
+		glueArg[1] = token.arg[i];
+		AliasIndex::Range range = m_aliasIndex.find(glueArg, 2);
+		for (std::size_t entry = range.first; entry < range.second; entry++) {
+			std::size_t index = m_aliasIndex.argIndex(entry);
+			if ((m_indexedArgs[index].kind == KEY_ATTR) && (m_indexedArgs[index].groupIndex == groupIndex))
+				consumeAttr(index, glueArg, nullptr, state);
+		}
+	}
 }
 
-ArgGroup::ArgGroup(const std::string & name):
-    m_name(name),
-    m_optionRequired(false),
-    m_optionSet(nullptr)
+CRAP_INLINE
+bool Parser::consumeAbbreviation(const Token & token, ParseState & state)
 {
+	// Candidates are identified by alias index entries. Scratch container of the state is reused, so that it does not allocate.
+	ParseState::CandidatesContainer & candidates = state.candidates;
+	candidates.clear();
+	AliasIndex::Range range = m_aliasIndex.findPrefix(token.arg, token.keyLength);
+	for (std::size_t entry = range.first; entry < range.second; entry++) {
+		const IndexedArg & indexedArg = m_indexedArgs[m_aliasIndex.argIndex(entry)];
+		// Commands are not abbreviated and key-only arguments can not be assigned a value.
+		if ((indexedArg.kind == CMD) || (token.assign && (indexedArg.kind != KEY_VALUE_ATTR)))
+			continue;
+		candidates.push_back(ParseState::CandidatesContainer::value_type(indexedArg.arg, entry));
+	}
+
+	// Argument may be present under multiple aliases or in multiple groups. Sorting pairs keeps the first entry of each argument.
+	std::sort(candidates.begin(), candidates.end());
+	candidates.erase(std::unique(candidates.begin(), candidates.end(), [](const ParseState::CandidatesContainer::value_type & a, const ParseState::CandidatesContainer::value_type & b) {
+		return a.first == b.first;
+	}), candidates.end());
+
+	if (candidates.size() == 1) {
+		return consumeAttr(m_aliasIndex.argIndex(candidates.front().second), m_aliasIndex.alias(candidates.front().second), token.value(), state);
+	}
+	if (candidates.size() > 1) {
+		if (state.report(ParseError::AMBIGUOUS_ARG, state.argNum - 1, nullptr))
+			return true;
+		std::sort(candidates.begin(), candidates.end(), [](const ParseState::CandidatesContainer::value_type & a, const ParseState::CandidatesContainer::value_type & b) {
+			return a.second < b.second;
+		});
+		String candidatesString;
+		for (ParseState::CandidatesContainer::const_iterator it = candidates.begin(); it != candidates.end(); ++it)
+			candidatesString.append(candidatesString.empty() ? "\"" : ", \"").append(m_aliasIndex.alias(it->second)).append("\"");
+		throw AmbiguousArgException(String() + "Ambiguous argument \"" + String(token.arg, token.keyLength) + "\" (possible matches: " + candidatesString + ").", state.argNum - 1);
+	}
+	return false;
 }
 
-inline
-void ArgGroup::setName(const std::string & name)
+CRAP_INLINE
+bool Parser::consumeAttr(std::size_t index, const char * key, const char * value, ParseState & state)
 {
-	m_name = name;
+	const IndexedArg & indexedArg = m_indexedArgs[index];
+	Bitset & setArgs = state.path.back().setArgs;
+	if (state.errors && setArgs.test(index))
+		state.report(ParseError::ARG_ALREADY_SET, state.argNum - 1, indexedArg.arg);
+	setArgs.set(index);
+
+	switch (indexedArg.kind) {
+		case KEY_VALUE_ATTR:
+			if (!value) {
+				state.pendingArg = indexedArg.arg;
+				state.pendingKey = key;
+			} else if (!state.errors)
+				static_cast<KeyValueArg *>(indexedArg.arg)->setValue(value);
+			else
+				lintValue(indexedArg.arg, value, state);
+			break;
+		case KEY_ATTR:
+			if (!state.errors)
+				static_cast<KeyArg *>(indexedArg.arg)->setKey(key);
+			break;
+		case CMD:
+		case VALUE_ATTR:
+			break;
+	}
+	return true;
 }
 
-inline
-std::string ArgGroup::name() const
+CRAP_INLINE
+void Parser::validate(const Bitset & setArgs, int argNum, ParseState & state)
 {
-	return m_name;
+	// All violated constraints are reported at once.
+	String constraintsMessage = checkConstraints(setArgs, argNum, state);
+	if (!constraintsMessage.empty())
+		throw ConstraintViolationException(constraintsMessage);
+
+	String message;
+	for (std::size_t grIndex = 0; grIndex < m_argGroups.size(); grIndex++) {
+		ArgGroup * group = m_argGroups[grIndex];
+		if (!group->optionRequired())
+			continue;
+
+		bool optionSet = group->optionSet() != nullptr;
+		if (state.errors) {
+			// Arguments are not marked as set when linting, so optional commands are looked up in the bitset.
+			optionSet = false;
+			for (std::size_t i = 0; i < group->parsers().size(); i++)
+				if (setArgs.test(m_groupOffsets[grIndex] + i) && !group->parsers()[i]->cmd()->required())
+					optionSet = true;
+		}
+		if (!optionSet && !state.report(ParseError::MISSING_ARG, argNum, nullptr))
+			message.append(message.empty() ? "" : " ").append("One of the following arguments must be present: \"").append(group->optionalCmdsSynopsis()).append("\".");
+	}
+
+	// Required arguments, which have not been matched by this parser. Argument shared with other groups or parsers may
+	// have been set elsewhere though, hence the final isSet() check.
+	Vector<Arg *> missingArgs;
+	for (std::size_t w = 0; w < m_requiredArgs.wordCount(); w++) {
+		Bitset::Word missing = m_requiredArgs.word(w) & ~setArgs.word(w);
+		for (std::size_t bit = 0; missing; bit++, missing >>= 1) {
+			Arg * arg = m_indexedArgs[w * Bitset::WORD_BITS + bit].arg;
+			if ((missing & 1) && (state.errors || !arg->isSet()) && !state.report(ParseError::MISSING_ARG, argNum, arg))
+				missingArgs.push_back(arg);
+		}
+	}
+
+	if (missingArgs.size() == 1)
+		message.append(message.empty() ? "" : " ").append("Missing required argument \"").append(missingArgs.front()->synopsis()).append("\".");
+	else if (missingArgs.size() > 1) {
+		message.append(message.empty() ? "" : " ").append("Missing required arguments: ");
+		for (Vector<Arg *>::const_iterator it = missingArgs.begin(); it != missingArgs.end(); ++it)
+			message.append(it == missingArgs.begin() ? "\"" : ", \"").append((*it)->synopsis()).append("\"");
+		message.append(".");
+	}
+
+	if (!message.empty())
+		throw MissingArgException(message);
 }
 
-inline
-void ArgGroup::setOptionRequired(bool required)
+CRAP_INLINE
+void Parser::synopsis(std::map<const void *, String> & synopsisLines, String & result) const
 {
-	m_optionRequired = required;
+	result.append(m_cmd->synopsis());
+	for (ArgGroupsContainer::const_iterator it = m_argGroups.begin(); it != m_argGroups.end(); ++it) {
+		if ((*it)->name().empty())
+			(*it)->synopsis(synopsisLines, result);
+		else {
+			result.append(" (").append((*it)->name()).append(")");
+			if (synopsisLines.find(*it) == synopsisLines.end()) {
+				// Map does not invalidate references on insertion, so nested groups may be added while line is being built.
+				String & line = synopsisLines[*it];
+				line.append("(").append((*it)->name()).append(") :=");
+				(*it)->synopsis(synopsisLines, line);
+			}
+		}
+	}
 }
 
-inline
-bool ArgGroup::optionRequired() const
+CRAP_INLINE
+void Parser::description(std::map<const void *, String> & descriptionParagraphs, String & result) const
 {
-	return m_optionRequired;
+	// Heading is appended up front and removed if there are no options to describe.
+	std::size_t headingPos = result.size();
+	result.append(m_cmd->synopsis()).append(" options:\n");
+	std::size_t optionsPos = result.size();
+	for (ArgGroupsContainer::const_iterator it = m_argGroups.begin(); it != m_argGroups.end(); ++it)
+		if ((*it)->name().empty())
+			(*it)->description(descriptionParagraphs, result);
+		else {
+			if (descriptionParagraphs.find(*it) == descriptionParagraphs.end()) {
+				String & paragraph = descriptionParagraphs[*it];
+				paragraph.append("(").append((*it)->name()).append("):\n");
+				(*it)->description(descriptionParagraphs, paragraph);
+			}
+		}
+
+	if (result.size() == optionsPos)
+		result.resize(headingPos);
 }
 
-inline
-ArgGroup & ArgGroup::addAttr(ValueArg * arg)
+CRAP_INLINE
+Settings::Settings(const Parser & parser)
 {
-	m_valueAttrs.push_back(arg);
-	return *this;
+	addArg(parser.m_cmd);
+	addArgs(parser);
+
+	// Arguments may be shared between groups, so duplicates have to be removed.
+	std::sort(m_entries.begin(), m_entries.end(), [](const Entry & a, const Entry & b) {
+		return std::less<const Arg *>()(a.arg, b.arg);
+	});
+	m_entries.erase(std::unique(m_entries.begin(), m_entries.end(), [](const Entry & a, const Entry & b) {
+		return a.arg == b.arg;
+	}), m_entries.end());
 }
 
-inline
-ArgGroup & ArgGroup::addAttr(KeyArg * arg)
+CRAP_INLINE
+bool Settings::isSet(const Arg & arg) const
 {
-	m_keyAttrs.push_back(arg);
-	return *this;
+	const Entry * entry = find(arg);
+	return entry && entry->set;
 }
 
-inline
-ArgGroup & ArgGroup::addAttr(KeyValueArg * arg)
+CRAP_INLINE
+const String & Settings::value(const Arg & arg) const
 {
-	m_keyValueAttrs.push_back(arg);
-	return *this;
+	static const String EmptyValue;
+
+	const Entry * entry = find(arg);
+	return entry ? entry->value : EmptyValue;
+}
+
+CRAP_INLINE
+void Settings::addArgs(const Parser & parser)
+{
+	for (Parser::ArgGroupsContainer::const_iterator grIt = parser.m_argGroups.begin(); grIt != parser.m_argGroups.end(); ++grIt) {
+		const ArgGroup * group = *grIt;
+		for (ArgGroup::ParsersContainer::const_iterator it = group->m_parsers.begin(); it != group->m_parsers.end(); ++it) {
+			addArg((*it)->m_cmd);
+			addArgs(**it);
+		}
+		for (ArgGroup::KeyValueAttrsContainer::const_iterator it = group->m_keyValueAttrs.begin(); it != group->m_keyValueAttrs.end(); ++it)
+			addArg(*it);
+		for (ArgGroup::KeyAttrsContainer::const_iterator it = group->m_keyAttrs.begin(); it != group->m_keyAttrs.end(); ++it)
+			addArg(*it);
+		for (ArgGroup::ValueAttrsContainer::const_iterator it = group->m_valueAttrs.begin(); it != group->m_valueAttrs.end(); ++it)
+			addArg(*it);
+	}
 }
 
-inline
-Parser * ArgGroup::addCmd(Arg * cmd)
+CRAP_INLINE
+void Settings::addArg(const Arg * arg)
 {
-	m_parsers.push_back(std::unique_ptr<Parser>(new Parser(cmd)));
-	return m_parsers.back().get();
+	const String * value = arg->valuePtr();
+	m_entries.push_back(Entry{arg, arg->isSet(), value ? *value : String()});
 }
 
-inline
-void ArgGroup::markOptionSet(Arg * cmd)
+CRAP_INLINE
+const Settings::Entry * Settings::find(const Arg & arg) const
 {
-	m_optionSet = cmd;
+	EntriesContainer::const_iterator it = std::lower_bound(m_entries.begin(), m_entries.end(), & arg, [](const Entry & entry, const Arg * argPtr) {
+		return std::less<const Arg *>()(entry.arg, argPtr);
+	});
+	if ((it == m_entries.end()) || (it->arg != & arg))
+		return nullptr;
+	return & *it;
 }
 
-inline
-Arg * ArgGroup::optionSet() const
+CRAP_INLINE
+SettingsPublisher::Reader::Reader(const SettingsPublisher & publisher):
+    m_publisher(& publisher),
+    m_generation(publisher.m_generation.load(std::memory_order_acquire)),
+    m_settings(publisher.settings())
 {
-	return m_optionSet;
 }
 
-inline
-ArgGroup::ParsersContainer & ArgGroup::parsers()
+CRAP_INLINE
+const SettingsPublisher::SettingsPtr & SettingsPublisher::Reader::settings()
 {
-	return m_parsers;
+	unsigned long generation = m_publisher->m_generation.load(std::memory_order_acquire);
+	if (generation != m_generation) {
+		m_settings = m_publisher->settings();
+		m_generation = generation;
+	}
+	return m_settings;
 }
 
-inline
-ArgGroup::ValueAttrsContainer & ArgGroup::valueAttrs()
+CRAP_INLINE
+SettingsPublisher::SettingsPublisher(SettingsPtr settings):
+    m_settings(settings),
+    m_generation(0)
 {
-	return m_valueAttrs;
 }
 
-inline
-ArgGroup::KeyAttrsContainer & ArgGroup::keyAttrs()
+CRAP_INLINE
+void SettingsPublisher::publish(SettingsPtr settings)
 {
-	return m_keyAttrs;
+	// Settings are stored before generation is incremented, so that readers, which notice new generation, get new settings.
+	std::atomic_store(& m_settings, settings);
+	m_generation.fetch_add(1, std::memory_order_release);
 }
 
-inline
-ArgGroup::KeyValueAttrsContainer & ArgGroup::keyValueAttrs()
+CRAP_INLINE
+SettingsPublisher::SettingsPtr SettingsPublisher::settings() const
 {
-	return m_keyValueAttrs;
+	return std::atomic_load(& m_settings);
 }
 
-inline
-bool ArgGroup::gluedKeyArgs(const char * arg) const
+CRAP_INLINE
+ParseRecord::ParseRecord(Parser & parser):
+    m_parser(& parser),
+    m_fingerprint(0),
+    m_revision(0),
+    m_data(nullptr),
+    m_size(0)
 {
-	// Basic checks.
-	if (arg[0] != Parser::GLUE_CHAR)
-		return false;
-	if (std::strlen(arg) == 1)
-		return false;
-
-	// To be glued key-only arguments each character in the glued string must match one of the key-only arguments.
-
-	// Skip CmdParser::GLUE_CHAR (i == 0).
-	for (std::size_t i = 1; i < std::strlen(arg); i++) {
-		KeyAttrsContainer::const_iterator it = m_keyAttrs.begin();
-		while (it != m_keyAttrs.end()) {
-			if (arg[i] == (*it)->gluableChar())
-				break;
-			++it;
-		}
-		// These are not glued key-only arguments as one of the characters does not match any of the key-only args.
-		if (it == m_keyAttrs.end())
-			return false;
-	}
-	return true;
 }
 
-inline
-std::string ArgGroup::optionalCmdsSynopsis() const
+CRAP_INLINE
+std::uint64_t ParseRecord::fingerprint()
 {
-	std::string result;
-	for (ParsersContainer::const_iterator it = m_parsers.begin(); it != m_parsers.end(); ++it)
-		if (!(*it)->cmd()->required()) {
-			if (!result.empty())
-				result += '|';
-			result += (*it)->cmd()->synopsis();
-		}
-	return result;
+	layOut();
+	return m_fingerprint;
 }
 
-inline
-std::string ArgGroup::synopsis(std::map<const void *, std::string> & synopsisLines) const
-{
-	std::string subParserRequiredSynopsis;
-	std::string subParserOptionalSynopsis;
-	std::string keyRequiredSynopsis;
-	std::string keyOptionalSynopsis;
-	std::string keyRequiredGluedSynopsis;
-	std::string keyOptionalGluedSynopsis;
-	std::string keyValRequiredSynopsis;
-	std::string keyValOptionalSynopsis;
-	std::string valRequiredSynopsis;
-	std::string valOptionalSynopsis;
-
-	for (ParsersContainer::const_iterator it = m_parsers.begin(); it != m_parsers.end(); ++it)
-		if ((*it)->cmd()->required())
-			subParserRequiredSynopsis.append(" ").append((*it)->synopsis(synopsisLines));
-	std::string parsersSynopsisString;
-	for (ParsersContainer::const_iterator it = m_parsers.begin(); it != m_parsers.end(); ++it)
-		if (!(*it)->cmd()->required()) {
-			if (!parsersSynopsisString.empty())
-				parsersSynopsisString += '|';
-			parsersSynopsisString.append((*it)->synopsis(synopsisLines));
+CRAP_INLINE
+void ParseRecord::write(String & buffer)
+{
+	layOut();
+
+	// Header and argument table are reserved up front and filled in, once offsets of values are known.
+	std::size_t start = buffer.size();
+	std::size_t tablePos = start + HEADER_SIZE;
+	buffer.resize(tablePos + m_args.size() * ENTRY_SIZE);
+	std::uint32_t cmdPathLength = 0;
+	appendCmdPath(*m_parser, buffer, cmdPathLength);
+	for (std::size_t i = 0; i < m_args.size(); i++) {
+		std::uint32_t entry[2] = {NOT_SET, 0};
+		if (m_args[i] && m_args[i]->isSet()) {
+			// Default values are not recorded, so that default value functions are not called.
+			const String * value = m_args[i]->givenValuePtr();
+			entry[0] = static_cast<std::uint32_t>(buffer.size() - start);
+			entry[1] = value ? static_cast<std::uint32_t>(value->length()) : 0;
+			if (value)
+				buffer.append(*value);
+			buffer.push_back('\0');
 		}
-	if (!parsersSynopsisString.empty()) {
-		if (optionRequired())
-			subParserOptionalSynopsis.append(" ").append(parsersSynopsisString);
-		else
-			subParserOptionalSynopsis.append(" [").append(parsersSynopsisString).append("]");
-	}
-
-	for (KeyAttrsContainer::const_iterator it = m_keyAttrs.begin(); it != m_keyAttrs.end(); ++it) {
-		if ((*it)->gluableChar() != '\0') {
-			if ((*it)->required()) {
-				if (keyRequiredGluedSynopsis.empty())
-					keyRequiredGluedSynopsis += " -";
-				keyRequiredGluedSynopsis += (*it)->gluableChar();
-			} else {
-				if (keyOptionalGluedSynopsis.empty())
-					keyOptionalGluedSynopsis += " [-";
-				keyOptionalGluedSynopsis += (*it)->gluableChar();
-			}
-		} else if ((*it)->required())
-			keyRequiredSynopsis.append(" ").append((*it)->synopsis());
-		else
-			keyOptionalSynopsis.append(" ").append((*it)->synopsis());
-	}
-	if (!keyOptionalGluedSynopsis.empty())
-		keyOptionalGluedSynopsis += "]";
-
-	for (KeyValueAttrsContainer::const_iterator it = m_keyValueAttrs.begin(); it != m_keyValueAttrs.end(); ++it) {
-		if ((*it)->required())
-			keyValRequiredSynopsis.append(" ").append((*it)->synopsis());
-		else
-			keyValOptionalSynopsis.append(" [").append((*it)->synopsis()).append("]");
-	}
-
-	for (ValueAttrsContainer::const_iterator it = m_valueAttrs.begin(); it != m_valueAttrs.end(); ++it) {
-		if ((*it)->required())
-			valRequiredSynopsis.append(" ").append((*it)->synopsis());
-		else
-			valOptionalSynopsis.append(" [").append((*it)->synopsis()).append("]");
+		std::memcpy(& buffer[tablePos + i * ENTRY_SIZE], entry, sizeof(entry));
 	}
 
-	std::string result;
-	if (!subParserRequiredSynopsis.empty())
-		subParserOptionalSynopsis[0] = '|';
-	result.append(subParserRequiredSynopsis).append(subParserOptionalSynopsis);
-	result.append(keyRequiredGluedSynopsis).append(keyOptionalGluedSynopsis).append(keyRequiredSynopsis).append(keyOptionalSynopsis);
-	result.append(keyValRequiredSynopsis).append(keyValOptionalSynopsis);
-	result.append(valRequiredSynopsis).append(valOptionalSynopsis);
-	return result;
+	std::uint32_t header[6] = {MAGIC, 0, 0, static_cast<std::uint32_t>(m_args.size()), cmdPathLength, static_cast<std::uint32_t>(buffer.size() - start)};
+	std::memcpy(& header[1], & m_fingerprint, sizeof(m_fingerprint));
+	std::memcpy(& buffer[start], header, sizeof(header));
 }
 
-inline
-std::string ArgGroup::description(std::map<const void *, std::string> & descriptionParagraphs) const
+CRAP_INLINE
+void ParseRecord::load(const char * data, std::size_t size)
 {
-	std::size_t maxWide = 0;
-
-	std::string requiredDescription;
-	std::string optionalDescription;
-
-	// Calculate widths for description formatting.
-	for (ParsersContainer::const_iterator it = m_parsers.begin(); it != m_parsers.end(); ++it)
-		maxWide = std::max((*it)->cmd()->options().length(), maxWide);
-	for (KeyAttrsContainer::const_iterator it = m_keyAttrs.begin(); it != m_keyAttrs.end(); ++it)
-		maxWide = std::max((*it)->options().length(), maxWide);
-	for (KeyValueAttrsContainer::const_iterator it = m_keyValueAttrs.begin(); it != m_keyValueAttrs.end(); ++it)
-		maxWide = std::max((*it)->options().length(), maxWide);
-	for (ValueAttrsContainer::const_iterator it = m_valueAttrs.begin(); it != m_valueAttrs.end(); ++it)
-		maxWide = std::max((*it)->options().length(), maxWide);
-
-	for (ParsersContainer::const_iterator it = m_parsers.begin(); it != m_parsers.end(); ++it) {
-		std::string options = (*it)->cmd()->options();
-		std::string * description;
-		if ((*it)->cmd()->required())
-			description = & requiredDescription;
-		else
-			description = & optionalDescription;
-		description->append(options).append(maxWide - options.length(), ' ').append(" - ").append((*it)->cmd()->description()).append("\n");
+	layOut();
+	m_data = data;
+	m_size = size;
+	m_cmdPath.clear();
+
+	std::uint64_t fingerprint;
+	if ((size < HEADER_SIZE) || (readUInt32(0) != MAGIC) || (readUInt32(20) != size)) {
+		m_data = nullptr;
+		throw Exception("Malformed parse record.");
 	}
-
-	for (KeyAttrsContainer::const_iterator it = m_keyAttrs.begin(); it != m_keyAttrs.end(); ++it) {
-		std::string options = (*it)->options();
-		std::string * description;
-		if ((*it)->required())
-			description = & requiredDescription;
-		else
-			description = & optionalDescription;
-		description->append(options).append(maxWide - options.length(), ' ').append(" - ").append((*it)->description()).append("\n");
+	std::memcpy(& fingerprint, data + 4, sizeof(fingerprint));
+	if ((fingerprint != m_fingerprint) || (readUInt32(12) != m_args.size())) {
+		m_data = nullptr;
+		throw Exception("Parse record has been written for a different schema.");
 	}
 
-	for (KeyValueAttrsContainer::const_iterator it = m_keyValueAttrs.begin(); it != m_keyValueAttrs.end(); ++it) {
-		std::string options = (*it)->options();
-		std::string * description;
-		if ((*it)->required())
-			description = & requiredDescription;
-		else
-			description = & optionalDescription;
-		description->append(options).append(maxWide - options.length(), ' ').append(" - ").append((*it)->description()).append("\n");
+	// Offsets are checked once, so that accessors can trust them.
+	std::size_t cmdPathPos = HEADER_SIZE + m_args.size() * ENTRY_SIZE;
+	std::uint32_t cmdPathLength = readUInt32(16);
+	bool wellFormed = (cmdPathPos <= size) && (cmdPathLength <= (size - cmdPathPos) / 4);
+	for (std::size_t i = 0; wellFormed && (i < m_args.size()); i++) {
+		std::uint32_t offset = readUInt32(HEADER_SIZE + i * ENTRY_SIZE);
+		std::uint32_t length = readUInt32(HEADER_SIZE + i * ENTRY_SIZE + 4);
+		// Repeated occurrences of shared arguments are never written.
+		if (offset != NOT_SET)
+			wellFormed = m_args[i] && (offset >= cmdPathPos + cmdPathLength * 4) && (offset < size) && (length < size - offset) && (data[offset + length] == '\0');
 	}
-
-	for (ValueAttrsContainer::const_iterator it = m_valueAttrs.begin(); it != m_valueAttrs.end(); ++it) {
-		std::string options = (*it)->options();
-		std::string * description;
-		if ((*it)->required())
-			description = & requiredDescription;
-		else
-			description = & optionalDescription;
-		description->append(options).append(maxWide - options.length(), ' ').append(" - ").append((*it)->description()).append("\n");
+	for (std::uint32_t i = 0; wellFormed && (i < cmdPathLength); i++) {
+		std::uint32_t index = readUInt32(cmdPathPos + i * 4);
+		wellFormed = (index < m_args.size()) && m_args[index] && (m_kinds[index] == 'C');
+		if (wellFormed)
+			m_cmdPath.push_back(m_args[index]);
+	}
+	if (!wellFormed) {
+		m_data = nullptr;
+		m_cmdPath.clear();
+		throw Exception("Malformed parse record.");
 	}
-
-	std::string result = requiredDescription + optionalDescription;
-	for (ParsersContainer::const_iterator it = m_parsers.begin(); it != m_parsers.end(); ++it)
-		result += (*it)->description(descriptionParagraphs);
-
-	return result;
 }
 
-
-inline
-Parser::Parser(Arg * cmdArg):
-    m_cmd(cmdArg),
-    m_argGroups{& m_defaultGroup}
+CRAP_INLINE
+bool ParseRecord::isSet(const Arg & arg) const
 {
+	std::uint32_t index = argIndex(arg);
+	return m_data && (index != NOT_SET) && (readUInt32(HEADER_SIZE + index * ENTRY_SIZE) != NOT_SET);
 }
 
-inline
-Parser & Parser::addAttr(ValueArg * arg)
+CRAP_INLINE
+const char * ParseRecord::value(const Arg & arg) const
 {
-	m_defaultGroup.addAttr(arg);
-	return *this;
+	std::uint32_t index = argIndex(arg);
+	if (m_data && (index != NOT_SET)) {
+		std::uint32_t offset = readUInt32(HEADER_SIZE + index * ENTRY_SIZE);
+		// Empty value falls back to the default value, as with ValueArg::value().
+		if ((offset != NOT_SET) && arg.givenValuePtr() && (m_data[offset] != '\0'))
+			return m_data + offset;
+	}
+	const String * value = arg.valuePtr();
+	return value ? value->c_str() : nullptr;
 }
 
-inline
-Parser & Parser::addAttr(KeyArg * arg)
+CRAP_INLINE
+const ParseRecord::CmdPathContainer & ParseRecord::cmdPath() const
 {
-	m_defaultGroup.addAttr(arg);
-	return *this;
+	return m_cmdPath;
 }
 
-inline
-Parser & Parser::addAttr(KeyValueArg * arg)
+CRAP_INLINE
+void ParseRecord::apply()
 {
-	m_defaultGroup.addAttr(arg);
-	return *this;
+	if (!m_data)
+		throw Exception("Parse record has not been loaded.");
+
+	for (std::size_t i = 0; i < m_args.size(); i++) {
+		std::uint32_t offset = readUInt32(HEADER_SIZE + i * ENTRY_SIZE);
+		if (offset == NOT_SET)
+			continue;
+
+		// Attributes are set directly. Commands may be arguments of any type, so they are matched.
+		Arg * arg = m_args[i];
+		const char * value = m_data + offset;
+		switch (m_kinds[i]) {
+			case 'O':
+				static_cast<KeyValueArg *>(arg)->setValue(value);
+				break;
+			case 'F':
+				static_cast<KeyArg *>(arg)->setKey(static_cast<KeyArg *>(arg)->name().c_str());
+				break;
+			case 'V':
+				static_cast<ValueArg *>(arg)->setValue(value);
+				break;
+			default:
+				char * argv;
+				const Vector<String> * keys = arg->keys();
+				if (!keys)
+					argv = const_cast<char *>(value);
+				else if (arg->givenValuePtr()) {
+					// Value is assigned with '=', so that it is not mistaken for a key, if it starts with GLUE_CHAR.
+					m_assignment.assign(keys->front()).append("=").append(value);
+					argv = & m_assignment[0];
+				} else
+					argv = const_cast<char *>(keys->front().c_str());
+				arg->match(& argv, 1);
+				// Group is marked as by Parser, when it matches an optional command.
+				if (m_groups[i] && !arg->required())
+					m_groups[i]->markOptionSet(arg);
+		}
+	}
 }
 
-
-inline
-Parser & Parser::addArgGroup(ArgGroup * argGroup)
+CRAP_INLINE
+void ParseRecord::layOut()
 {
-	m_argGroups.push_back(argGroup);
-	return *this;
+	if (m_revision == m_parser->schemaRevision())
+		return;
+
+	m_args.clear();
+	m_kinds.clear();
+	m_groups.clear();
+	m_argIndices.clear();
+	m_fingerprint = 14695981039346656037ULL;
+	addArg(m_parser->m_cmd, 'C', 0);
+	layOut(*m_parser, 1);
+
+	// Arguments shared between groups or parsers are recorded at their first position only.
+	std::sort(m_argIndices.begin(), m_argIndices.end());
+	for (std::size_t i = 1; i < m_argIndices.size(); i++)
+		if (m_argIndices[i].first == m_argIndices[i - 1].first)
+			m_args[m_argIndices[i].second] = nullptr;
+	m_argIndices.erase(std::unique(m_argIndices.begin(), m_argIndices.end(), [](const ArgIndicesContainer::value_type & a, const ArgIndicesContainer::value_type & b) {
+		return a.first == b.first;
+	}), m_argIndices.end());
+	m_data = nullptr;
+	m_cmdPath.clear();
+	m_revision = m_parser->schemaRevision();
 }
 
-inline
-ArgGroup * Parser::group(std::size_t index)
+CRAP_INLINE
+void ParseRecord::layOut(const Parser & parser, std::uint32_t depth)
 {
-	return m_argGroups.at(index);
+	for (Parser::ArgGroupsContainer::const_iterator grIt = parser.m_argGroups.begin(); grIt != parser.m_argGroups.end(); ++grIt) {
+		ArgGroup * group = *grIt;
+		for (ArgGroup::ParsersContainer::const_iterator it = group->m_parsers.begin(); it != group->m_parsers.end(); ++it) {
+			addArg((*it)->m_cmd, 'C', depth, group);
+			layOut(**it, depth + 1);
+		}
+		for (ArgGroup::KeyValueAttrsContainer::const_iterator it = group->m_keyValueAttrs.begin(); it != group->m_keyValueAttrs.end(); ++it)
+			addArg(*it, 'O', depth);
+		for (ArgGroup::KeyAttrsContainer::const_iterator it = group->m_keyAttrs.begin(); it != group->m_keyAttrs.end(); ++it)
+			addArg(*it, 'F', depth);
+		for (ArgGroup::ValueAttrsContainer::const_iterator it = group->m_valueAttrs.begin(); it != group->m_valueAttrs.end(); ++it)
+			addArg(*it, 'V', depth);
+		addArg(nullptr, 'G', depth);
+	}
 }
 
-inline
-Parser * Parser::addSubCmd(Arg * cmd)
+CRAP_INLINE
+void ParseRecord::addArg(Arg * arg, char kind, std::uint32_t depth, ArgGroup * group)
 {
-	return m_defaultGroup.addCmd(cmd);
+	// Fingerprint covers structure of the schema and the names, by which arguments are identified on the command line.
+	String description(1, kind);
+	description.append(reinterpret_cast<const char *>(& depth), sizeof(depth));
+	if (arg) {
+		if (const Vector<String> * keys = arg->keys())
+			for (Vector<String>::const_iterator it = keys->begin(); it != keys->end(); ++it)
+				description.append(*it).push_back('\0');
+		else
+			description.append(arg->synopsis()).push_back('\0');
+	}
+	for (String::const_iterator it = description.begin(); it != description.end(); ++it) {
+		m_fingerprint ^= static_cast<unsigned char>(*it);
+		m_fingerprint *= 1099511628211ULL;
+	}
+
+	if (arg) {
+		m_argIndices.push_back(std::make_pair(arg, static_cast<std::uint32_t>(m_args.size())));
+		m_args.push_back(arg);
+		m_kinds.push_back(kind);
+		m_groups.push_back(group);
+	}
 }
 
-inline
-void Parser::setOptionRequired(bool cmdRequired)
+CRAP_INLINE
+void ParseRecord::appendCmdPath(const Parser & parser, String & buffer, std::uint32_t & length) const
 {
-	m_defaultGroup.setOptionRequired(cmdRequired);
+	if (!parser.m_cmd->isSet())
+		return;
+
+	std::uint32_t index = argIndex(*parser.m_cmd);
+	buffer.append(reinterpret_cast<const char *>(& index), sizeof(index));
+	length++;
+	for (Parser::ArgGroupsContainer::const_iterator grIt = parser.m_argGroups.begin(); grIt != parser.m_argGroups.end(); ++grIt)
+		for (ArgGroup::ParsersContainer::const_iterator it = (*grIt)->m_parsers.begin(); it != (*grIt)->m_parsers.end(); ++it)
+			appendCmdPath(**it, buffer, length);
 }
 
-inline
-bool Parser::optionRequired() const
+CRAP_INLINE
+std::uint32_t ParseRecord::argIndex(const Arg & arg) const
 {
-	return m_defaultGroup.optionRequired();
+	ArgIndicesContainer::const_iterator it = std::lower_bound(m_argIndices.begin(), m_argIndices.end(), std::make_pair(& arg, std::uint32_t(0)));
+	if ((it == m_argIndices.end()) || (it->first != & arg))
+		return NOT_SET;
+	return it->second;
 }
 
-inline
-void Parser::setHeader(const std::string & header)
+CRAP_INLINE
+std::uint32_t ParseRecord::readUInt32(std::size_t pos) const
 {
-	m_header = header;
+	std::uint32_t value;
+	std::memcpy(& value, m_data + pos, sizeof(value));
+	return value;
 }
 
-inline
-void Parser::setFooter(const std::string & footer)
+CRAP_INLINE
+ParseCache::ParseCache(Parser & parser, std::size_t capacity):
+    m_parser(& parser),
+    m_record(parser),
+    m_capacity(capacity),
+    m_useCounter(0),
+    m_hits(0),
+    m_misses(0),
+    m_revision(parser.schemaRevision())
 {
-	m_footer = footer;
+	m_entries.reserve(capacity);
 }
 
-inline
-void Parser::setCmd(Arg * cmdArg)
+CRAP_INLINE
+int ParseCache::parse(int argc, char * argv[])
 {
-	m_cmd = cmdArg;
+	if (m_revision != m_parser->schemaRevision()) {
+		m_entries.clear();
+		m_revision = m_parser->schemaRevision();
+	}
+
+	m_parser->reset();
+	std::uint64_t hash = Hash(argc, argv);
+	if (Entry * entry = find(hash, argc, argv)) {
+		m_hits++;
+		entry->lastUse = ++m_useCounter;
+		if (entry->error)
+			std::rethrow_exception(entry->error);
+		m_record.load(entry->record.data(), entry->record.size());
+		m_record.apply();
+		if (entry->trailingArgsPos < argc)
+			m_parser->m_trailingArgs = Parser::ArgvSpan(argv + entry->trailingArgsPos, argc - entry->trailingArgsPos);
+		return entry->result;
+	}
+
+	m_misses++;
+	if (m_capacity == 0)
+		return m_parser->parse(argc, argv);
+
+	Entry & entry = insert(hash, argc, argv);
+	try {
+		entry.result = m_parser->parse(argc, argv);
+	} catch (const Exception & ) {
+		entry.error = std::current_exception();
+		throw;
+	} catch (...) {
+		// Other exceptions are not cached. Entry is disabled with argument count, which can not be matched.
+		entry.argc = -1;
+		throw;
+	}
+	const Parser::ArgvSpan & trailingArgs = m_parser->trailingArgs();
+	entry.trailingArgsPos = trailingArgs.empty() ? argc : static_cast<int>(trailingArgs.argv - argv);
+	m_record.write(entry.record);
+	return entry.result;
 }
 
-inline
-Arg * Parser::cmd() const
+CRAP_INLINE
+std::size_t ParseCache::capacity() const
 {
-	return m_cmd;
+	return m_capacity;
 }
 
-inline
-void Parser::printSynopsis(std::ostream & stream) const
+CRAP_INLINE
+std::size_t ParseCache::size() const
 {
-	std::map<const void *, std::string> synopsisLines;
-	stream << "Usage: " << synopsis(synopsisLines) << "\n";
-	for (auto line = synopsisLines.begin(); line != synopsisLines.end(); ++line)
-		stream << "       " << line->second << "\n";
+	return m_entries.size();
 }
 
-inline
-void Parser::printDescription(std::ostream & stream) const
+CRAP_INLINE
+unsigned long ParseCache::hits() const
 {
-	stream << m_cmd->description() << "\n";
-	std::map<const void *, std::string> descriptionParagraphs;
-	stream << description(descriptionParagraphs);
-	for (auto paragraph = descriptionParagraphs.begin(); paragraph != descriptionParagraphs.end(); ++paragraph)
-		stream << paragraph->second;
+	return m_hits;
 }
 
-inline
-void Parser::printHelp(std::ostream & stream) const
+CRAP_INLINE
+unsigned long ParseCache::misses() const
 {
-	stream << m_header;
-	printSynopsis(stream);
-	printDescription(stream);
-	stream << m_footer;
+	return m_misses;
 }
 
-inline
-int Parser::parse(int argc, char * argv[])
+CRAP_INLINE
+void ParseCache::clear()
 {
-	int argNum = m_cmd->match(argv, argc);
-	if (!argNum)
-		throw UnrecognizedArgException(std::string() + "Unrecognized argument \"" + argv[argNum] + "\".", argNum);
-
-	while (argNum < argc) {
-		int argAdvance = 0;
-
-		for (ArgGroupsContainer::iterator grIt = m_argGroups.begin(); grIt != m_argGroups.end(); ++grIt) {
-			ArgGroup * group = *grIt;
-
-			// Look up subcommands first.
-			for (ArgGroup::ParsersContainer::iterator it = group->parsers().begin(); it != group->parsers().end(); ++it) {
-				try {
-					argAdvance = ((*it)->parse(argc - argNum, argv + argNum));
-				} catch (UnrecognizedArgException & e) {
-					argAdvance = e.argNum();
-				}
-				if (argAdvance) {
-					if (!(*it)->cmd()->required()) {
-						if (group->optionSet())
-							throw ExcessiveCmdException(std::string() + "Can not use both: \"" + group->optionSet()->synopsis() + "\" and \"" + (*it)->cmd()->synopsis() + "\" at the same time.");
-						group->markOptionSet((*it)->cmd());
-					}
-					break;
-				}
-			}
-
-			// Check key-value arguments.
-			if (!argAdvance)
-				for (ArgGroup::KeyValueAttrsContainer::iterator it = group->keyValueAttrs().begin(); it != group->keyValueAttrs().end(); ++it) {
-					argAdvance = ((*it)->match(argv + argNum, argc - argNum));
-					if (argAdvance)
-						break;
-				}
-
-			// Check key-only arguments.
-			if (!argAdvance)
-				for (ArgGroup::KeyAttrsContainer::iterator it = group->keyAttrs().begin(); it != group->keyAttrs().end(); ++it) {
-					argAdvance = (*it)->match(argv + argNum, argc - argNum);
-					if (argAdvance)
-						break;
-				}
-			// Check if these are glued key-only arguments.
-			if (!argAdvance && group->gluedKeyArgs(argv[argNum])) {
-				for (std::size_t i = 1; i < std::strlen(argv[argNum]); i++) {
-					char glueArg[] = "- ";
-					char * glueArgv[] = {glueArg};
-					for (ArgGroup::KeyAttrsContainer::iterator it = group->keyAttrs().begin(); it != group->keyAttrs().end(); ++it) {
-						glueArg[1] = argv[argNum][i];
-						(*it)->match(glueArgv, argc - argNum);
-					}
-				}
-				argAdvance++;
-			}
-
-			// If argument does not start with CmdParser::GLUE_CHAR, then handle value-only arguments as it may be one of them.
-			if ((!argAdvance) && (argv[argNum][0] != Parser::GLUE_CHAR))
-				for (ArgGroup::ValueAttrsContainer::iterator it = group->valueAttrs().begin(); it != group->valueAttrs().end(); ++it) {
-					argAdvance = (*it)->match(argv + argNum, argc - argNum);
-					if (argAdvance)
-						break;
-				}
+	m_entries.clear();
+}
 
-			if (argAdvance)
+CRAP_INLINE
+std::uint64_t ParseCache::Hash(int argc, char * argv[])
+{
+	// FNV-1a. Terminators are hashed as well, so that arguments can not be shifted between each other.
+	std::uint64_t hash = 14695981039346656037ULL;
+	for (int i = 0; i < argc; i++)
+		for (const char * c = argv[i]; ; c++) {
+			hash ^= static_cast<unsigned char>(*c);
+			hash *= 1099511628211ULL;
+			if (*c == '\0')
 				break;
 		}
-		if (argAdvance)
-			argNum += argAdvance;
-		else
-			throw UnrecognizedArgException(std::string() + "Unrecognized argument \"" + argv[argNum] + "\".", argNum);
-	}
-
-	for (ArgGroupsContainer::iterator grIt = m_argGroups.begin(); grIt != m_argGroups.end(); ++grIt) {
-		ArgGroup * group = *grIt;
-
-		if (group->optionRequired() && !group->optionSet())
-			throw MissingArgException(std::string("One of the following arguments must be present: \"") + group->optionalCmdsSynopsis() + "\".");
-
-		// Check if all required arguments are set.
-		for (ArgGroup::ParsersContainer::iterator it = group->parsers().begin(); it != group->parsers().end(); ++it)
-			if ((*it)->cmd()->required() && !(*it)->cmd()->isSet())
-				throw MissingArgException(std::string("Missing required argument \"") + (*it)->cmd()->synopsis() + "\".");
-		for (ArgGroup::KeyAttrsContainer::iterator it = group->keyAttrs().begin(); it != group->keyAttrs().end(); ++it)
-			if ((*it)->required() && !(*it)->isSet())
-				throw MissingArgException(std::string("Missing required argument \"") + (*it)->synopsis() + "\".");
-		for (ArgGroup::KeyValueAttrsContainer::iterator it = group->keyValueAttrs().begin(); it != group->keyValueAttrs().end(); ++it)
-			if ((*it)->required() && !(*it)->isSet())
-				throw MissingArgException(std::string("Missing required argument \"") + (*it)->synopsis() + "\".");
-		for (ArgGroup::ValueAttrsContainer::iterator it = group->valueAttrs().begin(); it != group->valueAttrs().end(); ++it)
-			if ((*it)->required() && !(*it)->isSet())
-				throw MissingArgException(std::string("Missing required argument \"") + (*it)->synopsis() + "\".");
-	}
-
-	return argNum;
+	return hash;
 }
 
-inline
-std::string Parser::synopsis(std::map<const void *, std::string> & synopsisLines) const
+CRAP_INLINE
+ParseCache::Entry * ParseCache::find(std::uint64_t hash, int argc, char * argv[])
 {
-	std::string result(m_cmd->synopsis());
-	for (ArgGroupsContainer::const_iterator it = m_argGroups.begin(); it != m_argGroups.end(); ++it) {
-		if ((*it)->name().empty())
-			result += (*it)->synopsis(synopsisLines);
-		else {
-			result.append(" (").append((*it)->name()).append(")");
-			if (synopsisLines.find(*it) == synopsisLines.end())
-				synopsisLines[*it] = std::string("(") + (*it)->name() + ") :=" + (*it)->synopsis(synopsisLines);
-		}
+	for (EntriesContainer::iterator it = m_entries.begin(); it != m_entries.end(); ++it) {
+		if ((it->hash != hash) || (it->argc != argc))
+			continue;
+		const char * arg = it->args.c_str();
+		int i = 0;
+		for (; (i < argc) && (std::strcmp(arg, argv[i]) == 0); i++)
+			arg += std::strlen(arg) + 1;
+		if (i == argc)
+			return & *it;
 	}
-	return result;
+	return nullptr;
 }
 
-inline
-std::string Parser::description(std::map<const void *, std::string> & descriptionParagraphs) const
+CRAP_INLINE
+ParseCache::Entry & ParseCache::insert(std::uint64_t hash, int argc, char * argv[])
 {
-	std::string description;
-	for (ArgGroupsContainer::const_iterator it = m_argGroups.begin(); it != m_argGroups.end(); ++it)
-		if ((*it)->name().empty())
-			description += (*it)->description(descriptionParagraphs);
-		else {
-			if (descriptionParagraphs.find(*it) == descriptionParagraphs.end())
-				descriptionParagraphs[*it] = std::string("(") + (*it)->name() + "):\n" + (*it)->description(descriptionParagraphs);
-		}
-
-	if (!description.empty())
-		return m_cmd->synopsis() + " options:\n" + description;
-	return description;
+	Entry * entry;
+	if (m_entries.size() < m_capacity) {
+		m_entries.push_back(Entry());
+		entry = & m_entries.back();
+	} else
+		entry = & *std::min_element(m_entries.begin(), m_entries.end(), [](const Entry & a, const Entry & b) {
+			return a.lastUse < b.lastUse;
+		});
+
+	// Strings of a recycled entry are reused, so that their capacity is retained.
+	entry->hash = hash;
+	entry->args.clear();
+	for (int i = 0; i < argc; i++)
+		entry->args.append(argv[i]).push_back('\0');
+	entry->argc = argc;
+	entry->result = 0;
+	entry->trailingArgsPos = argc;
+	entry->record.clear();
+	entry->error = nullptr;
+	entry->lastUse = ++m_useCounter;
+	return *entry;
 }
 
+#endif
+
 }
 
 #endif
@@ -0,0 +1,273 @@
+#ifndef CRAP_CMDLINE_HPP
+#define CRAP_CMDLINE_HPP
+
+#include "crap.hpp"
+
+#include <cerrno>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/vfs.h>
+#endif
+
+// C++RAP - C++ Recursive Argument Processor
+namespace crap {
+
+/**
+ * Scanner of null-separated command lines, such as those found in /proc/<pid>/cmdline files. Arguments are fed to a parser
+ * directly from the buffer, which holds them, so neither strings nor arrays of pointers are built. Files are read into a
+ * buffer, which is reused between files. Files larger than cmdline::MAX_FILE_SIZE are rejected without being read whole.
+ */
+class CmdlineScanner
+{
+	public:
+	    /**
+		 * Callback invoked for each scanned file.
+		 * @param path path of a file.
+		 * @param error exception thrown by the parser or @p nullptr if arguments have been parsed successfully. Arguments of
+		 * the parser hold parsed values while callback is invoked.
+		 */
+	    typedef std::function<void (const String & path, const Exception * error)> Callback;
+
+		/**
+		 * Constructor.
+		 * @param parser parser, which is fed with arguments.
+		 */
+	    explicit CmdlineScanner(Parser & parser);
+
+		CmdlineScanner(const CmdlineScanner & other) = delete;
+
+		CmdlineScanner & operator =(const CmdlineScanner & other) = delete;
+
+		/**
+		 * Parse null-separated arguments. Parser is reset beforehand. Terminator of the last argument is optional.
+		 * @param data buffer holding arguments.
+		 * @param size size of a buffer.
+		 * @return number of arguments that have been processed.
+		 */
+		int parse(const char * data, std::size_t size);
+
+		/**
+		 * Parse null-separated arguments stored in a file.
+		 * @param path path of a file.
+		 * @return number of arguments that have been processed.
+		 * @throw Exception if file can not be read or it is larger than cmdline::MAX_FILE_SIZE.
+		 */
+		int parseFile(const String & path);
+
+		/**
+		 * Scan a directory. Each non-empty regular file in the directory is parsed as a command line. For each subdirectory, only
+		 * file named "cmdline" is parsed, if there is one, so that "/proc" can be scanned directly. Regular files of "/proc"
+		 * itself (e.g. "/proc/kcore") are not command lines, so they are skipped, when directory is on procfs. Symbolic links are
+		 * not followed, so that entries such as "/proc/self" do not repeat command lines of processes, which are scanned under
+		 * their own entries. Empty command lines (e.g. those of kernel threads) and files, which vanish while directory is
+		 * being scanned, are skipped.
+		 * @param path path of a directory.
+		 * @param callback callback invoked for each parsed command line. Files larger than cmdline::MAX_FILE_SIZE are reported
+		 * as errors.
+		 * @return number of parsed command lines.
+		 * @throw Exception if directory can not be opened.
+		 */
+		std::size_t scanDirectory(const String & path, Callback callback);
+
+	private:
+		/**
+		 * Feed null-separated arguments to the parser.
+		 */
+		void feed(const char * data, std::size_t size);
+
+		/**
+		 * Feed arguments stored in a file to the parser.
+		 * @param mustExist whether file is expected to hold a command line. If not, function does not throw, when file does
+		 * not exist.
+		 * @return @p false if file has been skipped or it is empty.
+		 */
+		bool parseFile(const String & path, bool mustExist);
+
+		Parser * m_parser;
+		String m_buffer;	///< Buffer for contents of files and for unterminated last arguments.
+		String m_path;
+};
+
+namespace cmdline {
+
+/**
+ * Maximal size of a command line file. Linux limits arguments of a process to a quarter of the stack size limit, that is
+ * to 2 MiB with the default limit of 8 MiB.
+ */
+const std::size_t MAX_FILE_SIZE = 2 * 1024 * 1024;
+
+inline
+void ThrowSystemError(const String & what)
+{
+	throw Exception(what + ": " + std::strerror(errno) + ".");
+}
+
+/**
+ * File descriptor, which is closed when guard goes out of scope.
+ */
+struct FileGuard
+{
+	explicit FileGuard(int fd):
+	    fd(fd)
+	{
+	}
+
+	~FileGuard()
+	{
+		if (fd >= 0)
+			::close(fd);
+	}
+
+	int fd;
+};
+
+/**
+ * Check whether directory is on procfs, where regular files hold kernel data rather than command lines.
+ */
+inline
+bool OnProcfs(const String & path)
+{
+#ifdef __linux__
+	struct statfs status;
+	return (::statfs(path.c_str(), & status) == 0) && (status.f_type == 0x9FA0);	// PROC_SUPER_MAGIC
+#else
+	static_cast<void>(path);
+	return false;
+#endif
+}
+
+}
+
+inline
+CmdlineScanner::CmdlineScanner(Parser & parser):
+    m_parser(& parser)
+{
+}
+
+inline
+int CmdlineScanner::parse(const char * data, std::size_t size)
+{
+	m_parser->reset();
+	feed(data, size);
+	return m_parser->finish();
+}
+
+inline
+int CmdlineScanner::parseFile(const String & path)
+{
+	m_parser->reset();
+	parseFile(path, true);
+	return m_parser->finish();
+}
+
+inline
+std::size_t CmdlineScanner::scanDirectory(const String & path, Callback callback)
+{
+	DIR * dir = ::opendir(path.c_str());
+	if (!dir)
+		cmdline::ThrowSystemError(String() + "Can not open directory \"" + path + "\"");
+	std::unique_ptr<DIR, int (*)(DIR *)> dirGuard(dir, ::closedir);
+
+	bool onProcfs = cmdline::OnProcfs(path);
+	std::size_t count = 0;
+	while (dirent * entry = ::readdir(dir)) {
+		if ((std::strcmp(entry->d_name, ".") == 0) || (std::strcmp(entry->d_name, "..") == 0))
+			continue;
+
+		m_path.assign(path).append("/").append(entry->d_name);
+		struct stat status;
+		if ((::lstat(m_path.c_str(), & status) != 0) || S_ISLNK(status.st_mode))
+			continue;
+		// Pseudo-files, which report zero size (e.g. "/proc/kmsg"), may block on read, so only "cmdline" files are read.
+		if (S_ISDIR(status.st_mode))
+			m_path.append("/cmdline");
+		else if (!S_ISREG(status.st_mode) || (status.st_size == 0) || onProcfs)
+			continue;
+
+		try {
+			m_parser->reset();
+			if (!parseFile(m_path, false))
+				continue;
+			m_parser->finish();
+		} catch (const Exception & e) {
+			count++;
+			callback(m_path, & e);
+			continue;
+		}
+		count++;
+		callback(m_path, nullptr);
+	}
+	return count;
+}
+
+inline
+bool CmdlineScanner::parseFile(const String & path, bool mustExist)
+{
+	cmdline::FileGuard file(::open(path.c_str(), O_RDONLY));
+	if (file.fd < 0) {
+		if (!mustExist && ((errno == ENOENT) || (errno == ESRCH)))
+			return false;
+		cmdline::ThrowSystemError(String() + "Can not open file \"" + path + "\"");
+	}
+
+	// Command lines are small, so reading them into a buffer, which is reused between files, is cheaper than mapping them.
+	// Files of procfs report zero size, so file is read until end of file is reached, but no further than the limit.
+	struct stat status;
+	if ((::fstat(file.fd, & status) == 0) && (static_cast<std::uintmax_t>(status.st_size) > cmdline::MAX_FILE_SIZE))
+		throw Exception(String() + "File \"" + path + "\" is too large for a command line.");
+	m_buffer.clear();
+	char chunk[4096];
+	for (;;) {
+		ssize_t count = ::read(file.fd, chunk, sizeof(chunk));
+		if (count < 0) {
+			if (errno == EINTR)
+				continue;
+			// Process may exit while its command line is being read.
+			if (!mustExist && (errno == ESRCH))
+				return false;
+			cmdline::ThrowSystemError(String() + "Can not read file \"" + path + "\"");
+		}
+		if (count == 0)
+			break;
+		m_buffer.append(chunk, static_cast<std::size_t>(count));
+		if (m_buffer.size() > cmdline::MAX_FILE_SIZE)
+			throw Exception(String() + "File \"" + path + "\" is too large for a command line.");
+	}
+	if (m_buffer.empty())
+		return mustExist;
+	// Terminator is appended, so that last argument does not have to be copied.
+	if (m_buffer.back() != '\0')
+		m_buffer.push_back('\0');
+
+	feed(m_buffer.data(), m_buffer.size());
+	return true;
+}
+
+inline
+void CmdlineScanner::feed(const char * data, std::size_t size)
+{
+	const char * end = data + size;
+	while (data < end) {
+		const char * terminator = static_cast<const char *>(std::memchr(data, '\0', static_cast<std::size_t>(end - data)));
+		if (!terminator) {
+			// Last argument is not terminated and buffer may be read-only, so argument has to be copied.
+			m_buffer.assign(data, end);
+			m_parser->feed(m_buffer.c_str());
+			break;
+		}
+		m_parser->feed(data);
+		data = terminator + 1;
+	}
+}
+
+}
+
+#endif
@@ -0,0 +1,672 @@
+#ifndef CRAP_SERVER_HPP
+#define CRAP_SERVER_HPP
+
+#include "crap.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <utility>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// C++RAP - C++ Recursive Argument Processor
+namespace crap {
+
+/*
+ * Parse server and client communicate over a Unix domain socket. Each message is a frame, which starts with a 32-bit payload
+ * length followed by the payload. Integers are sent in host byte order, since both ends run on the same machine. Strings are
+ * prefixed with their 32-bit length.
+ *
+ * Request payload: number of arguments, followed by the arguments.
+ * Response payload: status byte (ParseResult::OK or ParseResult::ERROR). Status OK is followed by the number of arguments
+ * that have been set and key-value pair of strings for each of them, and by the number of trailing arguments (those following
+ * "--") and the arguments. Status ERROR is followed by an error message.
+ *
+ * Payload of a frame can not exceed server::MAX_FRAME_SIZE bytes. Server responds to a longer request with an error and
+ * closes the connection without reading the payload. Connection, which does not deliver the rest of a request or does not
+ * accept a response within a timeout, is closed.
+ */
+
+/**
+ * Result of parsing arguments by ParseServer.
+ */
+struct ParseResult
+{
+	typedef Vector<std::pair<String, String>> ArgsContainer;
+
+	typedef Vector<String> TrailingArgsContainer;
+
+	enum Status : unsigned char {
+		OK,
+		ERROR
+	};
+
+	Status status;
+	String error;	///< Error message if status is ERROR.
+	ArgsContainer args;	///< Arguments that have been set. Each argument is identified by its name and it is paired with its value.
+	TrailingArgsContainer trailingArgs;	///< Arguments following "--".
+};
+
+/**
+ * Parse server. Server keeps a parser with its arguments resident and parses command line arguments sent by ParseClient
+ * instances over a Unix domain socket. Requests are served one at a time, but serve() and poll() interleave requests of
+ * all the open connections, so that idle clients do not delay other clients.
+ *
+ * Arguments are identified in responses by their name or, for value-only arguments, by their synopsis (e.g. "<file>").
+ */
+class ParseServer
+{
+	public:
+	    /**
+		 * Constructor. Creates a socket and listens on it.
+		 * @param parser parser used to parse arguments. Parser is reset before each request.
+		 * @param socketPath path of the socket. Existing socket at this path is removed.
+		 * @throw Exception if socket can not be created or if a file, which is not a socket, exists at @a socketPath.
+		 */
+	    ParseServer(Parser & parser, const String & socketPath);
+
+		ParseServer(const ParseServer & other) = delete;
+
+		ParseServer & operator =(const ParseServer & other) = delete;
+
+		/**
+		 * Destructor. Closes and removes the socket.
+		 */
+		~ParseServer();
+
+		/**
+		 * Set timeout of reading the rest of a request, once it has started to arrive, and of writing a response.
+		 * @param milliseconds timeout in milliseconds or 0 to wait indefinitely. Default is server::DEFAULT_TIMEOUT.
+		 */
+		void setTimeout(int milliseconds);
+
+		/**
+		 * Accept a single connection and serve its requests until client disconnects. Connection is closed when a request
+		 * is malformed or when serving it fails, without affecting other connections. Other clients are not served,
+		 * until the connection is closed.
+		 */
+		void serveConnection();
+
+		/**
+		 * Wait until a client connects or sends a request. New connections are accepted and each connection, which has sent
+		 * a request, is served a single request. Connection is closed when client disconnects, when a request is malformed
+		 * or when serving it fails, without affecting other connections.
+		 * @param timeout maximal time to wait in milliseconds or -1 to wait indefinitely.
+		 */
+		void poll(int timeout = -1);
+
+		/**
+		 * Serve connections indefinitely.
+		 */
+		void serve();
+
+	private:
+		typedef Vector<char *> ArgvContainer;
+
+		typedef Vector<pollfd> PollFdsContainer;
+
+		/**
+		 * Serve a request of a connection, which has been accepted by poll().
+		 * @return @p false if connection has been closed.
+		 */
+		bool serveConnectionRequest(int fd);
+
+		/**
+		 * Serve a single request.
+		 * @return @p false if client has disconnected.
+		 */
+		bool serveRequest(int fd);
+
+		/**
+		 * Respond with arguments that have been set.
+		 */
+		void respond(int fd);
+
+		void respondError(int fd, const char * message);
+
+		int accept();
+
+		void appendSetArgs(const Parser & parser, std::uint32_t & count);
+
+		void appendSetArg(const Arg * arg, std::uint32_t & count);
+
+		Parser * m_parser;
+		String m_socketPath;
+		int m_fd;
+		int m_timeout;
+		PollFdsContainer m_pollFds;	///< Listening socket followed by open connections.
+		String m_request;
+		ArgvContainer m_argv;
+		String m_response;
+};
+
+/**
+ * Parse client. Client forwards command line arguments to ParseServer.
+ */
+class ParseClient
+{
+	public:
+	    /**
+		 * Constructor. Connects to the server.
+		 * @param socketPath path of server socket.
+		 */
+	    explicit ParseClient(const String & socketPath);
+
+		ParseClient(const ParseClient & other) = delete;
+
+		ParseClient & operator =(const ParseClient & other) = delete;
+
+		~ParseClient();
+
+		/**
+		 * Parse arguments with the server.
+		 * @param argc number of arguments.
+		 * @param argv arguments.
+		 * @param result result of parsing.
+		 */
+		void parse(int argc, const char * const argv[], ParseResult & result);
+
+	private:
+		int m_fd;
+		String m_buffer;
+};
+
+namespace server {
+
+/**
+ * Maximal size of a frame payload.
+ */
+const std::uint32_t MAX_FRAME_SIZE = 4 * 1024 * 1024;
+
+/**
+ * Default timeout of reading a request and writing a response in milliseconds.
+ */
+const int DEFAULT_TIMEOUT = 1000;
+
+inline
+void ThrowSystemError(const String & what)
+{
+	throw Exception(what + ": " + std::strerror(errno) + ".");
+}
+
+inline
+void AppendUInt32(String & buffer, std::uint32_t value)
+{
+	buffer.append(reinterpret_cast<const char *>(& value), sizeof(value));
+}
+
+inline
+void AppendString(String & buffer, const char * str, std::size_t length)
+{
+	AppendUInt32(buffer, static_cast<std::uint32_t>(length));
+	buffer.append(str, length);
+}
+
+/**
+ * Read 32-bit integer from a buffer.
+ * @return @p false if buffer is too short.
+ */
+inline
+bool ReadUInt32(const String & buffer, std::size_t & pos, std::uint32_t & value)
+{
+	if (buffer.size() - pos < sizeof(value))
+		return false;
+	std::memcpy(& value, buffer.data() + pos, sizeof(value));
+	pos += sizeof(value);
+	return true;
+}
+
+inline
+bool ReadString(const String & buffer, std::size_t & pos, String & str)
+{
+	std::uint32_t length;
+	if (!ReadUInt32(buffer, pos, length) || (buffer.size() - pos < length))
+		return false;
+	str.assign(buffer, pos, length);
+	pos += length;
+	return true;
+}
+
+/**
+ * Write whole buffer to a socket.
+ */
+inline
+void Write(int fd, const char * data, std::size_t size)
+{
+#ifdef MSG_NOSIGNAL
+	const int flags = MSG_NOSIGNAL;
+#else
+	const int flags = 0;
+#endif
+	while (size > 0) {
+		ssize_t written = ::send(fd, data, size, flags);
+		if (written < 0) {
+			if (errno == EINTR)
+				continue;
+			ThrowSystemError("Can not write to socket");
+		}
+		data += written;
+		size -= static_cast<std::size_t>(written);
+	}
+}
+
+/**
+ * Read exactly @a size bytes from a socket.
+ * @return @p false if connection has been closed before any byte has been read.
+ */
+inline
+bool Read(int fd, char * data, std::size_t size)
+{
+	std::size_t total = 0;
+	while (total < size) {
+		ssize_t count = ::read(fd, data + total, size - total);
+		if (count < 0) {
+			if (errno == EINTR)
+				continue;
+			ThrowSystemError("Can not read from socket");
+		}
+		if (count == 0) {
+			if (total == 0)
+				return false;
+			throw Exception("Connection closed in the middle of a frame.");
+		}
+		total += static_cast<std::size_t>(count);
+	}
+	return true;
+}
+
+/**
+ * Read header of a frame.
+ * @param length payload length.
+ * @return @p false if connection has been closed.
+ */
+inline
+bool ReadFrameHeader(int fd, std::uint32_t & length)
+{
+	return Read(fd, reinterpret_cast<char *>(& length), sizeof(length));
+}
+
+/**
+ * Read payload of a frame, which header has been read.
+ */
+inline
+void ReadPayload(int fd, std::uint32_t length, String & buffer)
+{
+	buffer.resize(length);
+	if ((length > 0) && !Read(fd, & buffer[0], length))
+		throw Exception("Connection closed in the middle of a frame.");
+}
+
+/**
+ * Read a frame. Frame header is stripped, buffer holds payload only.
+ * @return @p false if connection has been closed.
+ * @throw Exception if payload exceeds MAX_FRAME_SIZE.
+ */
+inline
+bool ReadFrame(int fd, String & buffer)
+{
+	std::uint32_t length;
+	if (!ReadFrameHeader(fd, length))
+		return false;
+	if (length > MAX_FRAME_SIZE)
+		throw Exception("Frame exceeds maximal size.");
+	ReadPayload(fd, length, buffer);
+	return true;
+}
+
+/**
+ * Write a frame. Buffer must start with space reserved for the payload length.
+ */
+inline
+void WriteFrame(int fd, String & buffer)
+{
+	std::uint32_t length = static_cast<std::uint32_t>(buffer.size() - sizeof(length));
+	std::memcpy(& buffer[0], & length, sizeof(length));
+	Write(fd, buffer.data(), buffer.size());
+}
+
+/**
+ * Set timeout of blocking reads and writes of a socket.
+ */
+inline
+void SetTimeout(int fd, int milliseconds)
+{
+	timeval timeout;
+	timeout.tv_sec = milliseconds / 1000;
+	timeout.tv_usec = (milliseconds % 1000) * 1000;
+	if ((::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, & timeout, sizeof(timeout)) < 0)
+			|| (::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, & timeout, sizeof(timeout)) < 0))
+		ThrowSystemError("Can not set socket timeout");
+}
+
+/**
+ * Wait until a socket is readable or it has been closed.
+ */
+inline
+void WaitReadable(int fd)
+{
+	pollfd pollFd = {fd, POLLIN, 0};
+	while (::poll(& pollFd, 1, -1) < 0)
+		if (errno != EINTR)
+			ThrowSystemError("Can not wait for socket");
+}
+
+inline
+sockaddr_un Address(const String & socketPath)
+{
+	sockaddr_un address;
+	std::memset(& address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if (socketPath.length() >= sizeof(address.sun_path))
+		throw Exception(String() + "Socket path \"" + socketPath + "\" is too long.");
+	std::memcpy(address.sun_path, socketPath.c_str(), socketPath.length() + 1);
+	return address;
+}
+
+}
+
+inline
+ParseServer::ParseServer(Parser & parser, const String & socketPath):
+    m_parser(& parser),
+    m_socketPath(socketPath),
+    m_fd(-1),
+    m_timeout(server::DEFAULT_TIMEOUT)
+{
+	sockaddr_un address = server::Address(socketPath);
+	m_fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+	if (m_fd < 0)
+		server::ThrowSystemError("Can not create socket");
+	// Only a stale socket is removed, so that a mistyped path does not destroy a regular file.
+	struct stat status;
+	if (::lstat(socketPath.c_str(), & status) == 0) {
+		if (!S_ISSOCK(status.st_mode)) {
+			::close(m_fd);
+			throw Exception(String() + "Can not listen on socket \"" + socketPath + "\": file exists and it is not a socket.");
+		}
+		::unlink(socketPath.c_str());
+	}
+	if ((::bind(m_fd, reinterpret_cast<sockaddr *>(& address), sizeof(address)) < 0) || (::listen(m_fd, SOMAXCONN) < 0)) {
+		int error = errno;
+		::close(m_fd);
+		errno = error;
+		server::ThrowSystemError(String() + "Can not listen on socket \"" + socketPath + "\"");
+	}
+	m_pollFds.push_back(pollfd{m_fd, POLLIN, 0});
+}
+
+inline
+ParseServer::~ParseServer()
+{
+	for (PollFdsContainer::const_iterator it = m_pollFds.begin(); it != m_pollFds.end(); ++it)
+		::close(it->fd);
+	::unlink(m_socketPath.c_str());
+}
+
+inline
+void ParseServer::setTimeout(int milliseconds)
+{
+	m_timeout = milliseconds;
+}
+
+inline
+void ParseServer::serveConnection()
+{
+	int fd = accept();
+	try {
+		// Client may stay idle between requests, timeout applies only once a request starts to arrive.
+		do
+			server::WaitReadable(fd);
+		while (serveRequest(fd));
+	} catch (const std::exception &) {
+		// Failing connection (e.g. malformed request or exhausted memory) does not affect other connections.
+	}
+	::close(fd);
+}
+
+inline
+void ParseServer::poll(int timeout)
+{
+	if (::poll(m_pollFds.data(), m_pollFds.size(), timeout) < 0) {
+		if (errno == EINTR)
+			return;
+		server::ThrowSystemError("Can not wait for connections");
+	}
+
+	// Connections are served in place, closed connections are removed afterwards. New connection is appended at the end, so
+	// it is polled next time.
+	std::size_t count = m_pollFds.size();
+	for (std::size_t i = 1; i < count; i++)
+		if ((m_pollFds[i].revents != 0) && !serveConnectionRequest(m_pollFds[i].fd))
+			m_pollFds[i].fd = -1;
+	m_pollFds.erase(std::remove_if(m_pollFds.begin() + 1, m_pollFds.end(), [](const pollfd & pollFd) {
+		return pollFd.fd < 0;
+	}), m_pollFds.end());
+	if (m_pollFds[0].revents & POLLIN)
+		m_pollFds.push_back(pollfd{accept(), POLLIN, 0});
+}
+
+inline
+void ParseServer::serve()
+{
+	for (;;)
+		poll();
+}
+
+inline
+bool ParseServer::serveConnectionRequest(int fd)
+{
+	bool open = false;
+	try {
+		open = serveRequest(fd);
+	} catch (const std::exception &) {
+		// Failing connection (e.g. malformed request or exhausted memory) does not affect other connections.
+	}
+	if (!open)
+		::close(fd);
+	return open;
+}
+
+inline
+int ParseServer::accept()
+{
+	int fd;
+	do
+		fd = ::accept(m_fd, nullptr, nullptr);
+	while ((fd < 0) && (errno == EINTR));
+	if (fd < 0)
+		server::ThrowSystemError("Can not accept connection");
+	if (m_timeout > 0) {
+		try {
+			server::SetTimeout(fd, m_timeout);
+		} catch (...) {
+			::close(fd);
+			throw;
+		}
+	}
+	return fd;
+}
+
+inline
+bool ParseServer::serveRequest(int fd)
+{
+	std::uint32_t length;
+	if (!server::ReadFrameHeader(fd, length))
+		return false;
+	if (length > server::MAX_FRAME_SIZE) {
+		// Oversized payload is not read, so connection can not be resynchronized.
+		respondError(fd, "Request exceeds maximal frame size.");
+		return false;
+	}
+	server::ReadPayload(fd, length, m_request);
+
+	// Arguments are null-terminated in place, so that argv can point directly into request buffer. Length prefix of an
+	// argument is read before its first byte is overwritten with terminator of the preceding argument.
+	m_request.push_back('\0');
+	std::size_t end = m_request.size() - 1;
+	std::size_t pos = 0;
+	std::uint32_t argc;
+	if (!server::ReadUInt32(m_request, pos, argc))
+		throw Exception("Malformed request.");
+	m_argv.clear();
+	for (std::uint32_t i = 0; i < argc; i++) {
+		std::uint32_t length;
+		std::size_t lengthPos = pos;
+		if ((end - pos < sizeof(length)) || !server::ReadUInt32(m_request, pos, length) || (end - pos < length))
+			throw Exception("Malformed request.");
+		m_request[lengthPos] = '\0';
+		m_argv.push_back(& m_request[pos]);
+		pos += length;
+	}
+	if (pos != end)
+		throw Exception("Malformed request.");
+	m_argv.push_back(nullptr);
+
+	// Exceptions other than crap::Exception may be thrown by validators and default value functions.
+	try {
+		m_parser->reset();
+		m_parser->parse(static_cast<int>(argc), m_argv.data());
+	} catch (const std::exception & e) {
+		respondError(fd, e.what());
+		return true;
+	}
+	respond(fd);
+	return true;
+}
+
+inline
+void ParseServer::respond(int fd)
+{
+	m_response.assign(sizeof(std::uint32_t), '\0');
+	m_response.push_back(static_cast<char>(ParseResult::OK));
+	std::size_t countPos = m_response.size();
+	std::uint32_t count = 0;
+	server::AppendUInt32(m_response, count);
+	appendSetArg(m_parser->m_cmd, count);
+	appendSetArgs(*m_parser, count);
+	std::memcpy(& m_response[countPos], & count, sizeof(count));
+	const Parser::ArgvSpan & trailingArgs = m_parser->trailingArgs();
+	server::AppendUInt32(m_response, static_cast<std::uint32_t>(trailingArgs.argc));
+	for (int i = 0; i < trailingArgs.argc; i++)
+		server::AppendString(m_response, trailingArgs.argv[i], std::strlen(trailingArgs.argv[i]));
+	server::WriteFrame(fd, m_response);
+}
+
+inline
+void ParseServer::respondError(int fd, const char * message)
+{
+	m_response.assign(sizeof(std::uint32_t), '\0');
+	m_response.push_back(static_cast<char>(ParseResult::ERROR));
+	server::AppendString(m_response, message, std::strlen(message));
+	server::WriteFrame(fd, m_response);
+}
+
+inline
+void ParseServer::appendSetArgs(const Parser & parser, std::uint32_t & count)
+{
+	for (Parser::ArgGroupsContainer::const_iterator grIt = parser.m_argGroups.begin(); grIt != parser.m_argGroups.end(); ++grIt) {
+		const ArgGroup * group = *grIt;
+		for (ArgGroup::ParsersContainer::const_iterator it = group->m_parsers.begin(); it != group->m_parsers.end(); ++it) {
+			appendSetArg((*it)->m_cmd, count);
+			if ((*it)->m_cmd->isSet())
+				appendSetArgs(**it, count);
+		}
+		for (ArgGroup::KeyValueAttrsContainer::const_iterator it = group->m_keyValueAttrs.begin(); it != group->m_keyValueAttrs.end(); ++it)
+			appendSetArg(*it, count);
+		for (ArgGroup::KeyAttrsContainer::const_iterator it = group->m_keyAttrs.begin(); it != group->m_keyAttrs.end(); ++it)
+			appendSetArg(*it, count);
+		for (ArgGroup::ValueAttrsContainer::const_iterator it = group->m_valueAttrs.begin(); it != group->m_valueAttrs.end(); ++it)
+			appendSetArg(*it, count);
+	}
+}
+
+inline
+void ParseServer::appendSetArg(const Arg * arg, std::uint32_t & count)
+{
+	if (!arg->isSet())
+		return;
+
+	if (const Vector<String> * keys = arg->keys())
+		server::AppendString(m_response, keys->front().data(), keys->front().length());
+	else {
+		String synopsis = arg->synopsis();
+		server::AppendString(m_response, synopsis.data(), synopsis.length());
+	}
+	const String * value = arg->valuePtr();
+	if (value)
+		server::AppendString(m_response, value->data(), value->length());
+	else
+		server::AppendUInt32(m_response, 0);
+	count++;
+}
+
+inline
+ParseClient::ParseClient(const String & socketPath):
+    m_fd(-1)
+{
+	sockaddr_un address = server::Address(socketPath);
+	m_fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+	if (m_fd < 0)
+		server::ThrowSystemError("Can not create socket");
+	if (::connect(m_fd, reinterpret_cast<sockaddr *>(& address), sizeof(address)) < 0) {
+		int error = errno;
+		::close(m_fd);
+		errno = error;
+		server::ThrowSystemError(String() + "Can not connect to socket \"" + socketPath + "\"");
+	}
+}
+
+inline
+ParseClient::~ParseClient()
+{
+	::close(m_fd);
+}
+
+inline
+void ParseClient::parse(int argc, const char * const argv[], ParseResult & result)
+{
+	m_buffer.assign(sizeof(std::uint32_t), '\0');
+	server::AppendUInt32(m_buffer, static_cast<std::uint32_t>(argc));
+	for (int i = 0; i < argc; i++)
+		server::AppendString(m_buffer, argv[i], std::strlen(argv[i]));
+	server::WriteFrame(m_fd, m_buffer);
+
+	if (!server::ReadFrame(m_fd, m_buffer) || m_buffer.empty())
+		throw Exception("Connection closed by server.");
+
+	std::size_t pos = 1;
+	result.status = static_cast<ParseResult::Status>(m_buffer[0]);
+	result.error.clear();
+	result.args.clear();
+	result.trailingArgs.clear();
+	bool wellFormed;
+	if (result.status == ParseResult::ERROR)
+		wellFormed = server::ReadString(m_buffer, pos, result.error);
+	else if (result.status == ParseResult::OK) {
+		std::uint32_t count;
+		wellFormed = server::ReadUInt32(m_buffer, pos, count);
+		for (std::uint32_t i = 0; wellFormed && (i < count); i++) {
+			result.args.push_back(ParseResult::ArgsContainer::value_type());
+			wellFormed = server::ReadString(m_buffer, pos, result.args.back().first) && server::ReadString(m_buffer, pos, result.args.back().second);
+		}
+		wellFormed = wellFormed && server::ReadUInt32(m_buffer, pos, count);
+		for (std::uint32_t i = 0; wellFormed && (i < count); i++) {
+			result.trailingArgs.push_back(String());
+			wellFormed = server::ReadString(m_buffer, pos, result.trailingArgs.back());
+		}
+	} else
+		wellFormed = false;
+	if (!wellFormed || (pos != m_buffer.size()))
+		throw Exception("Malformed response.");
+}
+
+}
+
+#endif
@@ -0,0 +1,6 @@
+// Definitions of C++RAP functions for builds with CRAP_SEPARATE_COMPILATION defined.
+#ifndef CRAP_SEPARATE_COMPILATION
+	#define CRAP_SEPARATE_COMPILATION
+#endif
+#define CRAP_IMPLEMENTATION
+#include "../include/crap.hpp"
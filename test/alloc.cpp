@@ -0,0 +1,137 @@
+// Allocation tests. Global operator new is replaced, so that heap allocations made by steady-state parsing can be counted.
+// Once a parser has parsed a command line, parsing command lines of the same shape must not allocate. Construction without
+// any heap allocations is tested with fixed-capacity storage (see fixed.cpp).
+
+#include "test.hpp"
+#include "../include/crap.hpp"
+
+#include <deque>
+#include <memory>
+#include <new>
+#include <sstream>
+#include <vector>
+
+namespace {
+
+unsigned long Allocations = 0;
+
+}
+
+void * operator new(std::size_t size)
+{
+	Allocations++;
+	if (void * ptr = std::malloc(size ? size : 1))
+		return ptr;
+	throw std::bad_alloc();
+}
+
+void operator delete(void * ptr) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete(void * ptr, std::size_t) noexcept
+{
+	std::free(ptr);
+}
+
+namespace {
+
+const int PARSES = 100;
+
+/**
+ * Count allocations made by repeated reset and parse, after the first parse has warmed up the parser.
+ */
+unsigned long CountAllocations(crap::Parser & parser, std::vector<char *> argv)
+{
+	parser.reset();
+	CHECK_NOTHROW(parser.parse(static_cast<int>(argv.size()), argv.data()));
+	unsigned long before = Allocations;
+	for (int i = 0; i < PARSES; i++) {
+		parser.reset();
+		parser.parse(static_cast<int>(argv.size()), argv.data());
+	}
+	return Allocations - before;
+}
+
+void TestAbbreviations()
+{
+	crap::KeyArg cmd("prog");
+	crap::Parser parser(& cmd);
+	crap::KeyValueArg output("--output", "file");
+	output.addAlias("--out");
+	crap::KeyArg verbose("--verbose");
+	crap::KeyArg version("--version");
+	parser.addAttr(& output).addAttr(& verbose).addAttr(& version);
+	crap::KeyArg subCmd("sub");
+	crap::Parser * subParser = parser.addSubCmd(& subCmd);
+	crap::KeyValueArg level("--level", "level");
+	subParser->addAttr(& level);
+
+	char * argv[] = {const_cast<char *>("prog"), const_cast<char *>("--outp=a"), const_cast<char *>("--verb"),
+			const_cast<char *>("sub"), const_cast<char *>("--lev"), const_cast<char *>("1")};
+	CHECK(CountAllocations(parser, std::vector<char *>(argv, argv + 6)) == 0);
+}
+
+void TestManyArgs()
+{
+	crap::KeyArg cmd("prog");
+	crap::Parser parser(& cmd);
+	std::vector<std::unique_ptr<crap::KeyArg>> args;
+	for (int i = 0; i < 200; i++) {
+		std::ostringstream name;
+		name << "--flag" << i;
+		args.push_back(std::unique_ptr<crap::KeyArg>(new crap::KeyArg(name.str())));
+		parser.addAttr(args.back().get());
+	}
+	crap::KeyArg subCmd("sub");
+	crap::Parser * subParser = parser.addSubCmd(& subCmd);
+	for (int i = 0; i < 200; i++) {
+		std::ostringstream name;
+		name << "--sub-flag" << i;
+		args.push_back(std::unique_ptr<crap::KeyArg>(new crap::KeyArg(name.str())));
+		subParser->addAttr(args.back().get());
+	}
+
+	char * argv[] = {const_cast<char *>("prog"), const_cast<char *>("--flag1"), const_cast<char *>("sub"),
+			const_cast<char *>("--sub-flag199"), const_cast<char *>("--flag150")};
+	CHECK(CountAllocations(parser, std::vector<char *>(argv, argv + 5)) == 0);
+}
+
+/**
+ * Sets of groups, in which glued key-only arguments are looked up, do not fit inline, when there are more than 128 groups.
+ */
+void TestManyGroups()
+{
+	crap::KeyArg cmd("prog");
+	crap::Parser parser(& cmd);
+	std::deque<crap::ArgGroup> groups;
+	std::deque<crap::KeyArg> args;
+	for (int i = 0; i < 200; i++) {
+		std::ostringstream name;
+		name << "--flag" << i;
+		groups.emplace_back();
+		args.emplace_back(name.str());
+		groups.back().addAttr(& args.back());
+		parser.addArgGroup(& groups.back());
+	}
+	const char * glued[] = {"-a", "-b", "-c"};
+	for (std::size_t i = 0; i < 3; i++) {
+		args.emplace_back(glued[i]);
+		groups.back().addAttr(& args.back());
+	}
+
+	char * argv[] = {const_cast<char *>("prog"), const_cast<char *>("-abc"), const_cast<char *>("--flag7")};
+	CHECK(CountAllocations(parser, std::vector<char *>(argv, argv + 3)) == 0);
+	CHECK(args[200].isSet() && args[202].isSet() && args[7].isSet());
+}
+
+}
+
+int main()
+{
+	TestAbbreviations();
+	TestManyArgs();
+	TestManyGroups();
+	return test::Summary("alloc");
+}
@@ -0,0 +1,125 @@
+// Tests of bound arguments and StructSchema. Values have to be converted into fields while parsing, defaults have to be
+// taken from fields and lint has to report values, which parse would reject.
+
+#include "test.hpp"
+#include "../include/crap.hpp"
+
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Config
+{
+	int port = 80;
+	double ratio = 0.25;
+	unsigned char level = 3;
+	long long offset = -1;
+	std::string host = "localhost";
+	bool verbose = false;
+	std::string file = "in.txt";
+	unsigned count = 1;
+};
+
+typedef crap::StructSchema<Config> ConfigSchema;
+
+/**
+ * Parse arguments into a fresh configuration.
+ * @return @p false if parser has thrown InvalidArgValueException.
+ */
+bool Parse(std::vector<std::string> args, Config & config)
+{
+	ConfigSchema schema("prog", config, {
+		ConfigSchema::Option("--port", & Config::port, "port"),
+		ConfigSchema::Option("--ratio", & Config::ratio, "ratio"),
+		ConfigSchema::Option("--level", & Config::level, "level"),
+		ConfigSchema::Option("--offset", & Config::offset, "offset"),
+		ConfigSchema::Option("--host", & Config::host, "host"),
+		ConfigSchema::Flag("-v", & Config::verbose),
+		ConfigSchema::Value("file", & Config::file),
+		ConfigSchema::Value("count", & Config::count)
+	});
+	std::vector<char *> argv;
+	for (std::vector<std::string>::iterator it = args.begin(); it != args.end(); ++it)
+		argv.push_back(& (*it)[0]);
+	int argc = static_cast<int>(argv.size());
+
+	crap::ParseErrorsContainer errors;
+	bool linted = schema.parser().lint(argc, argv.data(), errors);
+	bool parsed = true;
+	try {
+		schema.parser().parse(argc, argv.data());
+	} catch (const crap::InvalidArgValueException & ) {
+		parsed = false;
+	}
+	// Lint reports the same values as parse.
+	CHECK(linted == parsed);
+	CHECK(parsed || ((errors.size() == 1) && (errors.front().code == crap::ParseError::INVALID_ARG_VALUE)));
+	return parsed;
+}
+
+void TestDefaults()
+{
+	Config config;
+	crap::BoundKeyValueArg<int> port("--port", config.port, "port");
+	crap::BoundKeyValueArg<double> ratio("--ratio", config.ratio, "ratio");
+	crap::BoundKeyValueArg<unsigned char> level("--level", config.level, "level");
+	crap::BoundKeyValueArg<std::string> host("--host", config.host, "host");
+	crap::BoundValueArg<unsigned> count("count", config.count);
+	CHECK(port.defaultValue() == "80");
+	CHECK(ratio.defaultValue() == "0.25");
+	// Characters are formatted as numbers.
+	CHECK(level.defaultValue() == "3");
+	CHECK(host.defaultValue() == "localhost");
+	CHECK(count.defaultValue() == "1");
+	CHECK(& port.target() == & config.port);
+
+	CHECK(crap::FormatValue(true) == "1");
+	CHECK(crap::FormatValue(-7) == "-7");
+	CHECK(crap::FormatValue(18446744073709551615ULL) == "18446744073709551615");
+	CHECK(crap::FormatValue(1.5f) == "1.5");
+	CHECK(crap::FormatValue(1.0 / 3.0) == "0.333333");
+	CHECK(crap::FormatValue(std::string("x")) == "x");
+}
+
+void TestConversion()
+{
+	Config config;
+	CHECK(Parse({"prog", "--port=8080", "--ratio", "1e-3", "--level=255", "--offset=-9223372036854775808", "--host=", "-v",
+			"data.txt", "7"}, config));
+	CHECK(config.port == 8080);
+	CHECK(config.ratio == 1e-3);
+	CHECK(config.level == 255);
+	CHECK(config.offset == -9223372036854775807LL - 1);
+	CHECK(config.host.empty());
+	CHECK(config.verbose);
+	CHECK(config.file == "data.txt");
+	CHECK(config.count == 7);
+
+	// Fields of arguments, which have not been given, keep their values.
+	config = Config();
+	CHECK(Parse({"prog"}, config));
+	CHECK((config.port == 80) && (config.ratio == 0.25) && (config.host == "localhost") && !config.verbose && (config.file == "in.txt"));
+
+	// Invalid values are rejected by parse and lint and fields are left intact.
+	const char * invalid[][2] = {{"--port=x", nullptr}, {"--port=8080x", nullptr}, {"--port=", nullptr},
+			{"--port=99999999999", nullptr}, {"--level=256", nullptr}, {"--level=-1", nullptr}, {"--ratio=1e999", nullptr},
+			{"--ratio=one", nullptr}, {"file", "3x"}, {"file", "x"}};
+	for (std::size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+		config = Config();
+		std::vector<std::string> args{"prog", invalid[i][0]};
+		if (invalid[i][1])
+			args.push_back(invalid[i][1]);
+		CHECK(!Parse(args, config));
+		CHECK((config.port == 80) && (config.level == 3) && (config.ratio == 0.25) && (config.count == 1));
+	}
+}
+
+}
+
+int main()
+{
+	TestDefaults();
+	TestConversion();
+	return test::Summary("bound");
+}
@@ -0,0 +1,158 @@
+// Tests of CmdlineScanner. Scanned directory is built in a temporary directory and mimics layout of "/proc": command line
+// files, subdirectories with "cmdline" and other files and symbolic links, which must not be followed.
+
+#include "test.hpp"
+#include "../include/crap_cmdline.hpp"
+
+#include <fstream>
+#include <map>
+#include <string>
+
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+struct Schema
+{
+	Schema();
+
+	crap::KeyArg cmd;
+	crap::Parser parser;
+	crap::KeyArg verbose;
+	crap::KeyValueArg name;
+};
+
+Schema::Schema():
+    cmd("prog"),
+    parser(& cmd),
+    verbose("-v"),
+    name("--name", "name")
+{
+	parser.addAttr(& verbose);
+	parser.addAttr(& name);
+}
+
+void WriteFile(const std::string & path, const std::string & content)
+{
+	std::ofstream file(path.c_str(), std::ios::binary);
+	file << content;
+}
+
+void TestParse()
+{
+	Schema schema;
+	crap::CmdlineScanner scanner(schema.parser);
+
+	const char terminated[] = "prog\0-v\0--name=x\0";
+	CHECK(scanner.parse(terminated, sizeof(terminated) - 1) == 3);
+	CHECK(schema.verbose.isSet());
+	CHECK(schema.name.value() == "x");
+
+	// Last argument is not terminated and it is followed by a byte, which must not be read.
+	const char unterminated[] = "prog\0--name=yz";
+	CHECK(scanner.parse(unterminated, sizeof(unterminated) - 2) == 2);
+	CHECK(!schema.verbose.isSet());
+	CHECK(schema.name.value() == "y");
+
+	const char unrecognized[] = "prog\0--unknown\0";
+	CHECK_THROWS(scanner.parse(unrecognized, sizeof(unrecognized) - 1), crap::UnrecognizedArgException);
+}
+
+void TestScanDirectory()
+{
+	char dirTemplate[] = "/tmp/crap_test_cmdline_XXXXXX";
+	const char * dir = ::mkdtemp(dirTemplate);
+	CHECK(dir != nullptr);
+	if (!dir)
+		return;
+	std::string root(dir);
+
+	WriteFile(root + "/plain", std::string("prog\0-v\0", 8));
+	::mkdir((root + "/1").c_str(), 0700);
+	WriteFile(root + "/1/cmdline", std::string("prog\0--name=one", 15));
+	// Only "cmdline" files of subdirectories are read.
+	WriteFile(root + "/1/environ", std::string("prog\0-v\0", 8));
+	::mkdir((root + "/2").c_str(), 0700);
+	WriteFile(root + "/2/cmdline", std::string("prog\0--unknown\0", 15));
+	// Kernel threads have empty command lines and some entries have no command line at all.
+	::mkdir((root + "/3").c_str(), 0700);
+	WriteFile(root + "/3/cmdline", "");
+	::mkdir((root + "/4").c_str(), 0700);
+	WriteFile(root + "/4/status", std::string("prog\0-v\0", 8));
+	WriteFile(root + "/empty", "");
+	// File, which is too large to be a command line, is reported without being read.
+	WriteFile(root + "/large", std::string("prog\0", 5) + std::string(crap::cmdline::MAX_FILE_SIZE, 'x'));
+	// Links to scanned entries, such as "/proc/self", are skipped.
+	CHECK(::symlink("1", (root + "/self").c_str()) == 0);
+	CHECK(::symlink((root + "/plain").c_str(), (root + "/link").c_str()) == 0);
+
+	Schema schema;
+	crap::CmdlineScanner scanner(schema.parser);
+	std::map<std::string, std::string> results;
+	std::size_t count = scanner.scanDirectory(root, [&](const std::string & path, const crap::Exception * error) {
+		std::string result = error ? "error" : "ok";
+		if (!error && schema.verbose.isSet())
+			result += " -v";
+		if (!error && schema.name.isSet())
+			result += " " + schema.name.value();
+		results[path.substr(root.length())] = result;
+	});
+	CHECK(count == 4);
+	CHECK(results.size() == 4);
+	CHECK(results["/plain"] == "ok -v");
+	CHECK(results["/1/cmdline"] == "ok one");
+	CHECK(results["/2/cmdline"] == "error");
+	CHECK(results["/large"] == "error");
+
+	CHECK_THROWS(scanner.scanDirectory(root + "/missing", [](const std::string &, const crap::Exception *) {}), crap::Exception);
+	CHECK_THROWS(scanner.parseFile(root + "/missing"), crap::Exception);
+	CHECK(scanner.parseFile(root + "/plain") == 2);
+	CHECK_THROWS(scanner.parseFile(root + "/large"), crap::Exception);
+	// Endless file, which reports zero size like files of procfs, is read no further than the limit.
+	if (::access("/dev/zero", R_OK) == 0)
+		CHECK_THROWS(scanner.parseFile("/dev/zero"), crap::Exception);
+
+	const char * files[] = {"/self", "/link", "/empty", "/large", "/plain", "/1/cmdline", "/1/environ", "/2/cmdline",
+			"/3/cmdline", "/4/status"};
+	for (std::size_t i = 0; i < sizeof(files) / sizeof(files[0]); i++)
+		::unlink((root + files[i]).c_str());
+	const char * dirs[] = {"/1", "/2", "/3", "/4", ""};
+	for (std::size_t i = 0; i < sizeof(dirs) / sizeof(dirs[0]); i++)
+		::rmdir((root + dirs[i]).c_str());
+}
+
+/**
+ * Regular files of "/proc" itself (e.g. "/proc/kcore") are not command lines.
+ */
+void TestScanProc()
+{
+	struct stat status;
+	if ((::stat("/proc/self/cmdline", & status) != 0))
+		return;
+
+	Schema schema;
+	crap::CmdlineScanner scanner(schema.parser);
+	std::size_t others = 0;
+	bool selfFound = false;
+	std::string self = "/proc/" + std::to_string(::getpid()) + "/cmdline";
+	std::size_t count = scanner.scanDirectory("/proc", [&](const std::string & path, const crap::Exception * ) {
+		if ((path.length() < 8) || (path.compare(path.length() - 8, 8, "/cmdline") != 0))
+			others++;
+		selfFound = selfFound || (path == self);
+	});
+	CHECK(count > 0);
+	CHECK(others == 0);
+	CHECK(selfFound);
+}
+
+}
+
+int main()
+{
+	TestParse();
+	TestScanDirectory();
+	TestScanProc();
+	return test::Summary("cmdline");
+}
@@ -0,0 +1,175 @@
+// Tests of fixed-capacity storage. Global operator new is replaced, so that heap allocations made while a schema is
+// constructed and arguments are parsed can be counted. With CRAP_FIXED_STORAGE there must be none and exhausted storage
+// must result in CapacityException.
+
+#define CRAP_FIXED_STORAGE 65536
+
+#include "test.hpp"
+#include "../include/crap.hpp"
+
+#include <cstring>
+#include <memory>
+#include <new>
+
+namespace {
+
+unsigned long Allocations = 0;
+
+}
+
+void * operator new(std::size_t size)
+{
+	Allocations++;
+	if (void * ptr = std::malloc(size ? size : 1))
+		return ptr;
+	throw std::bad_alloc();
+}
+
+void operator delete(void * ptr) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete(void * ptr, std::size_t) noexcept
+{
+	std::free(ptr);
+}
+
+namespace {
+
+struct Config
+{
+	int jobs = 1;
+	double ratio = 0.5;
+	crap::String output = "a.out";
+	bool verbose = false;
+};
+
+typedef crap::StructSchema<Config> ConfigSchema;
+
+/**
+ * Construct a schema, which uses all kinds of arguments, groups, sub-commands, validators and constraints, and parse
+ * command lines with it.
+ */
+void Run()
+{
+	crap::KeyArg cmd("prog", "Program with a help text, which is too long to fit into a string without allocation.");
+	crap::Parser parser(& cmd);
+	parser.setHeader("Header of a help text, which is too long to fit into a string without allocation.");
+	crap::KeyArg verbose("-v", "Verbose output, which is described by a long help text.");
+	verbose.addAlias("--verbose-output-of-the-program");
+	crap::KeyArg quiet("-q");
+	crap::KeyValueArg level("--level", "level", "Level of detail, which is described by a long help text.");
+	level.setDefaultValue("default-level-which-is-long");
+	crap::RangeValidator range(1, 10, true);
+	level.addValidator(& range);
+	crap::IntListArg ids("--ids", "list");
+	crap::ValueArg file("file", "Input file, which is described by a long help text.");
+	crap::EnumValidator formats;
+	formats.addValue("text").addValue("binary");
+	crap::KeyValueArg format("--format", "format");
+	format.addValidator(& formats);
+	parser.addAttr(& verbose).addAttr(& quiet).addAttr(& level).addAttr(& ids).addAttr(& format).addAttr(& file);
+
+	crap::ArgGroup group("Options of a group with a long name");
+	crap::KeyArg dryRun("--dry-run-of-the-whole-program");
+	group.addAttr(& dryRun);
+	group.addConflict(& verbose, & quiet);
+	parser.addArgGroup(& group);
+
+	crap::KeyArg buildCmd("build");
+	crap::Parser * buildParser = parser.addSubCmd(& buildCmd);
+	crap::KeyValueArg target("--target-of-the-build", "target");
+	buildParser->addAttr(& target);
+
+	char * argv[] = {const_cast<char *>("prog"), const_cast<char *>("-v"), const_cast<char *>("--level=3"),
+			const_cast<char *>("--ids=1,2,3"), const_cast<char *>("--format"), const_cast<char *>("binary"),
+			const_cast<char *>("--dry-run-of-the-whole"), const_cast<char *>("input-file-with-a-long-name.txt"),
+			const_cast<char *>("build"), const_cast<char *>("--target-of-the-build=release-with-debug-info")};
+	for (int i = 0; i < 3; i++) {
+		parser.reset();
+		CHECK(parser.parse(10, argv) == 10);
+	}
+	CHECK(level.value() == "3");
+	CHECK(ids.values().size() == 3);
+	CHECK(file.value() == "input-file-with-a-long-name.txt");
+	CHECK(target.value() == "release-with-debug-info");
+
+	crap::ParseErrorsContainer errors;
+	CHECK(parser.lint(10, argv, errors));
+
+	Config config;
+	ConfigSchema schema("prog", config, {
+		ConfigSchema::Option("--jobs", & Config::jobs, "jobs", "Number of jobs, which is described by a long help text."),
+		ConfigSchema::Option("--ratio", & Config::ratio, "ratio"),
+		ConfigSchema::Option("--output-of-the-program", & Config::output, "file"),
+		ConfigSchema::Flag("-v", & Config::verbose)
+	});
+	char * schemaArgv[] = {const_cast<char *>("prog"), const_cast<char *>("--jobs=4"), const_cast<char *>("--ratio=0.25"),
+			const_cast<char *>("--output-of-the-program=output-file-with-a-long-name")};
+	CHECK(schema.parser().parse(4, schemaArgv) == 4);
+	CHECK((config.jobs == 4) && (config.ratio == 0.25) && (config.output == "output-file-with-a-long-name"));
+}
+
+void TestNoHeapAllocations()
+{
+	unsigned long before = Allocations;
+	Run();
+	CHECK(Allocations == before);
+	// Released memory is reused.
+	std::size_t used = crap::FixedStorage::Used();
+	Run();
+	CHECK(crap::FixedStorage::Used() == used);
+	CHECK(Allocations == before);
+}
+
+void TestCapacity()
+{
+	crap::KeyArg cmd("prog");
+	crap::Parser parser(& cmd);
+	crap::KeyValueArg name("--name", "name");
+	parser.addAttr(& name);
+
+	{
+		// Schema, which does not fit into the storage, can not be constructed.
+		typedef std::unique_ptr<crap::KeyArg, crap::Deleter<crap::KeyArg>> KeyArgPtr;
+		crap::Vector<KeyArgPtr> args;
+		args.reserve(1000);
+		crap::KeyArg crowdedCmd("crowded");
+		crap::Parser crowded(& crowdedCmd);
+		bool exhausted = false;
+		try {
+			for (std::size_t i = 0; i < args.capacity(); i++) {
+				args.push_back(KeyArgPtr(crap::New<crap::KeyArg>("--argument-with-a-name-long-enough-to-be-stored-in-the-storage")));
+				args.back()->addAlias("--" + crap::String(200, 'a') + crap::FormatValue(static_cast<unsigned long long>(i)));
+				crowded.addAttr(args.back().get());
+			}
+		} catch (const crap::CapacityException & ) {
+			exhausted = true;
+		}
+		CHECK(exhausted);
+		CHECK(crap::FixedStorage::Used() <= crap::FixedStorage::Capacity());
+
+		// Value, which does not fit into the storage, can not be parsed.
+		static char value[crap::FixedStorage::Capacity()];
+		std::memset(value, 'x', sizeof(value) - 1);
+		std::memcpy(value, "--name=", 7);
+		char * argv[] = {const_cast<char *>("prog"), value};
+		CHECK_THROWS(parser.parse(2, argv), crap::CapacityException);
+	}
+
+	// Memory is available again, once it has been released.
+	parser.reset();
+	char * argv[] = {const_cast<char *>("prog"), const_cast<char *>("--name=value")};
+	CHECK_NOTHROW(parser.parse(2, argv));
+	CHECK(name.value() == "value");
+}
+
+}
+
+int main()
+{
+	TestNoHeapAllocations();
+	TestCapacity();
+	return test::Summary("fixed");
+}
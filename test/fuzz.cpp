@@ -0,0 +1,393 @@
+// Fuzz target for Parser::parse(), Parser::lint() and Parser::printHelp().
+//
+// Input bytes describe a schema followed by command line arguments. For each input target prints help, parses arguments
+// twice, feeds them one by one and lints them, checking that all of these agree with each other. Build with
+// -DCRAP_LIBFUZZER -fsanitize=fuzzer to use the target with libFuzzer; otherwise main() feeds it with pseudo-random inputs:
+//
+//     fuzz [iterations] [seed]
+
+#include "test.hpp"
+#include "../include/crap.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <typeinfo>
+#include <vector>
+
+namespace {
+
+// Names collide with each other and share prefixes, so that lookups, abbreviations and gluing are exercised.
+const char * const Names[] = {"-a", "-b", "-v", "-x", "--verbose", "--verbose-level", "--name", "--na", "--out", "--output",
+		"run", "init", "sub", "x", "-", "=", "a=b"};
+
+const char * const Values[] = {"", "0", "1", "-1", "10", "x", "a=b", "--", "-v", "-ab", "1,2"};
+
+const crap::RangeValidator RangeValidator(0, 10, true);
+
+const crap::EnumValidator EnumValidator({"0", "x", "a=b"});
+
+/**
+ * Reader of fuzzer input. Exhausted input reads as zeros.
+ */
+class Input
+{
+	public:
+	    Input(const std::uint8_t * data, std::size_t size);
+
+		bool empty() const;
+
+		/**
+		 * Read a number from 0 to bound - 1.
+		 */
+		unsigned next(unsigned bound);
+
+		const char * name();
+
+		const char * value();
+
+	private:
+		const std::uint8_t * m_data;
+		const std::uint8_t * m_end;
+};
+
+struct Schema
+{
+	Schema();
+
+	void add(crap::Arg * arg, crap::Parser * parser, crap::ArgGroup * group);
+
+	crap::KeyArg cmd;
+	crap::Parser parser;
+	std::vector<std::unique_ptr<crap::Arg>> args;
+	std::vector<std::unique_ptr<crap::ArgGroup>> groups;
+	std::vector<std::string> aliases;	///< Aliases of all the arguments, from which command lines are built.
+	std::vector<char> gluableChars;
+};
+
+/**
+ * Outcome of parsing: either an exception or states and values of all the arguments.
+ */
+struct Outcome
+{
+	bool ok;
+	std::string description;
+
+	bool operator ==(const Outcome & other) const;
+};
+
+Input::Input(const std::uint8_t * data, std::size_t size):
+	m_data(data),
+	m_end(data + size)
+{
+}
+
+bool Input::empty() const
+{
+	return m_data == m_end;
+}
+
+unsigned Input::next(unsigned bound)
+{
+	return empty() ? 0 : *m_data++ % bound;
+}
+
+const char * Input::name()
+{
+	return Names[next(sizeof(Names) / sizeof(Names[0]))];
+}
+
+const char * Input::value()
+{
+	return Values[next(sizeof(Values) / sizeof(Values[0]))];
+}
+
+Schema::Schema():
+	cmd("prog"),
+	parser(& cmd)
+{
+}
+
+void Schema::add(crap::Arg * arg, crap::Parser * parser, crap::ArgGroup * group)
+{
+	args.push_back(std::unique_ptr<crap::Arg>(arg));
+	if (crap::KeyArg * keyArg = dynamic_cast<crap::KeyArg *>(arg)) {
+		if (group)
+			group->addAttr(keyArg);
+		else
+			parser->addAttr(keyArg);
+		aliases.push_back(keyArg->name());
+		if ((keyArg->name().length() == 2) && (keyArg->name()[0] == crap::Parser::GLUE_CHAR))
+			gluableChars.push_back(keyArg->name()[1]);
+	} else if (crap::KeyValueArg * keyValueArg = dynamic_cast<crap::KeyValueArg *>(arg)) {
+		if (group)
+			group->addAttr(keyValueArg);
+		else
+			parser->addAttr(keyValueArg);
+		aliases.push_back(keyValueArg->name());
+	} else if (crap::ValueArg * valueArg = dynamic_cast<crap::ValueArg *>(arg)) {
+		if (group)
+			group->addAttr(valueArg);
+		else
+			parser->addAttr(valueArg);
+	}
+}
+
+bool Outcome::operator ==(const Outcome & other) const
+{
+	return (ok == other.ok) && (description == other.description);
+}
+
+void Build(Input & input, Schema & schema)
+{
+	std::vector<crap::Parser *> parsers{& schema.parser};
+	crap::ArgGroup * group = nullptr;
+	crap::Arg * last = nullptr;
+	crap::Arg * previous = nullptr;
+	// Constraints can only refer to arguments of the same parser.
+	crap::Parser * previousParser = nullptr;
+	for (unsigned ops = input.next(24) + 1; ops > 0; ops--) {
+		crap::Parser * parser = parsers.back();
+		crap::Arg * arg = nullptr;
+		switch (input.next(14)) {
+			case 0:
+			case 1:
+				arg = new crap::KeyArg(input.name());
+				break;
+			case 2:
+			case 3:
+				// List arguments convert their values, which lint has to check without setting them.
+				if (input.next(3))
+					arg = new crap::KeyValueArg(input.name(), "value");
+				else
+					arg = new crap::IntListArg(input.name(), "value");
+				if (input.next(2))
+					static_cast<crap::KeyValueArg *>(arg)->setDefaultValue(input.value());
+				break;
+			case 4:
+				arg = new crap::ValueArg("value");
+				break;
+			case 5: {
+				// Commands are key-only or key-value arguments.
+				crap::Arg * cmd;
+				if (input.next(3))
+					cmd = new crap::KeyArg(input.name());
+				else
+					cmd = new crap::KeyValueArg(input.name(), "value");
+				cmd->setRequired(input.next(4) == 0);
+				schema.args.push_back(std::unique_ptr<crap::Arg>(cmd));
+				crap::Parser * subParser = group ? group->addCmd(cmd) : parser->addSubCmd(cmd);
+				if (crap::KeyArg * keyCmd = dynamic_cast<crap::KeyArg *>(cmd))
+					schema.aliases.push_back(keyCmd->name());
+				else
+					schema.aliases.push_back(static_cast<crap::KeyValueArg *>(cmd)->name());
+				if (input.next(2)) {
+					parsers.push_back(subParser);
+					group = nullptr;
+				}
+				break;
+			}
+			case 6:
+				if (parsers.size() > 1)
+					parsers.pop_back();
+				group = nullptr;
+				break;
+			case 7:
+				schema.groups.push_back(std::unique_ptr<crap::ArgGroup>(new crap::ArgGroup(input.next(2) ? "group" : "")));
+				group = schema.groups.back().get();
+				group->setOptionRequired(input.next(4) == 0);
+				parser->addArgGroup(group);
+				break;
+			case 8:
+				if (last)
+					last->setRequired(true);
+				break;
+			case 9:
+				if (crap::KeyValueArg * keyValueArg = dynamic_cast<crap::KeyValueArg *>(last))
+					keyValueArg->addValidator(input.next(2) ? static_cast<const crap::Validator *>(& RangeValidator) : & EnumValidator);
+				else if (crap::ValueArg * valueArg = dynamic_cast<crap::ValueArg *>(last))
+					valueArg->addValidator(& RangeValidator);
+				break;
+			case 10:
+				if (!last || !previous || (previousParser != parser))
+					break;
+				if (input.next(2))
+					(group ? *group : *parser->group(0)).addDependency(last, previous);
+				else
+					(group ? *group : *parser->group(0)).addConflict(last, previous);
+				break;
+			case 11:
+				if (crap::KeyArg * keyArg = dynamic_cast<crap::KeyArg *>(last)) {
+					keyArg->addAlias(input.name());
+					schema.aliases.push_back(keyArg->aliases().back());
+				} else if (crap::KeyValueArg * keyValueArg = dynamic_cast<crap::KeyValueArg *>(last)) {
+					keyValueArg->addAlias(input.name());
+					schema.aliases.push_back(keyValueArg->aliases().back());
+				}
+				break;
+			case 12:
+				parser->setAdaptiveLookup(true);
+				break;
+			default:
+				parser->setOptionRequired(input.next(4) == 0);
+		}
+		if (arg) {
+			schema.add(arg, parser, group);
+			previous = (previousParser == parser) ? last : nullptr;
+			previousParser = parser;
+			last = arg;
+		}
+	}
+}
+
+/**
+ * Build command line arguments.
+ */
+std::vector<std::string> Arguments(Input & input, const Schema & schema)
+{
+	std::vector<std::string> args{input.next(16) ? "prog" : input.name()};
+	for (unsigned count = input.next(12); count > 0; count--) {
+		std::string arg;
+		switch (input.next(8)) {
+			case 0:
+			case 1:
+			case 2:
+				if (!schema.aliases.empty())
+					arg = schema.aliases[input.next(static_cast<unsigned>(schema.aliases.size()))];
+				break;
+			case 3:
+				// Abbreviation or assignment.
+				if (!schema.aliases.empty()) {
+					arg = schema.aliases[input.next(static_cast<unsigned>(schema.aliases.size()))];
+					if (input.next(2))
+						arg.resize(arg.length() - input.next(static_cast<unsigned>(arg.length())));
+					else
+						arg.append("=").append(input.value());
+				}
+				break;
+			case 4:
+				// Glued key-only arguments.
+				arg = "-";
+				for (unsigned count = input.next(4) + 1; !schema.gluableChars.empty() && (count > 0); count--)
+					arg.push_back(schema.gluableChars[input.next(static_cast<unsigned>(schema.gluableChars.size()))]);
+				break;
+			case 5:
+				arg = input.name();
+				break;
+			default:
+				arg = input.value();
+		}
+		args.push_back(arg);
+	}
+	return args;
+}
+
+/**
+ * Describe states and values of all the arguments of a schema.
+ */
+std::string Describe(const Schema & schema, int result)
+{
+	std::ostringstream description;
+	description << "result " << result << ";";
+	crap::Settings settings(schema.parser);
+	description << (settings.isSet(schema.cmd) ? " +" : " -") << schema.cmd.name();
+	for (std::vector<std::unique_ptr<crap::Arg>>::const_iterator it = schema.args.begin(); it != schema.args.end(); ++it)
+		description << (settings.isSet(**it) ? " +" : " -") << settings.value(**it);
+	const crap::Parser::ArgvSpan & trailingArgs = schema.parser.trailingArgs();
+	description << "; trailing " << trailingArgs.argc;
+	return description.str();
+}
+
+Outcome Fail(const std::exception & e)
+{
+	return Outcome{false, std::string(typeid(e).name()) + ": " + e.what()};
+}
+
+Outcome Parse(Schema & schema, std::vector<char *> & argv)
+{
+	schema.parser.reset();
+	try {
+		int result = schema.parser.parse(static_cast<int>(argv.size()), argv.data());
+		return Outcome{true, Describe(schema, result)};
+	} catch (const crap::Exception & e) {
+		return Fail(e);
+	}
+}
+
+Outcome Feed(Schema & schema, std::vector<char *> & argv)
+{
+	schema.parser.reset();
+	try {
+		for (std::vector<char *>::const_iterator it = argv.begin(); it != argv.end(); ++it)
+			schema.parser.feed(*it);
+		int result = schema.parser.finish();
+		// Trailing arguments are not collected by feed().
+		std::string description = Describe(schema, result);
+		return Outcome{true, description.substr(0, description.rfind("; trailing "))};
+	} catch (const crap::Exception & e) {
+		return Fail(e);
+	}
+}
+
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const std::uint8_t * data, std::size_t size)
+{
+	Input input(data, size);
+	Schema schema;
+	Build(input, schema);
+	std::vector<std::string> args = Arguments(input, schema);
+	std::vector<char *> argv;
+	for (std::vector<std::string>::iterator it = args.begin(); it != args.end(); ++it)
+		argv.push_back(& (*it)[0]);
+	int argc = static_cast<int>(argv.size());
+
+	std::ostringstream help;
+	CHECK_NOTHROW(schema.parser.printHelp(help));
+	CHECK(!help.str().empty());
+
+	Outcome outcome = Parse(schema, argv);
+	CHECK(Parse(schema, argv) == outcome);
+
+	Outcome fedOutcome = Feed(schema, argv);
+	if (outcome.ok)
+		CHECK(fedOutcome.ok && (fedOutcome.description == outcome.description.substr(0, outcome.description.rfind("; trailing "))));
+	else
+		CHECK(fedOutcome == outcome);
+
+	crap::ParseErrorsContainer errors;
+	bool linted = schema.parser.lint(argc, argv.data(), errors);
+	CHECK(linted == outcome.ok);
+	CHECK(linted == errors.empty());
+
+	if (test::Failures() > 0) {
+		std::cerr << "arguments:";
+		for (std::vector<std::string>::const_iterator it = args.begin(); it != args.end(); ++it)
+			std::cerr << " \"" << *it << "\"";
+		std::cerr << "\noutcome: " << outcome.description << "\n" << help.str() << std::endl;
+#ifdef CRAP_LIBFUZZER
+		std::abort();
+#endif
+	}
+	return 0;
+}
+
+#ifndef CRAP_LIBFUZZER
+
+int main(int argc, char * argv[])
+{
+	unsigned long iterations = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 50000;
+	std::mt19937 random((argc > 2) ? static_cast<std::mt19937::result_type>(std::strtoul(argv[2], nullptr, 10)) : 1);
+
+	std::vector<std::uint8_t> data;
+	for (unsigned long i = 0; (i < iterations) && (test::Failures() == 0); i++) {
+		data.resize(random() % 256);
+		for (std::vector<std::uint8_t>::iterator it = data.begin(); it != data.end(); ++it)
+			*it = static_cast<std::uint8_t>(random());
+		LLVMFuzzerTestOneInput(data.data(), data.size());
+	}
+	return test::Summary("fuzz");
+}
+
+#endif
@@ -0,0 +1,186 @@
+// Tests of list arguments and number conversion.
+
+#include "test.hpp"
+#include "../include/crap.hpp"
+
+#include <clocale>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+template <typename T>
+bool Converts(const std::string & str, T expected)
+{
+	T number = T();
+	const char * end = crap::ConvertNumber(str.c_str(), str.c_str() + str.length(), number, typename std::is_integral<T>::type());
+	return (end == str.c_str() + str.length()) && (number == expected);
+}
+
+template <typename T>
+bool Rejects(const std::string & str)
+{
+	T number = T();
+	const char * end = crap::ConvertNumber(str.c_str(), str.c_str() + str.length(), number, typename std::is_integral<T>::type());
+	return end != str.c_str() + str.length();
+}
+
+void TestIntegers()
+{
+	CHECK(Converts<int>("0", 0));
+	CHECK(Converts<int>("+7", 7));
+	CHECK(Converts<int>("-12345678", -12345678));
+	CHECK(Converts<long long>("123456789012345678", 123456789012345678LL));
+	CHECK(Converts<long long>("-9223372036854775808", std::numeric_limits<long long>::min()));
+	CHECK(Converts<long long>("9223372036854775807", std::numeric_limits<long long>::max()));
+	CHECK(Converts<unsigned long long>("18446744073709551615", std::numeric_limits<unsigned long long>::max()));
+	CHECK(Converts<signed char>("-128", -128));
+	CHECK(Converts<short>("00000000000032767", 32767));
+	CHECK(Rejects<long long>("9223372036854775808"));
+	CHECK(Rejects<unsigned long long>("18446744073709551616"));
+	CHECK(Rejects<unsigned>("-1"));
+	CHECK(Rejects<signed char>("128"));
+	CHECK(Rejects<short>("123456789"));
+	CHECK(Rejects<int>(""));
+	CHECK(Rejects<int>("-"));
+	CHECK(Rejects<int>(" 1"));
+	CHECK(Rejects<int>("1 "));
+	CHECK(Rejects<int>("1.5"));
+
+	// Numbers are placed at all offsets within a longer string, so that they are converted by whole and partial chunks.
+	std::mt19937_64 random(1);
+	for (int i = 0; i < 100000; i++) {
+		long long magnitude = static_cast<long long>(random() >> (random() % 63 + 1));
+		bool negative = random() % 2;
+		long long expected = negative ? -magnitude : magnitude;
+		std::ostringstream stream;
+		stream << (negative ? "-" : "") << std::string(random() % 9, '0') << magnitude;
+		std::string str = stream.str() + std::string(random() % 9, ',');
+		long long number = 0;
+		const char * end = crap::ConvertNumber(str.c_str(), str.c_str() + str.length(), number, std::true_type());
+		if (!end || (*end == '\0' ? false : *end != ',') || (number != expected)) {
+			test::Fail(__FILE__, __LINE__, "conversion of \"" + str + "\"");
+			break;
+		}
+	}
+}
+
+void TestFloats()
+{
+	CHECK(Converts<double>("1.5", 1.5));
+	CHECK(Converts<double>("-2e3", -2000.0));
+	CHECK(Converts<double>(".25", 0.25));
+	CHECK(Converts<double>("4.", 4.0));
+	CHECK(Converts<double>("0x1p3", 8.0));
+	CHECK(Converts<float>("1E-2", 0.01f));
+	CHECK(Rejects<double>("."));
+	CHECK(Rejects<double>(" 1"));
+	CHECK(Rejects<double>("1,5"));
+	CHECK(Rejects<double>("1e"));
+	CHECK(Rejects<double>("inf"));
+	CHECK(Rejects<float>("1e300"));
+	double nan;
+	const char * nanStr = "nan(1)";
+	CHECK((crap::ConvertNumber(nanStr, nanStr + 6, nan, std::false_type()) == nanStr + 6) && (nan != nan));
+
+	// Results are the same as those of std::strtod() and std::strtof(), whether fast path applies or not.
+	std::mt19937_64 random(3);
+	for (int i = 0; i < 100000; i++) {
+		std::ostringstream stream;
+		stream.precision(static_cast<std::streamsize>(random() % 18 + 1));
+		if (random() % 2)
+			stream.setf(std::ios::scientific, std::ios::floatfield);
+		stream << std::uniform_real_distribution<double>(-1e6, 1e6)(random) * std::pow(10.0, static_cast<double>(random() % 61) - 30.0);
+		std::string str = stream.str();
+		if (!Converts<double>(str, std::strtod(str.c_str(), nullptr)) || !Converts<float>(str, std::strtof(str.c_str(), nullptr))) {
+			test::Fail(__FILE__, __LINE__, "conversion of \"" + str + "\"");
+			break;
+		}
+	}
+
+	crap::RangeValidator range(0, 10, false);
+	crap::RangeValidator integralRange(-5, 5, true);
+	CHECK(range.validate("2.5"));
+	CHECK(!range.validate("10.5"));
+	CHECK(!range.validate("2,5"));
+	CHECK(!range.validate(" 2"));
+	CHECK(!range.validate(""));
+	CHECK(integralRange.validate("-5"));
+	CHECK(!integralRange.validate("1.5"));
+	CHECK(!integralRange.validate("99999999999999999999"));
+
+	// Conversion does not depend on decimal point of the current locale.
+	const char * const Locales[] = {"de_DE.UTF-8", "de_DE.utf8", "fr_FR.UTF-8", "ru_RU.UTF-8", "pl_PL.UTF-8"};
+	bool localeSet = false;
+	for (const char * locale : Locales)
+		if (std::setlocale(LC_NUMERIC, locale)) {
+			localeSet = true;
+			break;
+		}
+	if (localeSet) {
+		CHECK(Converts<double>("1.5", 1.5));
+		CHECK(Rejects<double>("1,5"));
+		CHECK(range.validate("2.5"));
+		CHECK(!range.validate("2,5"));
+		std::setlocale(LC_NUMERIC, "C");
+	} else
+		std::cout << "list: no locale with decimal comma is installed, locale checks skipped" << std::endl;
+}
+
+void TestLists()
+{
+	crap::KeyArg cmd("prog");
+	crap::Parser parser(& cmd);
+	crap::IntListArg ids("ids", "id");
+	crap::FloatListArg weights("--weights", "weight", "", ';');
+	parser.addAttr(& ids).addAttr(& weights);
+
+	char * argv[] = {const_cast<char *>("prog"), const_cast<char *>("ids=1,-5,9"), const_cast<char *>("--weights=0.5;2")};
+	CHECK_NOTHROW(parser.parse(3, argv));
+	CHECK(ids.values() == std::vector<long long>({1, -5, 9}));
+	CHECK(weights.values() == std::vector<double>({0.5, 2.0}));
+
+	parser.reset();
+	char * emptyArgv[] = {const_cast<char *>("prog"), const_cast<char *>("ids=")};
+	CHECK_NOTHROW(parser.parse(2, emptyArgv));
+	CHECK(ids.isSet() && ids.values().empty());
+
+	// Invalid elements are reported by both parse and lint.
+	const char * const InvalidValues[] = {"ids=1,x,3", "ids=1,,3", "ids=1,", "ids=99999999999999999999", "ids=1.5"};
+	for (const char * value : InvalidValues) {
+		char * invalidArgv[] = {const_cast<char *>("prog"), const_cast<char *>(value)};
+		parser.reset();
+		CHECK_THROWS(parser.parse(2, invalidArgv), crap::InvalidArgValueException);
+		CHECK(ids.values().empty());
+		crap::ParseErrorsContainer errors;
+		CHECK(!parser.lint(2, invalidArgv, errors));
+		CHECK((errors.size() == 1) && (errors.front().code == crap::ParseError::INVALID_ARG_VALUE) && (errors.front().arg == & ids));
+	}
+
+	// Long list is converted in the same way as element by element.
+	std::mt19937_64 random(2);
+	std::vector<long long> expected;
+	std::string value = "ids=";
+	for (int i = 0; i < 100000; i++) {
+		expected.push_back(static_cast<long long>(random() >> (random() % 63 + 1)) * ((random() % 2) ? 1 : -1));
+		value.append(i ? "," : "").append(std::to_string(expected.back()));
+	}
+	char * longArgv[] = {const_cast<char *>("prog"), & value[0]};
+	parser.reset();
+	CHECK_NOTHROW(parser.parse(2, longArgv));
+	CHECK(ids.values() == expected);
+}
+
+}
+
+int main()
+{
+	TestIntegers();
+	TestFloats();
+	TestLists();
+	return test::Summary("list");
+}
@@ -0,0 +1,306 @@
+// Regression tests of Parser.
+
+#include "test.hpp"
+#include "../include/crap.hpp"
+
+#include <deque>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+/**
+ * Abbreviations known to a nested parser must not shadow exact matches of enclosing parsers.
+ */
+void TestAbbreviationAlongPath()
+{
+	crap::KeyArg cmd("prog");
+	crap::Parser parser(& cmd);
+	crap::KeyArg verbose("--verbose");
+	parser.addAttr(& verbose);
+	crap::KeyArg quiet("--quiet");
+	parser.addAttr(& quiet);
+	crap::KeyArg subCmd("sub");
+	crap::Parser * subParser = parser.addSubCmd(& subCmd);
+	crap::KeyValueArg verboseLevel("--verbose-level", "level");
+	subParser->addAttr(& verboseLevel);
+
+	char * exactArgv[] = {const_cast<char *>("prog"), const_cast<char *>("sub"), const_cast<char *>("--verbose")};
+	CHECK_NOTHROW(parser.parse(3, exactArgv));
+	CHECK(verbose.isSet());
+	CHECK(!verboseLevel.isSet());
+
+	crap::ParseErrorsContainer errors;
+	CHECK(parser.lint(3, exactArgv, errors));
+	CHECK(errors.empty());
+
+	// Abbreviation is still resolved by the nested parser, if no parser along the path recognizes the argument exactly.
+	parser.reset();
+	char * abbreviatedArgv[] = {const_cast<char *>("prog"), const_cast<char *>("sub"), const_cast<char *>("--verbose-l=2")};
+	CHECK_NOTHROW(parser.parse(3, abbreviatedArgv));
+	CHECK(!verbose.isSet());
+	CHECK(verboseLevel.isSet() && (verboseLevel.value() == "2"));
+
+	// Enclosing parser resolves abbreviations unknown to the nested one.
+	parser.reset();
+	char * outerArgv[] = {const_cast<char *>("prog"), const_cast<char *>("sub"), const_cast<char *>("--qu")};
+	CHECK_NOTHROW(parser.parse(3, outerArgv));
+	CHECK(quiet.isSet());
+}
+
+/**
+ * Schema revision is kept by each parser tree, so that unrelated schemas do not invalidate each other's lookup tables.
+ */
+void TestSchemaRevision()
+{
+	crap::KeyArg cmd("prog");
+	crap::Parser parser(& cmd);
+	crap::KeyArg subCmd("sub");
+	crap::Parser * subParser = parser.addSubCmd(& subCmd);
+	crap::KeyValueArg level("--level", "level");
+	subParser->addAttr(& level);
+
+	unsigned long revision = parser.schemaRevision();
+	crap::KeyArg unrelatedCmd("other");
+	crap::Parser unrelatedParser(& unrelatedCmd);
+	crap::KeyValueArg unrelatedArg("--unrelated", "value");
+	unrelatedArg.setRequired(true);
+	unrelatedParser.addAttr(& unrelatedArg);
+	CHECK(parser.schemaRevision() == revision);
+
+	// Modifications of nested arguments and sub-commands reach the root parser.
+	level.addAlias("-l");
+	CHECK(parser.schemaRevision() > revision);
+	revision = parser.schemaRevision();
+	subCmd.addAlias("s");
+	CHECK(parser.schemaRevision() > revision);
+	revision = parser.schemaRevision();
+	{
+		crap::ArgGroup group;
+		subParser->addArgGroup(& group);
+		CHECK(parser.schemaRevision() > revision);
+		revision = parser.schemaRevision();
+	}
+	// Group removes itself from the parser, when it is destroyed.
+	CHECK(parser.schemaRevision() > revision);
+
+	char * argv[] = {const_cast<char *>("prog"), const_cast<char *>("s"), const_cast<char *>("-l"), const_cast<char *>("2")};
+	CHECK_NOTHROW(parser.parse(4, argv));
+	CHECK(level.value() == "2");
+
+	// Cache is not cleared by unrelated schemas.
+	crap::ParseCache cache(parser, 4);
+	parser.reset();
+	cache.parse(4, argv);
+	crap::KeyValueArg anotherUnrelatedArg("--another", "value");
+	parser.reset();
+	cache.parse(4, argv);
+	CHECK(cache.hits() == 1);
+
+	// Arguments can be destroyed before or after their groups.
+	std::unique_ptr<crap::KeyArg> flag(new crap::KeyArg("-f"));
+	std::unique_ptr<crap::ArgGroup> group(new crap::ArgGroup);
+	group->addAttr(flag.get());
+	group.reset();
+	flag->setRequired(true);
+}
+
+/**
+ * Schemas built and parsed concurrently by separate threads do not share any state.
+ */
+void TestConcurrentSchemas()
+{
+	auto run = []() {
+		for (int i = 0; i < 200; i++) {
+			crap::KeyArg cmd("prog");
+			crap::Parser parser(& cmd);
+			crap::KeyValueArg option("--option", "value");
+			option.setRequired(true);
+			parser.addAttr(& option);
+			char * argv[] = {const_cast<char *>("prog"), const_cast<char *>("--opt=1")};
+			parser.parse(2, argv);
+		}
+	};
+	std::thread thread(run);
+	CHECK_NOTHROW(run());
+	thread.join();
+}
+
+/**
+ * Parser can be reset after its command argument has been destroyed.
+ */
+void TestDestroyedCmd()
+{
+	std::unique_ptr<crap::KeyArg> cmd(new crap::KeyArg("prog"));
+	crap::Parser parser(cmd.get());
+	crap::KeyArg verbose("-v");
+	parser.addAttr(& verbose);
+	cmd.reset();
+	CHECK(parser.cmd() == nullptr);
+	CHECK_NOTHROW(parser.reset());
+}
+
+/**
+ * Sub-commands are found along nested paths and their help is rendered with commands leading to them. ValueArg command,
+ * which matches any value on the command line, does not shadow commands added after it.
+ */
+void TestSubCmdHelp()
+{
+	crap::KeyArg cmd("prog", "Program.");
+	crap::Parser parser(& cmd);
+	parser.setHeader("Header.\n");
+	parser.setFooter("Footer.\n");
+	crap::KeyArg verbose("-v", "Verbose output.");
+	parser.addAttr(& verbose);
+	crap::ValueArg file("file", "Input file.");
+	crap::Parser * fileParser = parser.addSubCmd(& file);
+	crap::KeyArg force("--force", "Overwrite output.");
+	fileParser->addAttr(& force);
+	crap::KeyArg remote("remote", "Manage remotes.");
+	remote.addAlias("rem");
+	crap::Parser * remoteParser = parser.addSubCmd(& remote);
+	crap::KeyArg add("add", "Add a remote.");
+	crap::Parser * addParser = remoteParser->addSubCmd(& add);
+	crap::KeyValueArg url("--url", "url", "Remote URL.");
+	addParser->addAttr(& url);
+
+	CHECK(parser.findSubCmd(crap::Vector<crap::String>()) == & parser);
+	CHECK(parser.findSubCmd(crap::Vector<crap::String>{"remote"}) == remoteParser);
+	CHECK(parser.findSubCmd(crap::Vector<crap::String>{"rem", "add"}) == addParser);
+	CHECK(parser.findSubCmd(crap::Vector<crap::String>{"<file>"}) == fileParser);
+	CHECK(parser.findSubCmd(crap::Vector<crap::String>{"unknown"}) == nullptr);
+	CHECK(parser.findSubCmd(crap::Vector<crap::String>{"remote", "remove"}) == nullptr);
+	CHECK(parser.findSubCmd(crap::Vector<crap::String>{"add"}) == nullptr);
+
+	std::ostringstream addHelp;
+	parser.printSubCmdHelp({"rem", "add"}, addHelp);
+	CHECK(addHelp.str() == "Header.\n"
+			"Usage: prog remote add [--url=<url>]\n"
+			"Add a remote.\n"
+			"add options:\n"
+			"[ --url <url> ] - Remote URL. Default value: \"\".\n"
+			"Footer.\n");
+	// Help of a sub-command does not describe its siblings and ancestors.
+	CHECK(addHelp.str().find("-v") == std::string::npos);
+	CHECK(addHelp.str().find("--force") == std::string::npos);
+
+	std::ostringstream fileHelp;
+	parser.printSubCmdHelp({"<file>"}, fileHelp);
+	CHECK(fileHelp.str().find("Usage: prog <file> --force\n") != std::string::npos);
+	CHECK(fileHelp.str().find("remote") == std::string::npos);
+
+	std::ostringstream unusedHelp;
+	try {
+		parser.printSubCmdHelp({"remote", "remove"}, unusedHelp);
+		test::Fail(__FILE__, __LINE__, "UnrecognizedArgException has not been thrown");
+	} catch (const crap::UnrecognizedArgException & e) {
+		CHECK(e.argNum() == 1);
+	}
+	CHECK(unusedHelp.str().empty());
+}
+
+struct LookupSchema
+{
+	LookupSchema();
+
+	/**
+	 * Parse command line.
+	 * @return result of Parser::parse().
+	 */
+	int parse(std::vector<std::string> args);
+
+	crap::KeyArg cmd;
+	crap::Parser parser;
+	std::deque<crap::KeyValueArg> options;
+	crap::KeyArg verbose;
+	crap::KeyArg version;
+	crap::KeyArg quiet;
+};
+
+LookupSchema::LookupSchema():
+    cmd("prog"),
+    parser(& cmd),
+    verbose("--verbose"),
+    version("--version"),
+    quiet("--quiet")
+{
+	for (int i = 0; i < 40; i++) {
+		options.emplace_back("--option" + std::to_string(i), "value");
+		parser.addAttr(& options.back());
+	}
+	parser.addAttr(& verbose).addAttr(& version).addAttr(& quiet);
+}
+
+int LookupSchema::parse(std::vector<std::string> args)
+{
+	std::vector<char *> argv;
+	for (std::vector<std::string>::iterator it = args.begin(); it != args.end(); ++it)
+		argv.push_back(& (*it)[0]);
+	parser.reset();
+	return parser.parse(static_cast<int>(argv.size()), argv.data());
+}
+
+/**
+ * Lookup profile recorded by an adaptive parser reorders lookup table of a fresh parser without affecting results of
+ * parsing.
+ */
+void TestLookupProfile()
+{
+	LookupSchema recorded;
+	recorded.parser.setAdaptiveLookup(true);
+	CHECK(recorded.parser.lookupProfile().empty());
+	// Enough lookups for the table to be adapted at least once.
+	for (int i = 0; i < 1500; i++)
+		recorded.parse({"prog", "--option37=a", "--verbose"});
+	for (int i = 0; i < 100; i++)
+		recorded.parse({"prog", "--option3=b"});
+	crap::Parser::LookupProfile profile = recorded.parser.lookupProfile();
+	CHECK(profile.size() == 3);
+	CHECK((profile["--option37"] > profile["--option3"]) && (profile["--option3"] > 0));
+	CHECK(profile["--verbose"] == profile["--option37"]);
+	CHECK(profile.find("--quiet") == profile.end());
+
+	LookupSchema fresh;
+	crap::Parser::LookupProfile persisted(profile);
+	persisted["--unknown"] = 1000;
+	fresh.parser.setLookupProfile(persisted);
+	CHECK(!fresh.parser.adaptiveLookup());
+	CHECK(fresh.parser.lookupProfile() == profile);
+
+	// Every alias is still found exactly and by abbreviation.
+	for (std::size_t i = 0; i < fresh.options.size(); i++) {
+		std::string value = "v" + std::to_string(i);
+		CHECK(fresh.parse({"prog", fresh.options[i].name() + "=" + value}) == 2);
+		CHECK(fresh.options[i].value() == value);
+	}
+	CHECK_NOTHROW(fresh.parse({"prog", "--verbose", "--version", "--quiet"}));
+	CHECK(fresh.verbose.isSet() && fresh.version.isSet() && fresh.quiet.isSet());
+	CHECK_NOTHROW(fresh.parse({"prog", "--verb", "--vers", "--q", "--option39", "x"}));
+	CHECK(fresh.verbose.isSet() && fresh.version.isSet() && fresh.quiet.isSet() && (fresh.options[39].value() == "x"));
+	CHECK_THROWS(fresh.parse({"prog", "--ver"}), crap::AmbiguousArgException);
+	CHECK_THROWS(fresh.parse({"prog", "--option"}), crap::AmbiguousArgException);
+	CHECK_THROWS(fresh.parse({"prog", "--verbosity"}), crap::UnrecognizedArgException);
+
+	// Profile survives rebuild of the lookup table after schema change.
+	crap::KeyArg extra("--extra");
+	fresh.parser.addAttr(& extra);
+	CHECK_NOTHROW(fresh.parse({"prog", "--ex"}));
+	CHECK(extra.isSet());
+	CHECK(fresh.parser.lookupProfile() == profile);
+}
+
+}
+
+int main()
+{
+	TestAbbreviationAlongPath();
+	TestSchemaRevision();
+	TestConcurrentSchemas();
+	TestDestroyedCmd();
+	TestSubCmdHelp();
+	TestLookupProfile();
+	return test::Summary("parser");
+}
@@ -0,0 +1,355 @@
+// Tests of ParseRecord and ParseCache. Results restored from a record or from cache have to be the same as results of
+// parsing the same command line, including arguments set to empty values and arguments with lazily computed defaults.
+
+#include "test.hpp"
+#include "../include/crap.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <typeinfo>
+#include <vector>
+
+namespace {
+
+struct Schema
+{
+	Schema();
+
+	crap::KeyArg cmd;
+	crap::Parser parser;
+	crap::KeyArg verbose;
+	crap::KeyValueArg name;
+	crap::KeyValueArg lazy;
+	crap::IntListArg ids;
+	crap::FloatListArg ratios;
+	crap::ValueArg file;
+	crap::KeyValueArg runCmd;
+	crap::Parser * runParser;
+	crap::KeyArg force;
+	crap::ValueArg target;
+	int lazyCalls;
+};
+
+Schema::Schema():
+    cmd("prog"),
+    parser(& cmd),
+    verbose("-v"),
+    name("--name", "name"),
+    lazy("--lazy", "value"),
+    ids("ids", "list"),
+    ratios("--ratios", "list"),
+    file("file"),
+    runCmd("run", "mode"),
+    runParser(nullptr),
+    force("--force"),
+    target("target"),
+    lazyCalls(0)
+{
+	verbose.addAlias("--verbose");
+	name.setDefaultValue("default");
+	lazy.setDefaultValue([this]() {
+		lazyCalls++;
+		return std::string("computed");
+	}, "<computed>");
+	ids.setDefaultValue("1,2");
+	file.setDefaultValue("default.txt");
+	parser.addAttr(& verbose);
+	parser.addAttr(& name);
+	parser.addAttr(& lazy);
+	parser.addAttr(& ids);
+	parser.addAttr(& ratios);
+	parser.addAttr(& file);
+	runParser = parser.addSubCmd(& runCmd);
+	runParser->addAttr(& force);
+	runParser->addAttr(& target);
+}
+
+/**
+ * Describe states and values of all the arguments. Values are read without triggering lazy defaults of unset arguments.
+ */
+std::string Describe(Schema & schema, int result)
+{
+	std::ostringstream description;
+	description << "result " << result << ";";
+	const crap::Arg * args[] = {& schema.cmd, & schema.verbose, & schema.name, & schema.ids, & schema.ratios, & schema.file,
+			& schema.runCmd, & schema.force, & schema.target};
+	for (std::size_t i = 0; i < sizeof(args) / sizeof(args[0]); i++)
+		description << (args[i]->isSet() ? " +" : " -");
+	description << " " << schema.name.value() << " " << schema.file.value() << " " << schema.target.value();
+	description << (schema.lazy.isSet() ? " +" : " -") << "lazy";
+	if (schema.lazy.isSet())
+		description << " " << schema.lazy.value();
+	description << "; ids";
+	for (std::size_t i = 0; i < schema.ids.values().size(); i++)
+		description << " " << schema.ids.values()[i];
+	description << "; ratios";
+	for (std::size_t i = 0; i < schema.ratios.values().size(); i++)
+		description << " " << schema.ratios.values()[i];
+	description << "; trailing " << schema.parser.trailingArgs().argc;
+	return description.str();
+}
+
+std::vector<std::vector<std::string>> CommandLines()
+{
+	return {
+		{"prog"},
+		{"prog", "-v", "--name=x", "ids=3,4", "file.txt"},
+		// Explicitly empty values differ from defaults.
+		{"prog", "ids=", "--name="},
+		{"prog", "--name", ""},
+		{"prog", ""},
+		{"prog", "--lazy=", "--ratios=0.5,1e3"},
+		{"prog", "--lazy", "given"},
+		{"prog", "--verbose", "run=fast", "--force", "t"},
+		{"prog", "run=", "t"},
+		{"prog", "run=slow", "--", "-v", "x"},
+		// Failures.
+		{"prog", "ids=1,x"},
+		{"prog", "--unknown"},
+		{"prog", "-v", "-v"},
+		{"prog", "--name"}
+	};
+}
+
+void TestRecord()
+{
+	std::vector<std::vector<std::string>> commandLines = CommandLines();
+	for (std::vector<std::vector<std::string>>::iterator line = commandLines.begin(); line != commandLines.end(); ++line) {
+		std::vector<char *> argv;
+		for (std::vector<std::string>::iterator it = line->begin(); it != line->end(); ++it)
+			argv.push_back(& (*it)[0]);
+		int argc = static_cast<int>(argv.size());
+
+		Schema master;
+		int result;
+		try {
+			result = master.parser.parse(argc, argv.data());
+		} catch (const crap::Exception & ) {
+			continue;
+		}
+		std::string buffer;
+		crap::ParseRecord record(master.parser);
+		record.write(buffer);
+		// Lazy default is not computed for writing.
+		CHECK(master.lazyCalls == 0);
+		std::string expected = Describe(master, result);
+
+		Schema worker;
+		crap::ParseRecord workerRecord(worker.parser);
+		CHECK_NOTHROW(workerRecord.load(buffer.data(), buffer.size()));
+		CHECK(workerRecord.isSet(worker.name) == master.name.isSet());
+		if (master.name.isSet())
+			CHECK(workerRecord.value(worker.name) == master.name.value());
+		CHECK(workerRecord.isSet(worker.ids) == master.ids.isSet());
+		CHECK_NOTHROW(workerRecord.apply());
+		CHECK(worker.lazyCalls == 0);
+		// Trailing arguments are not recorded.
+		std::string actual = Describe(worker, result);
+		std::string expectedWithoutTrailing = expected.substr(0, expected.rfind("; trailing ")) + "; trailing 0";
+		if (actual != expectedWithoutTrailing)
+			test::Fail(__FILE__, __LINE__, "record differs from parse for \"" + line->back() + "\"\nparse: " + expected + "\nrecord: " + actual);
+	}
+}
+
+/**
+ * Group, which exposes the optional command, that has been set.
+ */
+struct InspectedGroup:
+    crap::ArgGroup
+{
+	using crap::ArgGroup::optionSet;
+};
+
+void TestCmdGroup()
+{
+	crap::KeyArg cmd("prog");
+	crap::Parser parser(& cmd);
+	InspectedGroup group;
+	group.setOptionRequired(true);
+	crap::KeyArg build("build");
+	crap::KeyArg test("test");
+	group.addCmd(& build);
+	group.addCmd(& test);
+	parser.addArgGroup(& group);
+
+	char * argv[] = {const_cast<char *>("prog"), const_cast<char *>("build")};
+	parser.parse(2, argv);
+	CHECK(group.optionSet() == & build);
+	std::string buffer;
+	crap::ParseRecord record(parser);
+	record.write(buffer);
+
+	// Optional command restored from a record is marked in its group as if it has been parsed.
+	parser.reset();
+	CHECK(group.optionSet() == nullptr);
+	CHECK_NOTHROW(record.load(buffer.data(), buffer.size()));
+	CHECK_NOTHROW(record.apply());
+	CHECK(build.isSet() && !test.isSet());
+	CHECK(group.optionSet() == & build);
+}
+
+void TestTamperedRecord()
+{
+	// Layout: prog, sub, -v of sub, -v of prog. Second occurrence of the shared argument has no slot of its own.
+	crap::KeyArg cmd("prog");
+	crap::Parser parser(& cmd);
+	crap::KeyArg subCmd("sub");
+	crap::Parser * subParser = parser.addSubCmd(& subCmd);
+	crap::KeyArg verbose("-v");
+	subParser->addAttr(& verbose);
+	parser.addAttr(& verbose);
+	const std::size_t HEADER_SIZE = 24;
+	const std::size_t ENTRY_SIZE = 8;
+
+	char * argv[] = {const_cast<char *>("prog"), const_cast<char *>("sub"), const_cast<char *>("-v")};
+	parser.parse(3, argv);
+	std::string buffer;
+	crap::ParseRecord record(parser);
+	record.write(buffer);
+	std::uint32_t count;
+	std::memcpy(& count, & buffer[12], sizeof(count));
+	CHECK(count == 4);
+	parser.reset();
+	CHECK_NOTHROW(record.load(buffer.data(), buffer.size()));
+
+	// Entry of the command copied into the slot of the repeated occurrence.
+	std::string sharedSlot(buffer);
+	std::memcpy(& sharedSlot[HEADER_SIZE + 3 * ENTRY_SIZE], & sharedSlot[HEADER_SIZE], ENTRY_SIZE);
+	CHECK_THROWS(record.load(sharedSlot.data(), sharedSlot.size()), crap::Exception);
+	CHECK_THROWS(record.apply(), crap::Exception);
+
+	// Command path refers to an attribute.
+	std::string attrInPath(buffer);
+	std::uint32_t attrIndex = 2;
+	std::memcpy(& attrInPath[HEADER_SIZE + count * ENTRY_SIZE], & attrIndex, sizeof(attrIndex));
+	CHECK_THROWS(record.load(attrInPath.data(), attrInPath.size()), crap::Exception);
+	CHECK(record.cmdPath().empty());
+
+	// Untampered buffer is still loaded.
+	CHECK_NOTHROW(record.load(buffer.data(), buffer.size()));
+	CHECK_NOTHROW(record.apply());
+	CHECK(verbose.isSet() && subCmd.isSet());
+}
+
+std::string CachedParse(crap::ParseCache & cache, Schema & schema, std::vector<std::string> args)
+{
+	std::vector<char *> argv;
+	for (std::vector<std::string>::iterator it = args.begin(); it != args.end(); ++it)
+		argv.push_back(& (*it)[0]);
+	try {
+		int result = cache.parse(static_cast<int>(argv.size()), argv.data());
+		return Describe(schema, result);
+	} catch (const crap::Exception & e) {
+		return std::string(typeid(e).name()) + ": " + e.what();
+	}
+}
+
+void TestCache()
+{
+	Schema schema;
+	crap::ParseCache cache(schema.parser, 4);
+	std::vector<std::vector<std::string>> commandLines = CommandLines();
+	for (std::vector<std::vector<std::string>>::iterator line = commandLines.begin(); line != commandLines.end(); ++line) {
+		unsigned long misses = cache.misses();
+		std::string miss = CachedParse(cache, schema, *line);
+		CHECK(cache.misses() == misses + 1);
+		unsigned long hits = cache.hits();
+		std::string hit = CachedParse(cache, schema, *line);
+		CHECK(cache.hits() == hits + 1);
+		if (hit != miss)
+			test::Fail(__FILE__, __LINE__, "cache hit differs from miss for \"" + line->back() + "\"\nmiss: " + miss + "\nhit: " + hit);
+	}
+
+	// Cache is dropped when schema of its parser changes, but not when an unrelated schema changes.
+	std::vector<std::string> args{"prog", "-v"};
+	CachedParse(cache, schema, args);
+	unsigned long hits = cache.hits();
+	Schema other;
+	crap::KeyArg unrelated("--unrelated");
+	other.parser.addAttr(& unrelated);
+	CachedParse(cache, schema, args);
+	CHECK(cache.hits() == hits + 1);
+
+	// Entry cached before the change is not hit.
+	crap::KeyArg quiet("-q");
+	schema.parser.addAttr(& quiet);
+	CachedParse(cache, schema, args);
+	CHECK(cache.hits() == hits + 1);
+	std::vector<std::string> quietArgs{"prog", "-q"};
+	CHECK(CachedParse(cache, schema, quietArgs).find("result 2") == 0);
+	CHECK(quiet.isSet());
+}
+
+/**
+ * Schema changes, which do not affect lookup tables, but change results of parsing, drop cached entries as well. Cache of
+ * zero capacity parses each command line, so it provides outcomes to compare with.
+ */
+void TestCacheSchemaChanges()
+{
+	Schema schema;
+	crap::ParseCache cache(schema.parser, 4);
+	crap::ParseCache direct(schema.parser, 0);
+	std::vector<std::string> cmdOnly{"prog"};
+	std::vector<std::string> name{"prog", "--name=50"};
+	std::vector<std::string> ids{"prog", "ids=3,4"};
+	CHECK(CachedParse(cache, schema, cmdOnly).find("result 1") == 0);
+	CHECK(CachedParse(cache, schema, name).find("result 2") == 0);
+	CHECK(CachedParse(cache, schema, ids).find("result 2") == 0);
+
+	// Command required by a group.
+	schema.parser.setOptionRequired(true);
+	unsigned long hits = cache.hits();
+	std::string expected = CachedParse(direct, schema, cmdOnly);
+	CHECK(expected.find("MissingArgException") != std::string::npos);
+	CHECK(CachedParse(cache, schema, cmdOnly) == expected);
+	CHECK(CachedParse(cache, schema, cmdOnly) == expected);
+	CHECK(cache.hits() == hits + 1);
+	schema.parser.setOptionRequired(false);
+
+	// Validator added to an argument. Error refers to the argument, which has been rejected.
+	crap::RangeValidator range(1, 10, true);
+	schema.name.addValidator(& range);
+	int expectedArgNum = -1;
+	int argNum = -1;
+	int hitArgNum = -1;
+	std::vector<char *> argv{& name[0][0], & name[1][0]};
+	try {
+		direct.parse(2, argv.data());
+	} catch (const crap::InvalidArgValueException & e) {
+		expectedArgNum = e.argNum();
+	}
+	try {
+		cache.parse(2, argv.data());
+	} catch (const crap::InvalidArgValueException & e) {
+		argNum = e.argNum();
+	}
+	try {
+		cache.parse(2, argv.data());
+	} catch (const crap::InvalidArgValueException & e) {
+		hitArgNum = e.argNum();
+	}
+	CHECK(expectedArgNum == 1);
+	CHECK(argNum == expectedArgNum);
+	CHECK(hitArgNum == expectedArgNum);
+
+	// List delimiter.
+	schema.ids.setDelimiter(':');
+	expected = CachedParse(direct, schema, ids);
+	CHECK(expected.find("InvalidArgValueException") != std::string::npos);
+	CHECK(CachedParse(cache, schema, ids) == expected);
+	CHECK(CachedParse(cache, schema, ids) == expected);
+}
+
+}
+
+int main()
+{
+	TestRecord();
+	TestCmdGroup();
+	TestTamperedRecord();
+	TestCache();
+	TestCacheSchemaChanges();
+	return test::Summary("record");
+}
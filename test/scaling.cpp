@@ -0,0 +1,312 @@
+// Scaling checks. Each check measures an operation on an input of size n and of size GROWTH * n and fails if time grows
+// faster than n log n, allowing for some noise. Checks grow number of arguments, number of aliases, depth of sub-commands
+// and length of tokens.
+
+#include "test.hpp"
+#include "../include/crap.hpp"
+
+#include <cmath>
+#include <memory>
+#include <sstream>
+#include <vector>
+
+namespace {
+
+const std::size_t GROWTH = 8;
+
+/**
+ * Maximal exponent of the growth rate. Linear growth has exponent 1, n log n growth between sizes used by checks has
+ * exponent of about 1.15 and quadratic growth has exponent 2.
+ */
+const double MAX_EXPONENT = 1.5;
+
+typedef std::function<void ()> Operation;
+
+struct Schema
+{
+	Schema();
+
+	void addOptions(std::size_t count, const std::string & prefix = "--option");
+
+	/**
+	 * Add a chain of nested sub-commands.
+	 * @return parser of the innermost sub-command.
+	 */
+	crap::Parser * addSubCmds(std::size_t depth);
+
+	void setArgs(const std::vector<std::string> & args);
+
+	/**
+	 * Reset parser and parse arguments.
+	 * @return @p false if parser has thrown an exception.
+	 */
+	bool parse();
+
+	crap::KeyArg cmd;
+	crap::Parser parser;
+	std::vector<std::unique_ptr<crap::Arg>> args;
+	std::vector<std::string> argStrings;
+	std::vector<char *> argv;
+};
+
+Schema::Schema():
+	cmd("prog"),
+	parser(& cmd)
+{
+}
+
+void Schema::addOptions(std::size_t count, const std::string & prefix)
+{
+	for (std::size_t i = 0; i < count; i++) {
+		std::ostringstream name;
+		name << prefix << i;
+		args.push_back(std::unique_ptr<crap::Arg>(new crap::KeyValueArg(name.str(), "value")));
+		parser.addAttr(static_cast<crap::KeyValueArg *>(args.back().get()));
+	}
+}
+
+crap::Parser * Schema::addSubCmds(std::size_t depth)
+{
+	crap::Parser * innermost = & parser;
+	for (std::size_t i = 0; i < depth; i++) {
+		args.push_back(std::unique_ptr<crap::Arg>(new crap::KeyArg("sub")));
+		innermost = innermost->addSubCmd(args.back().get());
+		args.push_back(std::unique_ptr<crap::Arg>(new crap::KeyArg("--flag")));
+		innermost->addAttr(static_cast<crap::KeyArg *>(args.back().get()));
+	}
+	return innermost;
+}
+
+void Schema::setArgs(const std::vector<std::string> & args)
+{
+	argStrings = args;
+	argv.clear();
+	for (std::vector<std::string>::iterator it = argStrings.begin(); it != argStrings.end(); ++it)
+		argv.push_back(& (*it)[0]);
+}
+
+bool Schema::parse()
+{
+	parser.reset();
+	try {
+		parser.parse(static_cast<int>(argv.size()), argv.data());
+	} catch (const crap::Exception & ) {
+		return false;
+	}
+	return true;
+}
+
+void CheckScaling(const char * name, const std::function<Operation (std::size_t size)> & prepare, std::size_t size)
+{
+	double small = test::Seconds(prepare(size));
+	double large = test::Seconds(prepare(size * GROWTH));
+	double exponent = std::log(large / small) / std::log(static_cast<double>(GROWTH));
+	std::cout << name << ": " << small * 1e6 << " us -> " << large * 1e6 << " us, exponent " << exponent << std::endl;
+	if (exponent > MAX_EXPONENT)
+		test::Fail(__FILE__, __LINE__, std::string(name) + " grows faster than n log n");
+}
+
+/**
+ * Parse n distinct options.
+ */
+Operation ParseOptions(std::size_t size)
+{
+	std::shared_ptr<Schema> schema(new Schema);
+	schema->addOptions(size);
+	std::vector<std::string> args{"prog"};
+	for (std::size_t i = 0; i < size; i++) {
+		std::ostringstream arg;
+		arg << "--option" << i << "=" << i;
+		args.push_back(arg.str());
+	}
+	schema->setArgs(args);
+	CHECK(schema->parse());
+	return [schema]() {
+		schema->parse();
+	};
+}
+
+/**
+ * Parse n value-only arguments.
+ */
+Operation ParseValues(std::size_t size)
+{
+	std::shared_ptr<Schema> schema(new Schema);
+	std::vector<std::string> args{"prog"};
+	for (std::size_t i = 0; i < size; i++) {
+		schema->args.push_back(std::unique_ptr<crap::Arg>(new crap::ValueArg("value")));
+		schema->parser.addAttr(static_cast<crap::ValueArg *>(schema->args.back().get()));
+		args.push_back("value");
+	}
+	schema->setArgs(args);
+	CHECK(schema->parse());
+	return [schema]() {
+		schema->parse();
+	};
+}
+
+/**
+ * Parse a few options of a schema with n options.
+ */
+Operation ParseAmongAliases(std::size_t size)
+{
+	std::shared_ptr<Schema> schema(new Schema);
+	schema->addOptions(size);
+	schema->setArgs({"prog", "--option0=a", "--option1", "b", "--option2=c"});
+	CHECK(schema->parse());
+	return [schema]() {
+		schema->parse();
+	};
+}
+
+/**
+ * Build schema with n options and parse it for the first time.
+ */
+Operation BuildSchema(std::size_t size)
+{
+	return [size]() {
+		Schema schema;
+		schema.addOptions(size);
+		schema.setArgs({"prog", "--option0=a"});
+		schema.parse();
+	};
+}
+
+/**
+ * Parse command line entering n nested sub-commands.
+ */
+Operation ParseSubCmds(std::size_t size)
+{
+	std::shared_ptr<Schema> schema(new Schema);
+	schema->addSubCmds(size);
+	std::vector<std::string> args{"prog"};
+	for (std::size_t i = 0; i < size; i++)
+		args.push_back("sub");
+	args.push_back("--flag");
+	schema->setArgs(args);
+	CHECK(schema->parse());
+	return [schema]() {
+		schema->parse();
+	};
+}
+
+/**
+ * Parse an option, which value has n characters.
+ */
+Operation ParseLongValue(std::size_t size)
+{
+	std::shared_ptr<Schema> schema(new Schema);
+	schema->addOptions(16);
+	schema->setArgs({"prog", "--option1=" + std::string(size, 'x'), "--option2", std::string(size, 'y')});
+	CHECK(schema->parse());
+	return [schema]() {
+		schema->parse();
+	};
+}
+
+/**
+ * Parse an unrecognized argument of n characters, which shares prefix with options.
+ */
+Operation ParseLongUnrecognized(std::size_t size)
+{
+	std::shared_ptr<Schema> schema(new Schema);
+	schema->addOptions(64);
+	schema->setArgs({"prog", "--option1" + std::string(size, 'x')});
+	CHECK(!schema->parse());
+	return [schema]() {
+		schema->parse();
+	};
+}
+
+/**
+ * Parse glued key-only arguments of n characters. Argument is repeated, so parser throws once it has been set twice.
+ */
+Operation ParseLongGlued(std::size_t size)
+{
+	std::shared_ptr<Schema> schema(new Schema);
+	schema->args.push_back(std::unique_ptr<crap::Arg>(new crap::KeyArg("-v")));
+	schema->parser.addAttr(static_cast<crap::KeyArg *>(schema->args.back().get()));
+	schema->args.push_back(std::unique_ptr<crap::Arg>(new crap::KeyArg("-w")));
+	schema->parser.addAttr(static_cast<crap::KeyArg *>(schema->args.back().get()));
+	schema->setArgs({"prog", "-w" + std::string(size, 'v')});
+	CHECK(!schema->parse());
+	return [schema]() {
+		schema->parse();
+	};
+}
+
+/**
+ * Parse an abbreviation matching n options.
+ */
+Operation ParseAmbiguous(std::size_t size)
+{
+	std::shared_ptr<Schema> schema(new Schema);
+	schema->addOptions(size);
+	schema->setArgs({"prog", "--opt=1"});
+	CHECK(!schema->parse());
+	return [schema]() {
+		schema->parse();
+	};
+}
+
+/**
+ * Lint n unrecognized arguments.
+ */
+Operation LintUnrecognized(std::size_t size)
+{
+	std::shared_ptr<Schema> schema(new Schema);
+	schema->addOptions(16);
+	std::vector<std::string> args{"prog"};
+	for (std::size_t i = 0; i < size; i++)
+		args.push_back("--unknown");
+	schema->setArgs(args);
+	return [schema]() {
+		crap::ParseErrorsContainer errors;
+		schema->parser.lint(static_cast<int>(schema->argv.size()), schema->argv.data(), errors);
+	};
+}
+
+/**
+ * Print help of a schema with n options.
+ */
+Operation PrintHelpOptions(std::size_t size)
+{
+	std::shared_ptr<Schema> schema(new Schema);
+	schema->addOptions(size);
+	return [schema]() {
+		std::ostringstream stream;
+		schema->parser.printHelp(stream);
+	};
+}
+
+/**
+ * Print help of a schema with n nested sub-commands.
+ */
+Operation PrintHelpSubCmds(std::size_t size)
+{
+	std::shared_ptr<Schema> schema(new Schema);
+	schema->addSubCmds(size);
+	return [schema]() {
+		std::ostringstream stream;
+		schema->parser.printHelp(stream);
+	};
+}
+
+}
+
+int main()
+{
+	CheckScaling("parse: argument count", ParseOptions, 256);
+	CheckScaling("parse: value-only argument count", ParseValues, 256);
+	CheckScaling("parse: alias count", ParseAmongAliases, 512);
+	CheckScaling("build: alias count", BuildSchema, 256);
+	CheckScaling("parse: sub-command depth", ParseSubCmds, 32);
+	CheckScaling("parse: value length", ParseLongValue, 4096);
+	CheckScaling("parse: unrecognized token length", ParseLongUnrecognized, 4096);
+	CheckScaling("parse: glued token length", ParseLongGlued, 4096);
+	CheckScaling("parse: abbreviation candidates", ParseAmbiguous, 256);
+	CheckScaling("lint: argument count", LintUnrecognized, 256);
+	CheckScaling("help: alias count", PrintHelpOptions, 128);
+	CheckScaling("help: sub-command depth", PrintHelpSubCmds, 16);
+	return test::Summary("scaling");
+}
@@ -0,0 +1,278 @@
+// Tests of ParseServer and ParseClient. Server runs in a separate thread and polls its connections, while tests connect to
+// it as clients.
+
+#include "test.hpp"
+#include "../include/crap_server.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+/**
+ * Validator, which throws an exception, which is not derived from crap::Exception.
+ */
+class ThrowingValidator:
+    public crap::Validator
+{
+	public:
+	    bool validate(const char * value) const override
+		{
+			if (std::string(value) == "throw")
+				throw std::runtime_error("Validator has thrown.");
+			return true;
+		}
+
+		std::string description() const override
+		{
+			return "anything";
+		}
+};
+
+struct Schema
+{
+	Schema();
+
+	crap::KeyArg cmd;
+	crap::Parser parser;
+	crap::KeyArg verbose;
+	crap::KeyValueArg name;
+	ThrowingValidator validator;
+};
+
+Schema::Schema():
+    cmd("prog"),
+    parser(& cmd),
+    verbose("--verbose"),
+    name("--name", "name")
+{
+	parser.addAttr(& verbose);
+	name.addValidator(& validator);
+	parser.addAttr(& name);
+}
+
+std::string SocketPath()
+{
+	return "/tmp/crap_test_server_" + std::to_string(::getpid()) + ".sock";
+}
+
+/**
+ * Connect to the server with a raw socket.
+ */
+int Connect(const std::string & socketPath)
+{
+	sockaddr_un address = crap::server::Address(socketPath);
+	int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+	if ((fd >= 0) && (::connect(fd, reinterpret_cast<sockaddr *>(& address), sizeof(address)) < 0)) {
+		::close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+void TestParse(const std::string & socketPath)
+{
+	crap::ParseClient client(socketPath);
+	crap::ParseResult result;
+
+	const char * ok[] = {"prog", "--verbose", "--name=pyramid"};
+	client.parse(3, ok, result);
+	CHECK(result.status == crap::ParseResult::OK);
+	CHECK(result.args.size() == 3);
+	bool nameFound = false;
+	for (crap::ParseResult::ArgsContainer::const_iterator it = result.args.begin(); it != result.args.end(); ++it)
+		if (it->first == "--name")
+			nameFound = (it->second == "pyramid");
+	CHECK(nameFound);
+
+	// Connection is reused for subsequent requests and parser is reset between them.
+	const char * unrecognized[] = {"prog", "--unknown"};
+	client.parse(2, unrecognized, result);
+	CHECK(result.status == crap::ParseResult::ERROR);
+	CHECK(result.error.find("--unknown") != std::string::npos);
+
+	const char * cmdOnly[] = {"prog"};
+	client.parse(1, cmdOnly, result);
+	CHECK(result.status == crap::ParseResult::OK);
+	CHECK(result.args.size() == 1);
+
+	// Exceptions, which are not crap::Exception, are reported as errors.
+	const char * throwing[] = {"prog", "--name=throw"};
+	client.parse(2, throwing, result);
+	CHECK(result.status == crap::ParseResult::ERROR);
+	CHECK(result.error == "Validator has thrown.");
+}
+
+void TestTrailingArgs(const std::string & socketPath)
+{
+	crap::ParseClient client(socketPath);
+	crap::ParseResult result;
+
+	const char * trailing[] = {"prog", "--verbose", "--", "file", "--name=pyramid"};
+	client.parse(5, trailing, result);
+	CHECK(result.status == crap::ParseResult::OK);
+	CHECK(result.args.size() == 2);
+	CHECK((result.trailingArgs.size() == 2) && (result.trailingArgs[0] == "file") && (result.trailingArgs[1] == "--name=pyramid"));
+
+	const char * none[] = {"prog", "--verbose"};
+	client.parse(2, none, result);
+	CHECK(result.status == crap::ParseResult::OK);
+	CHECK(result.trailingArgs.empty());
+}
+
+void TestIdleClients(const std::string & socketPath)
+{
+	// Client, which does not send anything, and client, which stalls in the middle of a request, do not block the others.
+	int idle = Connect(socketPath);
+	int stalled = Connect(socketPath);
+	CHECK((idle >= 0) && (stalled >= 0));
+	std::string request;
+	crap::server::AppendUInt32(request, 16);
+	crap::server::Write(stalled, request.data(), 2);
+	TestParse(socketPath);
+
+	// Stalled connection is closed after timeout, idle connection stays open.
+	char byte;
+	CHECK(::read(stalled, & byte, 1) == 0);
+	request.assign(sizeof(std::uint32_t), '\0');
+	crap::server::AppendUInt32(request, 1);
+	crap::server::AppendString(request, "prog", 4);
+	crap::server::WriteFrame(idle, request);
+	std::string response;
+	CHECK(crap::server::ReadFrame(idle, response));
+	CHECK(!response.empty() && (response[0] == static_cast<char>(crap::ParseResult::OK)));
+	::close(stalled);
+	::close(idle);
+}
+
+void TestOversizedFrame(const std::string & socketPath)
+{
+	int fd = Connect(socketPath);
+	CHECK(fd >= 0);
+	if (fd < 0)
+		return;
+
+	// Payload is never sent, server has to respond without reading it.
+	std::string request;
+	crap::server::AppendUInt32(request, 0xFFFFFFFF);
+	crap::server::Write(fd, request.data(), request.size());
+	std::string response;
+	bool responded = false;
+	CHECK_NOTHROW(responded = crap::server::ReadFrame(fd, response));
+	CHECK(responded);
+	CHECK(!response.empty() && (response[0] == static_cast<char>(crap::ParseResult::ERROR)));
+
+	// Server closes the connection.
+	char byte;
+	CHECK(::read(fd, & byte, 1) == 0);
+	::close(fd);
+}
+
+void TestMalformedRequest(const std::string & socketPath)
+{
+	int fd = Connect(socketPath);
+	CHECK(fd >= 0);
+	if (fd < 0)
+		return;
+
+	// Request claims more arguments than it holds.
+	std::string request(sizeof(std::uint32_t), '\0');
+	crap::server::AppendUInt32(request, 2);
+	crap::server::AppendString(request, "prog", 4);
+	crap::server::WriteFrame(fd, request);
+	char byte;
+	CHECK(::read(fd, & byte, 1) == 0);
+	::close(fd);
+}
+
+void TestUnknownStatus()
+{
+	// Server, which responds with a status unknown to the client.
+	std::string socketPath = SocketPath() + ".fake";
+	sockaddr_un address = crap::server::Address(socketPath);
+	int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+	CHECK((fd >= 0) && (::bind(fd, reinterpret_cast<sockaddr *>(& address), sizeof(address)) == 0) && (::listen(fd, 1) == 0));
+	std::thread serverThread([fd]() {
+		int connection = ::accept(fd, nullptr, nullptr);
+		std::string request;
+		if ((connection >= 0) && crap::server::ReadFrame(connection, request)) {
+			std::string response(1, '\x07');
+			crap::server::AppendUInt32(response, 0);
+			crap::server::AppendUInt32(response, 0);
+			crap::server::WriteFrame(connection, response);
+		}
+		::close(connection);
+	});
+
+	crap::ParseClient client(socketPath);
+	crap::ParseResult result;
+	const char * argv[] = {"prog"};
+	CHECK_THROWS(client.parse(1, argv, result), crap::Exception);
+	serverThread.join();
+	::close(fd);
+	::unlink(socketPath.c_str());
+}
+
+void TestExistingFile()
+{
+	std::string path = SocketPath() + ".file";
+	{
+		std::ofstream file(path.c_str());
+		file << "data";
+	}
+	Schema schema;
+	CHECK_THROWS(crap::ParseServer server(schema.parser, path), crap::Exception);
+	std::ifstream file(path.c_str());
+	std::string content;
+	file >> content;
+	CHECK(content == "data");
+	::unlink(path.c_str());
+}
+
+}
+
+int main()
+{
+	std::string socketPath = SocketPath();
+	Schema schema;
+	{
+		crap::ParseServer server(schema.parser, socketPath);
+		server.setTimeout(100);
+
+		std::atomic<bool> stop(false);
+		std::thread serverThread([& server, & stop]() {
+			while (!stop.load())
+				server.poll(10);
+		});
+		TestParse(socketPath);
+		TestTrailingArgs(socketPath);
+		TestIdleClients(socketPath);
+		TestOversizedFrame(socketPath);
+		TestMalformedRequest(socketPath);
+		// Server survives failed connections.
+		TestParse(socketPath);
+		stop.store(true);
+		serverThread.join();
+
+		// Single connection is served until client disconnects.
+		std::thread connectionThread([& server]() {
+			server.serveConnection();
+		});
+		TestParse(socketPath);
+		connectionThread.join();
+
+		// Stale socket of a server, which has not been destroyed, is replaced.
+		CHECK_NOTHROW(crap::ParseServer restarted(schema.parser, socketPath));
+	}
+	TestUnknownStatus();
+	TestExistingFile();
+	return test::Summary("server");
+}
@@ -0,0 +1,123 @@
+// Tests of Settings and SettingsPublisher. A publisher thread parses command lines and publishes their snapshots, while
+// reader threads check that each snapshot they see is whole and that snapshots never go back to older generations.
+
+#include "test.hpp"
+#include "../include/crap.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const unsigned long GENERATIONS = 20000;
+
+const int READERS = 3;
+
+struct Schema
+{
+	Schema();
+
+	crap::KeyArg cmd;
+	crap::Parser parser;
+	crap::KeyValueArg first;
+	crap::KeyValueArg second;
+	crap::KeyArg odd;
+};
+
+Schema::Schema():
+    cmd("prog"),
+    parser(& cmd),
+    first("--first", "generation"),
+    second("--second", "generation"),
+    odd("--odd")
+{
+	parser.addAttr(& first);
+	parser.addAttr(& second);
+	parser.addAttr(& odd);
+}
+
+/**
+ * Parse command line of a generation and take its snapshot.
+ */
+crap::SettingsPublisher::SettingsPtr Snapshot(Schema & schema, unsigned long generation)
+{
+	std::string value = std::to_string(generation);
+	std::string firstArg = "--first=" + value;
+	std::string secondArg = "--second=" + value;
+	std::vector<char *> argv{const_cast<char *>("prog"), & firstArg[0], & secondArg[0]};
+	if (generation % 2)
+		argv.push_back(const_cast<char *>("--odd"));
+	schema.parser.reset();
+	schema.parser.parse(static_cast<int>(argv.size()), argv.data());
+	return std::make_shared<const crap::Settings>(schema.parser);
+}
+
+void TestSnapshot()
+{
+	Schema schema;
+	crap::SettingsPublisher::SettingsPtr settings = Snapshot(schema, 7);
+	// Snapshot is not affected by later parses.
+	Snapshot(schema, 8);
+	CHECK(settings->isSet(schema.first) && (settings->value(schema.first) == "7"));
+	CHECK(settings->isSet(schema.odd));
+	CHECK(schema.first.value() == "8");
+	CHECK(!schema.odd.isSet());
+
+	crap::KeyArg unrelated("--unrelated");
+	CHECK(!settings->isSet(unrelated));
+	CHECK(settings->value(unrelated).empty());
+}
+
+void TestPublisher()
+{
+	Schema schema;
+	crap::SettingsPublisher publisher(Snapshot(schema, 0));
+	std::atomic<bool> done(false);
+	std::atomic<int> failures(0);
+	std::atomic<unsigned long> reads(0);
+
+	auto read = [&]() {
+		crap::SettingsPublisher::Reader reader(publisher);
+		unsigned long last = 0;
+		do {
+			const crap::SettingsPublisher::SettingsPtr & settings = reader.settings();
+			unsigned long first = std::strtoul(settings->value(schema.first).c_str(), nullptr, 10);
+			unsigned long second = std::strtoul(settings->value(schema.second).c_str(), nullptr, 10);
+			// Snapshot is whole and it is not older than the one seen before.
+			if ((first != second) || (settings->isSet(schema.odd) != (first % 2 == 1)) || (first < last))
+				failures++;
+			last = first;
+			reads++;
+		} while (!done.load());
+		// Last generation is seen, once it has been published.
+		if (std::strtoul(reader.settings()->value(schema.first).c_str(), nullptr, 10) != GENERATIONS)
+			failures++;
+	};
+	std::vector<std::thread> readers;
+	for (int i = 0; i < READERS; i++)
+		readers.push_back(std::thread(read));
+
+	// Schema is owned by the publisher thread. Readers only look up snapshots by argument addresses.
+	for (unsigned long generation = 1; generation <= GENERATIONS; generation++)
+		publisher.publish(Snapshot(schema, generation));
+	done.store(true);
+	for (std::vector<std::thread>::iterator it = readers.begin(); it != readers.end(); ++it)
+		it->join();
+
+	CHECK(failures.load() == 0);
+	CHECK(reads.load() >= static_cast<unsigned long>(READERS));
+	CHECK(publisher.settings()->value(schema.second) == std::to_string(GENERATIONS));
+}
+
+}
+
+int main()
+{
+	TestSnapshot();
+	TestPublisher();
+	return test::Summary("settings");
+}
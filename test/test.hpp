@@ -0,0 +1,108 @@
+#ifndef CRAP_TEST_HPP
+#define CRAP_TEST_HPP
+
+/*
+ * Minimal test harness. Each test program runs its checks from main() and returns Summary(), so that make stops on the
+ * first program, which fails.
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <string>
+
+namespace test {
+
+inline
+int & Failures()
+{
+	static int failures = 0;
+	return failures;
+}
+
+inline
+void Fail(const char * file, int line, const std::string & what)
+{
+	std::cerr << file << ":" << line << ": check failed: " << what << std::endl;
+	Failures()++;
+}
+
+/**
+ * Report results of a test program.
+ * @return exit status of a program.
+ */
+inline
+int Summary(const char * name)
+{
+	if (Failures() == 0) {
+		std::cout << name << ": passed" << std::endl;
+		return EXIT_SUCCESS;
+	}
+	std::cout << name << ": " << Failures() << " check(s) failed" << std::endl;
+	return EXIT_FAILURE;
+}
+
+/**
+ * Measure time of a function. Function is run repeatedly in batches, which take at least a few milliseconds, and the
+ * fastest batch is taken, so that measurements are not skewed by other processes.
+ * @return time of a single run in seconds.
+ */
+inline
+double Seconds(const std::function<void ()> & run, int batches = 5)
+{
+	typedef std::chrono::steady_clock Clock;
+
+	unsigned long runs = 1;
+	for (;;) {
+		Clock::time_point start = Clock::now();
+		for (unsigned long i = 0; i < runs; i++)
+			run();
+		if (Clock::now() - start >= std::chrono::milliseconds(4))
+			break;
+		runs *= 2;
+	}
+
+	double best = 0.0;
+	for (int batch = 0; batch < batches; batch++) {
+		Clock::time_point start = Clock::now();
+		for (unsigned long i = 0; i < runs; i++)
+			run();
+		double seconds = std::chrono::duration<double>(Clock::now() - start).count() / static_cast<double>(runs);
+		if ((batch == 0) || (seconds < best))
+			best = seconds;
+	}
+	return best;
+}
+
+}
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) \
+			test::Fail(__FILE__, __LINE__, #condition); \
+	} while (false)
+
+#define CHECK_THROWS(statement, ExceptionType) \
+	do { \
+		bool thrown = false; \
+		try { \
+			statement; \
+		} catch (const ExceptionType & ) { \
+			thrown = true; \
+		} \
+		if (!thrown) \
+			test::Fail(__FILE__, __LINE__, #statement " throws " #ExceptionType); \
+	} while (false)
+
+#define CHECK_NOTHROW(statement) \
+	do { \
+		try { \
+			statement; \
+		} catch (const std::exception & e) { \
+			test::Fail(__FILE__, __LINE__, std::string(#statement " throws: ") + e.what()); \
+		} \
+	} while (false)
+
+#endif